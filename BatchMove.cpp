@@ -0,0 +1,196 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <cstring>
+#include <vector>
+#include "./BatchMove.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+BatchMove::Kernel BatchMove::selected =
+        BatchMove::supported(BatchMove::AVX2) ? BatchMove::AVX2
+                                              : BatchMove::SCALAR;
+
+namespace {
+void clearMask(uint64_t* changed, size_t n) {
+    std::memset(changed, 0, (n + 63) / 64 * sizeof(uint64_t));
+}
+
+// Move boards begin to end one by one (with a cleared mask).
+void moveRange(const Bitboard* boards, const Direction* dirs, size_t begin,
+        size_t end, Bitboard* out, int* scores, uint64_t* changed) {
+    for (size_t i = begin; i < end; i++) {
+        int score = 0;
+        Bitboard moved = MoveTables::move(boards[i], dirs[i], &score);
+        if (moved != boards[i]) changed[i / 64] |= uint64_t(1) << (i % 64);
+        out[i] = moved;
+        scores[i] = score;
+    }
+}
+
+#if defined(__x86_64__)
+static_assert(sizeof(Bitboard) == 8, "boards are loaded as 64 bit lanes");
+static_assert(sizeof(Direction) == 4, "directions are loaded as 32 bit");
+
+// The row tables of MoveTables in one gather friendly table: entry
+// row (left) or 65536 + row (right) holds the moved row in its low 16 bits
+// and a quarter of the points in its high 16 bits (every merge scores a
+// multiple of 4, at most 65536 per row). Built on first use, after the
+// MoveTables are.
+const int* packedTable() {
+    static const std::vector<int> table = [] {
+        std::vector<int> entries(2 * 65536);
+        for (int row = 0; row < 65536; row++) {
+            entries[row] = MoveTables::rowLeft[row] |
+                           (MoveTables::scoreLeft[row] / 4) << 16;
+            entries[65536 + row] = MoveTables::rowRight[row] |
+                                   (MoveTables::scoreRight[row] / 4) << 16;
+        }
+        return entries;
+    }();
+    return table.data();
+}
+
+// MoveTables::transpose on four boards.
+__attribute__((target("avx2")))
+__m256i transpose4(__m256i x) {
+    __m256i a = _mm256_or_si256(
+        _mm256_and_si256(x, _mm256_set1_epi64x(0xF0F00F0FF0F00F0FULL)),
+        _mm256_or_si256(
+            _mm256_slli_epi64(_mm256_and_si256(x,
+                    _mm256_set1_epi64x(0x0000F0F00000F0F0ULL)), 12),
+            _mm256_srli_epi64(_mm256_and_si256(x,
+                    _mm256_set1_epi64x(0x0F0F00000F0F0000ULL)), 12)));
+    return _mm256_or_si256(
+        _mm256_and_si256(a, _mm256_set1_epi64x(0xFF00FF0000FF00FFULL)),
+        _mm256_or_si256(
+            _mm256_srli_epi64(_mm256_and_si256(a,
+                    _mm256_set1_epi64x(0x00FF00FF00000000ULL)), 24),
+            _mm256_slli_epi64(_mm256_and_si256(a,
+                    _mm256_set1_epi64x(0x00000000FF00FF00ULL)), 24)));
+}
+
+// Move four boards in their directions; the points go to *points.
+__attribute__((target("avx2")))
+__m256i move4(__m256i boards, __m128i dirs, const int* table,
+              __m128i* points) {
+    __m256i dir = _mm256_cvtepi32_epi64(dirs);
+    __m256i vertical = _mm256_cmpgt_epi64(dir, _mm256_set1_epi64x(1));
+    // RIGHT and DOWN use the second half of the table.
+    __m256i half = _mm256_slli_epi64(
+            _mm256_and_si256(dir, _mm256_set1_epi64x(1)), 16);
+    __m256i x = _mm256_blendv_epi8(boards, transpose4(boards), vertical);
+
+    const __m256i rowMask = _mm256_set1_epi64x(0xFFFF);
+    const __m128i low16 = _mm_set1_epi32(0xFFFF);
+    __m256i result = _mm256_setzero_si256();
+    __m128i quarters = _mm_setzero_si128();
+    for (int r = 0; r < 4; r++) {
+        __m128i shift = _mm_cvtsi32_si128(16 * r);
+        __m256i index = _mm256_or_si256(
+                _mm256_and_si256(_mm256_srl_epi64(x, shift), rowMask), half);
+        __m128i entry = _mm256_i64gather_epi32(table, index, 4);
+        __m256i row = _mm256_cvtepu32_epi64(_mm_and_si128(entry, low16));
+        result = _mm256_or_si256(result, _mm256_sll_epi64(row, shift));
+        quarters = _mm_add_epi32(quarters, _mm_srli_epi32(entry, 16));
+    }
+    *points = _mm_slli_epi32(quarters, 2);
+    return _mm256_blendv_epi8(result, transpose4(result), vertical);
+}
+
+// Bits of the boards that changed, from the moved and the input boards.
+__attribute__((target("avx2")))
+uint64_t changed4(__m256i moved, __m256i boards) {
+    __m256i same = _mm256_cmpeq_epi64(moved, boards);
+    return ~_mm256_movemask_pd(_mm256_castsi256_pd(same)) & 0xF;
+}
+#endif
+}  // namespace
+
+// ___________________________________________________________________________
+void BatchMove::move(const Bitboard* boards, const Direction* dirs, size_t n,
+        Bitboard* out, int* scores, uint64_t* changed) {
+    if (selected == AVX2) {
+        moveAvx2(boards, dirs, n, out, scores, changed);
+    } else {
+        moveScalar(boards, dirs, n, out, scores, changed);
+    }
+}
+
+// ___________________________________________________________________________
+void BatchMove::moveScalar(const Bitboard* boards, const Direction* dirs,
+        size_t n, Bitboard* out, int* scores, uint64_t* changed) {
+    clearMask(changed, n);
+    moveRange(boards, dirs, 0, n, out, scores, changed);
+}
+
+#if defined(__x86_64__)
+// ___________________________________________________________________________
+__attribute__((target("avx2")))
+void BatchMove::moveAvx2(const Bitboard* boards, const Direction* dirs,
+        size_t n, Bitboard* out, int* scores, uint64_t* changed) {
+    clearMask(changed, n);
+    const int* table = packedTable();
+    size_t i = 0;
+    // eight boards per iteration, as two independent groups of four.
+    for (; i + 8 <= n; i += 8) {
+        __m256i a = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(boards + i));
+        __m256i b = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(boards + i + 4));
+        __m128i dirsA = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(dirs + i));
+        __m128i dirsB = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(dirs + i + 4));
+        __m128i pointsA;
+        __m128i pointsB;
+        __m256i movedA = move4(a, dirsA, table, &pointsA);
+        __m256i movedB = move4(b, dirsB, table, &pointsB);
+        uint64_t bits = changed4(movedA, a) | changed4(movedB, b) << 4;
+        // i is a multiple of 8, so the 8 bits stay within one word.
+        changed[i / 64] |= bits << (i % 64);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), movedA);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 4), movedB);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(scores + i), pointsA);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(scores + i + 4),
+                         pointsB);
+    }
+    moveRange(boards, dirs, i, n, out, scores, changed);
+}
+#else
+// ___________________________________________________________________________
+void BatchMove::moveAvx2(const Bitboard* boards, const Direction* dirs,
+        size_t n, Bitboard* out, int* scores, uint64_t* changed) {
+    moveScalar(boards, dirs, n, out, scores, changed);
+}
+#endif
+
+// ___________________________________________________________________________
+BatchMove::Kernel BatchMove::kernel() {
+    return selected;
+}
+
+// ___________________________________________________________________________
+bool BatchMove::supported(Kernel kernel) {
+    if (kernel == SCALAR) return true;
+#if defined(__x86_64__)
+    // may run before main, so initialize the CPU detection first.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+// ___________________________________________________________________________
+const char* BatchMove::kernelName(Kernel kernel) {
+    return kernel == AVX2 ? "avx2" : "scalar";
+}
+
+// ___________________________________________________________________________
+bool BatchMove::setKernel(Kernel kernel) {
+    if (!supported(kernel)) return false;
+    selected = kernel;
+    return true;
+}
@@ -0,0 +1,50 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef BATCHMOVE_H_
+#define BATCHMOVE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "./Bitboard.h"
+#include "./MoveTables.h"
+
+// Moves many independent boards at once, e.g. to advance thousands of
+// simulated games in lockstep. With AVX2 eight boards go through one
+// iteration: both transpositions run on four boards per register and the
+// rows are looked up with gather instructions. Otherwise (or for the last
+// few boards) every board is moved by MoveTables::move. Both kernels give
+// the same results; the AVX2 one is used if the CPU has it.
+class BatchMove {
+ public:
+    enum Kernel { SCALAR = 0, AVX2 = 1 };
+
+    // Move boards[i] in direction dirs[i] for all i < n. Writes the moved
+    // board to out[i] and the points of its merges to scores[i], and sets
+    // bit i % 64 of changed[i / 64] iff the move changed the board (the
+    // other bits of the last word are cleared). out may be boards. Unlike
+    // Game::updateState, no tile is spawned.
+    static void move(const Bitboard* boards, const Direction* dirs, size_t n,
+                     Bitboard* out, int* scores, uint64_t* changed);
+
+    // The kernel move() uses, and whether the CPU can run a kernel.
+    static Kernel kernel();
+    static bool supported(Kernel kernel);
+    static const char* kernelName(Kernel kernel);
+
+    // Use the given kernel (if supported) from now on; returns false if it
+    // is not. For tests and benchmarks.
+    static bool setKernel(Kernel kernel);
+
+ private:
+    static void moveScalar(const Bitboard* boards, const Direction* dirs,
+                           size_t n, Bitboard* out, int* scores,
+                           uint64_t* changed);
+    static void moveAvx2(const Bitboard* boards, const Direction* dirs,
+                         size_t n, Bitboard* out, int* scores,
+                         uint64_t* changed);
+
+    static Kernel selected;
+};
+
+#endif  // BATCHMOVE_H_
@@ -0,0 +1,77 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <vector>
+#include "./BatchMove.h"
+#include "./MoveTables.h"
+#include "./Random.h"
+
+namespace {
+// Random boards (with some full rows and equal neighbours) and directions.
+void randomBatch(size_t n, std::vector<Bitboard>* boards,
+        std::vector<Direction>* dirs) {
+    Xoshiro256 rng(n);
+    boards->resize(n);
+    dirs->resize(n);
+    for (size_t i = 0; i < n; i++) {
+        Bitboard board;
+        for (int f = 0; f < 16; f++) {
+            if (rng.below(4) != 0) board.setExponent(f, 1 + rng.below(3));
+        }
+        if (i % 5 == 0) board.bits = rng();  // any nibbles, even 15.
+        (*boards)[i] = board;
+        (*dirs)[i] = static_cast<Direction>(rng.below(4));
+    }
+}
+
+// Check a kernel against MoveTables::move (what Game::updateState uses).
+void checkKernel(BatchMove::Kernel kernel) {
+    ASSERT_TRUE(BatchMove::setKernel(kernel));
+    for (size_t n : { 0, 1, 7, 8, 9, 63, 64, 65, 1000 }) {
+        std::vector<Bitboard> boards;
+        std::vector<Direction> dirs;
+        randomBatch(n, &boards, &dirs);
+        std::vector<Bitboard> out(n);
+        std::vector<int> scores(n, -1);
+        std::vector<uint64_t> changed((n + 63) / 64 + 1, ~0ULL);
+        BatchMove::move(boards.data(), dirs.data(), n, out.data(),
+                        scores.data(), changed.data());
+        for (size_t i = 0; i < n; i++) {
+            int score = 0;
+            Bitboard moved = MoveTables::move(boards[i], dirs[i], &score);
+            ASSERT_EQ(moved, out[i]) << i;
+            ASSERT_EQ(score, scores[i]) << i;
+            bool bit = (changed[i / 64] >> (i % 64)) & 1;
+            ASSERT_EQ(moved != boards[i], bit) << i;
+        }
+        // unused bits of the last word are cleared, nothing beyond it.
+        if (n % 64 != 0) {
+            ASSERT_EQ(0u, changed[n / 64] >> (n % 64));
+        }
+        ASSERT_EQ(~0ULL, changed[(n + 63) / 64]);
+
+        // moving in place.
+        BatchMove::move(boards.data(), dirs.data(), n, boards.data(),
+                        scores.data(), changed.data());
+        for (size_t i = 0; i < n; i++) ASSERT_EQ(out[i], boards[i]);
+    }
+}
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(BatchMoveTest, scalar) {
+    checkKernel(BatchMove::SCALAR);
+}
+
+// ____________________________________________________________________________
+TEST(BatchMoveTest, avx2) {
+    if (!BatchMove::supported(BatchMove::AVX2)) {
+        ASSERT_FALSE(BatchMove::setKernel(BatchMove::AVX2));
+        return;
+    }
+    BatchMove::Kernel before = BatchMove::kernel();
+    checkKernel(BatchMove::AVX2);
+    BatchMove::setKernel(before);
+    ASSERT_STREQ("avx2", BatchMove::kernelName(BatchMove::AVX2));
+}
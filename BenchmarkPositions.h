@@ -0,0 +1,19 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef BENCHMARKPOSITIONS_H_
+#define BENCHMARKPOSITIONS_H_
+
+#include <cstdint>
+
+// Positions recorded from a game with seed 2020 (steps 100 to 1500), the
+// fixed inputs of the search benchmarks and of tests on real positions.
+const uint64_t kBenchmarkPositions[] = {
+    0x1000321043307542ULL,
+    0x1002000301264789ULL,
+    0x011002220445579AULL,
+    0x131143125440B874ULL,
+    0x553085209721B820ULL,
+};
+
+#endif  // BENCHMARKPOSITIONS_H_
@@ -0,0 +1,15 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include "./Bitboard.h"
+
+// ___________________________________________________________________________
+void Bitboard::setValue(int field, int value) {
+    // the exponent is the index of the (only) set bit.
+    int expo = 0;
+    while (value > 1) {
+        value >>= 1;
+        expo++;
+    }
+    setExponent(field, expo);
+}
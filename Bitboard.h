@@ -0,0 +1,89 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include <cstdint>
+
+// A 4x4 board packed into a single 64 bit integer. Every field is a nibble
+// holding the log2 exponent of its tile (0 means empty, 1 means 2, 11 means
+// 2048), so field i lives in bits 4*i to 4*i+3 and row r is the 16 bit word
+// starting at bit 16*r. The largest tile that fits into a nibble is 32768.
+class Bitboard {
+ public:
+    // Proxy returned by the non-const operator[], so fields can be read and
+    // written as plain tile values (e.g. board[3] = 2048).
+    class Tile {
+     public:
+        Tile(Bitboard* board, int field) : board(board), field(field) {}
+        operator int() const { return board->value(field); }
+        Tile& operator=(int value) {
+            board->setValue(field, value);
+            return *this;
+        }
+
+     private:
+        Bitboard* board;
+        int field;
+    };
+
+    // An empty board.
+    Bitboard() : bits(0) {}
+
+    // A board from its packed representation.
+    explicit Bitboard(uint64_t bits) : bits(bits) {}
+
+    // Number of fields on the board.
+    int size() const { return 16; }
+
+    // Get / set the log2 exponent stored in a field.
+    int exponent(int field) const {
+        return static_cast<int>((bits >> (4 * field)) & 0xF);
+    }
+    void setExponent(int field, int expo) {
+        bits &= ~(uint64_t(0xF) << (4 * field));
+        bits |= uint64_t(expo & 0xF) << (4 * field);
+    }
+
+    // Get / set the tile value (0, 2, 4, ..., 32768) of a field.
+    int value(int field) const {
+        int expo = exponent(field);
+        return expo == 0 ? 0 : 1 << expo;
+    }
+    void setValue(int field, int value);
+
+    Tile operator[](int field) { return Tile(this, field); }
+    int operator[](int field) const { return value(field); }
+
+    // Get / set a whole row as a 16 bit word (field 4*r is the lowest nibble).
+    uint16_t row(int r) const {
+        return static_cast<uint16_t>(bits >> (16 * r));
+    }
+    void setRow(int r, uint16_t row) {
+        bits &= ~(uint64_t(0xFFFF) << (16 * r));
+        bits |= uint64_t(row) << (16 * r);
+    }
+
+    // 16 bit mask with bit i set iff field i is empty.
+    uint16_t emptyMask() const {
+        // fold every nibble onto its lowest bit, 1 means occupied.
+        uint64_t x = bits | (bits >> 2);
+        x = ~(x | (x >> 1)) & 0x1111111111111111ULL;
+        // gather the 16 bits at positions 4*i into positions i.
+        x = (x | (x >> 3)) & 0x0303030303030303ULL;
+        x = (x | (x >> 6)) & 0x000F000F000F000FULL;
+        x = (x | (x >> 12)) & 0x000000FF000000FFULL;
+        return static_cast<uint16_t>(x | (x >> 24));
+    }
+
+    // Number of empty fields.
+    int countEmpty() const { return __builtin_popcount(emptyMask()); }
+
+    bool operator==(const Bitboard& other) const { return bits == other.bits; }
+    bool operator!=(const Bitboard& other) const { return bits != other.bits; }
+
+    uint64_t bits;
+};
+
+#endif  // BITBOARD_H_
@@ -0,0 +1,40 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include "./Bitboard.h"
+
+// ____________________________________________________________________________
+TEST(BitboardTest, values) {
+    Bitboard board;
+    ASSERT_EQ(0u, board.bits);
+    board[0] = 2;
+    board[5] = 2048;
+    board[15] = 32768;
+    ASSERT_EQ(2, board[0]);
+    ASSERT_EQ(2048, board[5]);
+    ASSERT_EQ(32768, board[15]);
+    ASSERT_EQ(0, board[1]);
+    ASSERT_EQ(11, board.exponent(5));
+    ASSERT_EQ(uint64_t(0xF) << 60 | uint64_t(11) << 20 | 1, board.bits);
+
+    // overwriting a field clears its old exponent.
+    board[5] = 4;
+    ASSERT_EQ(4, board[5]);
+    board[5] = 0;
+    ASSERT_EQ(0, board[5]);
+}
+
+// ____________________________________________________________________________
+TEST(BitboardTest, rows) {
+    Bitboard board;
+    board[4] = 2;
+    board[7] = 8;
+    ASSERT_EQ(0x3001, board.row(1));
+    ASSERT_EQ(0, board.row(0));
+
+    board.setRow(3, 0x1234);
+    ASSERT_EQ(16, board[12]);
+    ASSERT_EQ(2, board[15]);
+    ASSERT_EQ(0x3001, board.row(1));
+}
@@ -0,0 +1,95 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "./CountingOutput.h"
+
+// ___________________________________________________________________________
+CountingOutput::CountingOutput(int fd)
+    : fd(fd), stream(NULL), readEnd(-1), stopFd(-1), count(0) {
+    int ends[2];
+    if (pipe2(ends, O_CLOEXEC) != 0) return;
+    stopFd = eventfd(0, EFD_CLOEXEC);
+    if (stopFd >= 0) stream = fdopen(ends[1], "w");
+    if (stream == NULL) {
+        close(ends[0]);
+        close(ends[1]);
+        if (stopFd >= 0) close(stopFd);
+        return;
+    }
+    // only the reading end does not block; room for big frames if the
+    // system allows it.
+    readEnd = ends[0];
+    fcntl(readEnd, F_SETFL, fcntl(readEnd, F_GETFL) | O_NONBLOCK);
+    fcntl(readEnd, F_SETPIPE_SZ, 1 << 20);
+    thread = std::thread(&CountingOutput::loop, this);
+    // it wakes on every write: at idle priority it waits until the writer
+    // blocks (e.g. for a key) instead of preempting it mid-frame.
+    struct sched_param param = {0};
+    pthread_setschedparam(thread.native_handle(), SCHED_IDLE, &param);
+}
+
+// ___________________________________________________________________________
+CountingOutput::~CountingOutput() {
+    if (stream == NULL) return;
+    uint64_t one = 1;
+    while (write(stopFd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+    thread.join();
+    fflush(stream);
+    forward();
+    fclose(stream);
+    close(readEnd);
+    close(stopFd);
+}
+
+// ___________________________________________________________________________
+int64_t CountingOutput::bytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stream) forward();
+    return count;
+}
+
+// ___________________________________________________________________________
+void CountingOutput::forward() {
+    char buffer[65536];
+    while (true) {
+        ssize_t n = read(readEnd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        count += n;
+        ssize_t written = 0;
+        while (written < n) {
+            ssize_t m = write(fd, buffer + written, n - written);
+            if (m < 0 && errno == EINTR) continue;
+            // the terminal is gone: the bytes still count as written.
+            if (m <= 0) break;
+            written += m;
+        }
+    }
+}
+
+// ___________________________________________________________________________
+void CountingOutput::loop() {
+    struct pollfd fds[2];
+    fds[0].fd = readEnd;
+    fds[0].events = POLLIN;
+    fds[1].fd = stopFd;
+    fds[1].events = POLLIN;
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents) return;
+        // bytes() may have taken the data meanwhile: forward() just finds
+        // the pipe empty then.
+        std::lock_guard<std::mutex> lock(mutex);
+        forward();
+    }
+}
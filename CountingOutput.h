@@ -0,0 +1,59 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef COUNTINGOUTPUT_H_
+#define COUNTINGOUTPUT_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// A stream that counts the bytes written to it on their way to a file
+// descriptor, e.g. the terminal. It is a pipe whose other end is
+// forwarded to the descriptor, so it also counts writes that bypass the
+// FILE buffer and go to fileno(file()), as ncurses does. Only what goes
+// through the stream is counted, not other writes of the process.
+//
+// bytes() forwards on the calling thread, so what a writer asks about is
+// there at once. A thread sleeps in poll() until the pipe has data (or
+// the destructor wakes it) and forwards it, so nothing written stays
+// behind and a writer filling the pipe does not block for good. The
+// thread runs at idle priority, so it does not take the CPU from the
+// writer.
+class CountingOutput {
+ public:
+    // Forward to fd. If no pipe can be made, file() is NULL.
+    explicit CountingOutput(int fd);
+
+    // Forward what is left and stop.
+    ~CountingOutput();
+
+    // The stream to write to (NULL if there is none).
+    FILE* file() const { return stream; }
+
+    // Forward what was written so far and return the bytes written in all
+    // (call fflush(file()) first if the FILE buffer is used).
+    int64_t bytes();
+
+ private:
+    // Forward everything in the pipe (with mutex held).
+    void forward();
+
+    // Forward whenever the pipe has data until stopFd is written.
+    void loop();
+
+    int fd;
+    FILE* stream;
+    int readEnd;
+    // an eventfd the destructor writes to stop the thread.
+    int stopFd;
+    std::mutex mutex;
+    int64_t count;
+    std::thread thread;
+
+    CountingOutput(const CountingOutput&) = delete;
+    CountingOutput& operator=(const CountingOutput&) = delete;
+};
+
+#endif  // COUNTINGOUTPUT_H_
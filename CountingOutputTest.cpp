@@ -0,0 +1,84 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "./CountingOutput.h"
+
+namespace {
+// Everything that can be read from fd until all writers are closed.
+std::string readAll(int fd) {
+    std::string text;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) text.append(buffer, n);
+    return text;
+}
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(CountingOutputTest, counts) {
+    int ends[2];
+    ASSERT_EQ(0, pipe(ends));
+    std::string expected;
+    {
+        CountingOutput output(ends[1]);
+        ASSERT_TRUE(output.file() != NULL);
+        ASSERT_EQ(0, output.bytes());
+        fputs("through the buffer ", output.file());
+        fflush(output.file());
+        ASSERT_EQ(19, output.bytes());
+        // as ncurses writes, past the FILE buffer.
+        ASSERT_EQ(6, write(fileno(output.file()), "direct", 6));
+        ASSERT_EQ(25, output.bytes());
+        // other writes of the process are not counted.
+        FILE* other = tmpfile();
+        fputs("elsewhere", other);
+        fclose(other);
+        ASSERT_EQ(25, output.bytes());
+        expected = "through the buffer direct";
+    }
+    close(ends[1]);
+    ASSERT_EQ(expected, readAll(ends[0]));
+    close(ends[0]);
+}
+
+// ____________________________________________________________________________
+TEST(CountingOutputTest, forwardsUnasked) {
+    int ends[2];
+    ASSERT_EQ(0, pipe(ends));
+    {
+        CountingOutput output(ends[1]);
+        ASSERT_EQ(5, write(fileno(output.file()), "frame", 5));
+        // arrives without a call of bytes().
+        char buffer[5];
+        ASSERT_EQ(5, read(ends[0], buffer, sizeof(buffer)));
+        ASSERT_EQ("frame", std::string(buffer, 5));
+        ASSERT_EQ(5, output.bytes());
+    }
+    close(ends[1]);
+    close(ends[0]);
+}
+
+// ____________________________________________________________________________
+TEST(CountingOutputTest, large) {
+    int ends[2];
+    ASSERT_EQ(0, pipe(ends));
+    // more than both pipes hold at once.
+    std::string text(4 << 20, 'x');
+    std::string received;
+    std::thread reader([&] { received = readAll(ends[0]); });
+    {
+        CountingOutput output(ends[1]);
+        ASSERT_EQ(1u, fwrite(text.data(), text.size(), 1, output.file()));
+        fflush(output.file());
+        ASSERT_EQ(static_cast<int64_t>(text.size()), output.bytes());
+    }
+    close(ends[1]);
+    reader.join();
+    ASSERT_EQ(text, received);
+    close(ends[0]);
+}
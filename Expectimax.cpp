@@ -0,0 +1,195 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "./Expectimax.h"
+#include "./Symmetry.h"
+
+namespace {
+// heuristic value of every possible row (see heuristicValue).
+struct HeuristicTable {
+    HeuristicTable() {
+        const float lostPenalty = 200000.0f;
+        const float monotonicityPower = 4.0f;
+        const float monotonicityWeight = 47.0f;
+        const float sumPower = 3.5f;
+        const float sumWeight = 11.0f;
+        const float mergesWeight = 700.0f;
+        const float emptyWeight = 270.0f;
+
+        for (int row = 0; row < 65536; row++) {
+            int line[4];
+            for (int i = 0; i < 4; i++) line[i] = (row >> (4 * i)) & 0xF;
+
+            float sum = 0;
+            int empty = 0;
+            int merges = 0;
+            int prev = 0;
+            int counter = 0;
+            for (int i = 0; i < 4; i++) {
+                sum += std::pow(line[i], sumPower);
+                if (line[i] == 0) {
+                    empty++;
+                } else {
+                    if (prev == line[i]) {
+                        counter++;
+                    } else if (counter > 0) {
+                        merges += 1 + counter;
+                        counter = 0;
+                    }
+                    prev = line[i];
+                }
+            }
+            if (counter > 0) merges += 1 + counter;
+
+            float monotonicityLeft = 0;
+            float monotonicityRight = 0;
+            for (int i = 1; i < 4; i++) {
+                float a = std::pow(line[i - 1], monotonicityPower);
+                float b = std::pow(line[i], monotonicityPower);
+                if (line[i - 1] > line[i]) {
+                    monotonicityLeft += a - b;
+                } else {
+                    monotonicityRight += b - a;
+                }
+            }
+
+            value[row] = lostPenalty + emptyWeight * empty
+                    + mergesWeight * merges
+                    - monotonicityWeight
+                      * std::min(monotonicityLeft, monotonicityRight)
+                    - sumWeight * sum;
+        }
+    }
+    float value[65536];
+};
+const HeuristicTable heuristic;
+
+const int kTableBits = 18;
+}  // namespace
+
+constexpr float Expectimax::kMinProbability;
+
+// ___________________________________________________________________________
+float heuristicValue(const Bitboard &board) {
+    uint64_t columns = MoveTables::transpose(board.bits);
+    float value = 0;
+    for (int r = 0; r < 4; r++) {
+        value += heuristic.value[(board.bits >> (16 * r)) & 0xFFFF];
+        value += heuristic.value[(columns >> (16 * r)) & 0xFFFF];
+    }
+    return value;
+}
+
+// ___________________________________________________________________________
+int adaptiveDepth(const Bitboard &board) {
+    int seen = 0;
+    for (int i = 0; i < 16; i++) seen |= 1 << board.exponent(i);
+    return std::max(3, __builtin_popcount(seen & ~1) - 2);
+}
+
+// ___________________________________________________________________________
+Expectimax::Expectimax(int depth, bool canonicalKeys)
+    : fixedDepth(depth), canonicalKeys(canonicalKeys), depthLimit(0),
+      depth(0), generation(0) {
+}
+
+// ___________________________________________________________________________
+void Expectimax::startSearch(const Bitboard &board) {
+    if (table.empty()) table.resize(size_t(1) << kTableBits);
+    // a new generation invalidates all entries of earlier searches.
+    if (++generation == 0) {
+        std::fill(table.begin(), table.end(), Entry());
+        generation = 1;
+    }
+
+    depthLimit = fixedDepth > 0 ? fixedDepth : adaptiveDepth(board);
+    depth = 0;
+}
+
+// ___________________________________________________________________________
+float Expectimax::searchMove(const Bitboard &board, Direction dir) {
+    Bitboard moved = MoveTables::move(board, dir, NULL);
+    if (moved == board) return 0;
+    auto start = std::chrono::steady_clock::now();
+    float value = chanceNode(moved, 1.0f) + 1e-6f;
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    searchStats.seconds += elapsed.count();
+    return value;
+}
+
+// ___________________________________________________________________________
+float Expectimax::scoreMove(const Bitboard &board, Direction dir) {
+    startSearch(board);
+    return searchMove(board, dir);
+}
+
+// ___________________________________________________________________________
+int Expectimax::bestMove(const Bitboard &board) {
+    startSearch(board);
+    int best = -1;
+    float bestValue = 0;
+    for (int d = 0; d < 4; d++) {
+        float value = searchMove(board, static_cast<Direction>(d));
+        if (value > bestValue) {
+            best = d;
+            bestValue = value;
+        }
+    }
+    return best;
+}
+
+// ___________________________________________________________________________
+float Expectimax::maxNode(const Bitboard &board, float probability) {
+    searchStats.nodes++;
+    float best = 0;
+    depth++;
+    for (int d = 0; d < 4; d++) {
+        Bitboard moved = MoveTables::move(board, static_cast<Direction>(d),
+                                          NULL);
+        if (moved == board) continue;
+        best = std::max(best, chanceNode(moved, probability));
+    }
+    depth--;
+    return best;
+}
+
+// ___________________________________________________________________________
+float Expectimax::chanceNode(const Bitboard &board, float probability) {
+    searchStats.nodes++;
+    if (probability < kMinProbability || depth >= depthLimit) {
+        return heuristicValue(board);
+    }
+
+    int remaining = depthLimit - depth;
+    uint64_t key = canonicalKeys ? Symmetry::canonical(board, NULL).bits
+                                 : board.bits;
+    Entry &entry = table[(key * 0x9E3779B97F4A7C15ULL) >> (64 - kTableBits)];
+    if (entry.generation == generation && entry.board == key &&
+        entry.remaining >= remaining) {
+        return entry.value;
+    }
+
+    uint16_t empty = board.emptyMask();
+    int numEmpty = __builtin_popcount(empty);
+    probability /= numEmpty;
+
+    float value = 0;
+    for (int field = 0; field < 16; field++) {
+        if (!(empty & (1 << field))) continue;
+        uint64_t two = board.bits | uint64_t(1) << (4 * field);
+        uint64_t four = board.bits | uint64_t(2) << (4 * field);
+        value += maxNode(Bitboard(two), probability * 0.9f) * 0.9f;
+        value += maxNode(Bitboard(four), probability * 0.1f) * 0.1f;
+    }
+    value /= numEmpty;
+
+    entry.board = key;
+    entry.value = value;
+    entry.remaining = static_cast<uint16_t>(remaining);
+    entry.generation = generation;
+    return value;
+}
@@ -0,0 +1,88 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef EXPECTIMAX_H_
+#define EXPECTIMAX_H_
+
+#include <cstdint>
+#include <vector>
+#include "./Bitboard.h"
+#include "./MoveTables.h"
+
+// Heuristic value of a board, summed from precomputed tables over all rows
+// and columns: rewards empty fields, possible merges and monotone rows,
+// punishes large tiles spread over the board.
+float heuristicValue(const Bitboard &board);
+
+// Search depth used for a board when no fixed depth is given: deeper for
+// positions with many distinct tiles, at least 3.
+int adaptiveDepth(const Bitboard &board);
+
+// Statistics of the searches done by a searcher.
+struct SearchStats {
+    SearchStats() : nodes(0), seconds(0) {}
+    int64_t nodes;
+    double seconds;
+    double nodesPerSecond() const {
+        return seconds > 0 ? nodes / seconds : 0;
+    }
+};
+
+// Expectimax search over the moves of MoveTables::move. Max nodes try all
+// legal moves, chance nodes average over every empty field getting a 2
+// (90%) or a 4 (10%), just like spawnTile. Branches whose probability drops
+// below a threshold are cut off and evaluated by heuristicValue, and chance
+// nodes near the root are cached in a transposition table.
+class Expectimax {
+ public:
+    // depth is the number of moves to look ahead, 0 picks it from the
+    // number of distinct tiles on the board (deeper for harder positions).
+    // With canonicalKeys, the table stores each board under its canonical
+    // symmetric form, so all 8 symmetric positions share one entry.
+    explicit Expectimax(int depth = 0, bool canonicalKeys = false);
+
+    // The best move for the board, or -1 if no move is possible.
+    int bestMove(const Bitboard &board);
+
+    // Expected heuristic value of making the given move (0 if illegal).
+    float scoreMove(const Bitboard &board, Direction dir);
+
+    const SearchStats& stats() const { return searchStats; }
+
+    // Probability below which chance branches are not expanded.
+    static constexpr float kMinProbability = 0.0001f;
+
+ private:
+    // A cached chance node. remaining is the search depth below the node,
+    // generation tells which search stored it, so the table never needs
+    // to be cleared.
+    struct Entry {
+        uint64_t board;
+        float value;
+        uint16_t remaining;
+        uint16_t generation;
+    };
+
+    // Set up depth limit and table for a search from board.
+    void startSearch(const Bitboard &board);
+
+    // Value of a move in the current search (0 if illegal).
+    float searchMove(const Bitboard &board, Direction dir);
+
+    float maxNode(const Bitboard &board, float probability);
+    float chanceNode(const Bitboard &board, float probability);
+
+    int fixedDepth;
+    bool canonicalKeys;
+    // depth limit of the current search and depth of the current node.
+    int depthLimit;
+    int depth;
+
+    // direct mapped table of chance nodes (allocated by the first search).
+    std::vector<Entry> table;
+    uint16_t generation;
+
+    SearchStats searchStats;
+};
+
+#endif  // EXPECTIMAX_H_
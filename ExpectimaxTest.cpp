@@ -0,0 +1,67 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include "./Expectimax.h"
+#include "./Spawn.h"
+
+// ____________________________________________________________________________
+TEST(ExpectimaxTest, heuristicValue) {
+    // a monotone row beats the same tiles scattered.
+    Bitboard sorted;
+    sorted.setRow(0, 0x1234);
+    Bitboard scattered;
+    scattered.setRow(0, 0x3142);
+    ASSERT_GT(heuristicValue(sorted), heuristicValue(scattered));
+}
+
+// ____________________________________________________________________________
+TEST(ExpectimaxTest, bestMove) {
+    Expectimax search(2);
+    // only moving right or down changes this board.
+    Bitboard board;
+    board[0] = 2;
+    board[4] = 4;
+    board[1] = 4;
+    int move = search.bestMove(board);
+    ASSERT_TRUE(move == RIGHT || move == DOWN);
+    ASSERT_GT(search.stats().nodes, 0);
+    ASSERT_EQ(0, search.scoreMove(board, LEFT));
+    ASSERT_EQ(0, search.scoreMove(board, UP));
+
+    // no move at all.
+    Bitboard stuck(0x1212212112122121ULL);
+    ASSERT_EQ(-1, search.bestMove(stuck));
+}
+
+// ____________________________________________________________________________
+TEST(ExpectimaxTest, cached) {
+    // cached and uncached searches agree.
+    Bitboard board(0x0000001100220113ULL);
+    Expectimax a(3);
+    Expectimax b(3);
+    float first = a.scoreMove(board, DOWN);
+    ASSERT_FLOAT_EQ(first, b.scoreMove(board, DOWN));
+    ASSERT_FLOAT_EQ(first, a.scoreMove(board, DOWN));
+}
+
+// ____________________________________________________________________________
+TEST(ExpectimaxTest, play) {
+    // even a shallow search reaches 512 easily.
+    Expectimax search(1);
+    Xoshiro256 rng(5);
+    Bitboard board;
+    spawnTile(board, rng);
+    spawnTile(board, rng);
+    int maxExponent = 0;
+    for (int steps = 0; steps < 2000; steps++) {
+        int move = search.bestMove(board);
+        if (move < 0) break;
+        board = MoveTables::move(board, static_cast<Direction>(move), NULL);
+        spawnTile(board, rng);
+        for (int i = 0; i < 16; i++) {
+            maxExponent = std::max(maxExponent, board.exponent(i));
+        }
+    }
+    ASSERT_GE(maxExponent, 9);
+}
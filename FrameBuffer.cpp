@@ -0,0 +1,156 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <errno.h>
+#include <unistd.h>
+#include "./FrameBuffer.h"
+
+namespace {
+// Append a non-negative number in decimal.
+void appendNumber(std::string* out, int n) {
+    char digits[12];
+    int length = 0;
+    do {
+        digits[length++] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    while (length > 0) out->push_back(digits[--length]);
+}
+
+// Unchanged cells up to this many are written again instead of jumping
+// over them: a jump takes at least 6 bytes.
+const int kMaxRewrite = 4;
+
+// Changed blanks of one color from this many on are erased (ECH, in the
+// background color as on xterm compatible terminals) instead of written.
+const int kMinErase = 8;
+}  // namespace
+
+// ___________________________________________________________________________
+FrameBuffer::FrameBuffer(int width, int height) : w(0), h(0) {
+    resize(width, height);
+}
+
+// ___________________________________________________________________________
+void FrameBuffer::resize(int width, int height) {
+    w = width > 0 ? width : 0;
+    h = height > 0 ? height : 0;
+    Cell blank = { ' ', -1, -1 };
+    cells.assign(w * h, blank);
+    shown.assign(w * h, blank);
+    // clearSequence() resets the colors.
+    penFg = -1;
+    penBg = -1;
+}
+
+// ___________________________________________________________________________
+void FrameBuffer::fill(int y, int x, int n, char c, int fg, int bg) {
+    if (y < 0 || y >= h) return;
+    // blanks look the same in every foreground color.
+    if (c == ' ') fg = -1;
+    Cell cell = { c, static_cast<int16_t>(fg), static_cast<int16_t>(bg) };
+    for (int i = x < 0 ? 0 : x; i < x + n && i < w; i++) {
+        cells[y * w + i] = cell;
+    }
+}
+
+// ___________________________________________________________________________
+void FrameBuffer::print(int y, int x, const char* text, int fg, int bg) {
+    if (y < 0 || y >= h) return;
+    Cell cell = { ' ', static_cast<int16_t>(fg), static_cast<int16_t>(bg) };
+    for (int i = x; *text != '\0' && i < w; i++, text++) {
+        if (i < 0) continue;
+        cell.c = *text;
+        cell.fg = *text == ' ' ? -1 : fg;
+        cells[y * w + i] = cell;
+    }
+}
+
+// ___________________________________________________________________________
+void FrameBuffer::appendColor(std::string* out, int code, int color) {
+    out->append("\x1b[");
+    if (color < 0) {
+        appendNumber(out, code + 1);
+    } else {
+        appendNumber(out, code);
+        out->append(";5;");
+        appendNumber(out, color);
+    }
+    out->push_back('m');
+}
+
+// ___________________________________________________________________________
+void FrameBuffer::diff(std::string* out) {
+    // where the cursor is (-1: not known, e.g. after the last column).
+    int row = -1;
+    int column = -1;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            const Cell& cell = cells[y * w + x];
+            if (cell == shown[y * w + x]) continue;
+            // a short gap in the same colors is written again, else jump.
+            bool rewrite = y == row && x > column && x - column <= kMaxRewrite;
+            for (int i = column; rewrite && i < x; i++) {
+                const Cell& gap = shown[y * w + i];
+                rewrite = (gap.c == ' ' || gap.fg == penFg) &&
+                          gap.bg == penBg;
+            }
+            if (rewrite) {
+                for (int i = column; i < x; i++) {
+                    out->push_back(shown[y * w + i].c);
+                }
+            } else if (y != row || x != column) {
+                out->append("\x1b[");
+                appendNumber(out, y + 1);
+                out->push_back(';');
+                appendNumber(out, x + 1);
+                out->push_back('H');
+            }
+            if (cell.c != ' ' && cell.fg != penFg) {
+                appendColor(out, 38, cell.fg);
+                penFg = cell.fg;
+            }
+            if (cell.bg != penBg) {
+                appendColor(out, 48, cell.bg);
+                penBg = cell.bg;
+            }
+            int run = 1;
+            if (cell.c == ' ') {
+                while (x + run < w && cells[y * w + x + run] == cell &&
+                       shown[y * w + x + run] != cell) {
+                    run++;
+                }
+            }
+            row = y;
+            if (run >= kMinErase) {
+                // erasing leaves the cursor where it is.
+                out->append("\x1b[");
+                appendNumber(out, run);
+                out->push_back('X');
+                for (int i = 0; i < run; i++) shown[y * w + x + i] = cell;
+                column = x;
+                x += run - 1;
+                continue;
+            }
+            out->push_back(cell.c);
+            shown[y * w + x] = cell;
+            // terminals differ in where the cursor stays after the last
+            // column, so the next cell always jumps.
+            column = x + 1 < w ? x + 1 : -1;
+        }
+    }
+}
+
+// ___________________________________________________________________________
+int64_t FrameBuffer::flush(int fd) {
+    bytes.clear();
+    diff(&bytes);
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+        ssize_t n = write(fd, bytes.data() + sent, bytes.size() - sent);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        sent += n;
+    }
+    return sent;
+}
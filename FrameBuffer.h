@@ -0,0 +1,82 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A terminal screen in memory: a grid of cells, each a character with a
+// foreground and a background color of the 256 color palette (-1 is the
+// terminal's default; blanks have no foreground). A frame is drawn into
+// the cells and then sent as the ANSI escape sequences that turn the frame
+// on screen into it: only changed cells are written, the cursor jumps over
+// unchanged runs, long runs of blanks are erased and colors are only set
+// when they change. The whole frame goes out in one write(), so its cost
+// is one system call and a number of bytes that grows with the change,
+// not with the screen.
+class FrameBuffer {
+ public:
+    // A screen of width x height blank cells.
+    FrameBuffer(int width, int height);
+
+    // Change the size. The terminal is expected to be blank afterwards
+    // (see clearSequence()).
+    void resize(int width, int height);
+
+    // Fill n cells of row y from column x on with character c. Cells off
+    // the screen are skipped.
+    void fill(int y, int x, int n, char c, int fg, int bg);
+
+    // Write text into row y from column x on.
+    void print(int y, int x, const char* text, int fg, int bg);
+
+    // Append the escape sequences from the frame on screen to this one to
+    // *out, and remember this one as on screen.
+    void diff(std::string* out);
+
+    // Send the changes to fd in one write(). Returns the bytes written, or
+    // -1 if the write failed (the frame counts as sent anyway).
+    int64_t flush(int fd);
+
+    // The character and colors of a cell (for tests).
+    char character(int y, int x) const { return cells[y * w + x].c; }
+    int foreground(int y, int x) const { return cells[y * w + x].fg; }
+    int background(int y, int x) const { return cells[y * w + x].bg; }
+
+    int width() const { return w; }
+    int height() const { return h; }
+
+    // Blank the terminal (default colors) and put the cursor home.
+    static const char* clearSequence() { return "\x1b[0m\x1b[2J\x1b[H"; }
+
+ private:
+    struct Cell {
+        char c;
+        int16_t fg;
+        int16_t bg;
+        bool operator==(const Cell& other) const {
+            return c == other.c && fg == other.fg && bg == other.bg;
+        }
+        bool operator!=(const Cell& other) const { return !(*this == other); }
+    };
+
+    // Append "ESC [ <code>;5;<color> m", or "ESC [ <code + 1> m" for the
+    // default color (code 38 sets the foreground, 48 the background).
+    static void appendColor(std::string* out, int code, int color);
+
+    int w;
+    int h;
+    // this frame and the one on screen.
+    std::vector<Cell> cells;
+    std::vector<Cell> shown;
+    // the colors the terminal writes with.
+    int penFg;
+    int penBg;
+    // the bytes of the last flush, kept to reuse their memory.
+    std::string bytes;
+};
+
+#endif  // FRAMEBUFFER_H_
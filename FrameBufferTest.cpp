@@ -0,0 +1,157 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "./FrameBuffer.h"
+#include "./Random.h"
+
+namespace {
+// A terminal that understands the sequences FrameBuffer sends: cursor
+// position, 256 colors, default colors and erase characters.
+class Terminal {
+ public:
+    Terminal(int width, int height)
+        : width(width), chars(width * height, ' '),
+          foregrounds(width * height, -1), backgrounds(width * height, -1),
+          y(0), x(0), fg(-1), bg(-1) {}
+
+    void apply(const std::string &bytes) {
+        for (size_t i = 0; i < bytes.size(); i++) {
+            if (bytes[i] != '\x1b') {
+                chars[y * width + x] = bytes[i];
+                foregrounds[y * width + x] = fg;
+                backgrounds[y * width + x] = bg;
+                x++;
+                continue;
+            }
+            // ESC [ numbers separated by ';' and a command letter.
+            std::vector<int> numbers(1, 0);
+            for (i += 2; bytes[i] == ';' || isdigit(bytes[i]); i++) {
+                if (bytes[i] == ';') {
+                    numbers.push_back(0);
+                } else {
+                    numbers.back() = numbers.back() * 10 + bytes[i] - '0';
+                }
+            }
+            if (bytes[i] == 'H') {
+                y = numbers[0] - 1;
+                x = numbers[1] - 1;
+            } else if (bytes[i] == 'X') {
+                for (int k = 0; k < numbers[0]; k++) {
+                    chars[y * width + x + k] = ' ';
+                    backgrounds[y * width + x + k] = bg;
+                }
+            } else if (bytes[i] == 'm') {
+                if (numbers[0] == 38) fg = numbers[2];
+                if (numbers[0] == 48) bg = numbers[2];
+                if (numbers[0] == 39) fg = -1;
+                if (numbers[0] == 49) bg = -1;
+            }
+        }
+    }
+
+    char character(int row, int column) const {
+        return chars[row * width + column];
+    }
+    int foreground(int row, int column) const {
+        return foregrounds[row * width + column];
+    }
+    int background(int row, int column) const {
+        return backgrounds[row * width + column];
+    }
+
+ private:
+    int width;
+    std::string chars;
+    std::vector<int> foregrounds;
+    std::vector<int> backgrounds;
+    int y;
+    int x;
+    int fg;
+    int bg;
+};
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(FrameBufferTest, draw) {
+    FrameBuffer frame(10, 3);
+    ASSERT_EQ(10, frame.width());
+    ASSERT_EQ(3, frame.height());
+    frame.print(1, 8, "abc", 232, 228);
+    // clipped at the right edge, and rows off the screen are skipped.
+    ASSERT_EQ('a', frame.character(1, 8));
+    ASSERT_EQ('b', frame.character(1, 9));
+    ASSERT_EQ(232, frame.foreground(1, 8));
+    ASSERT_EQ(228, frame.background(1, 8));
+    frame.fill(-1, 0, 10, '#', 1, 2);
+    frame.fill(2, -2, 4, ' ', 5, 6);
+    ASSERT_EQ(6, frame.background(2, 1));
+    ASSERT_EQ(-1, frame.background(2, 2));
+    // blanks have no foreground color.
+    ASSERT_EQ(-1, frame.foreground(2, 0));
+}
+
+// ____________________________________________________________________________
+TEST(FrameBufferTest, diff) {
+    FrameBuffer frame(20, 4);
+    std::string bytes;
+    frame.diff(&bytes);
+    ASSERT_EQ("", bytes);
+    frame.print(1, 2, "2048", 232, 220);
+    frame.diff(&bytes);
+    ASSERT_EQ("\x1b[2;3H\x1b[38;5;232m\x1b[48;5;220m2048", bytes);
+    // an unchanged frame costs nothing, one changed cell a few bytes.
+    bytes.clear();
+    frame.diff(&bytes);
+    ASSERT_EQ("", bytes);
+    frame.print(1, 4, "8", 232, 220);
+    frame.diff(&bytes);
+    ASSERT_EQ("\x1b[2;5H8", bytes);
+    // a small gap is written again, a long run of blanks erased.
+    bytes.clear();
+    frame.print(1, 2, "1", 232, 220);
+    frame.print(1, 5, "6", 232, 220);
+    frame.fill(3, 0, 20, ' ', -1, 220);
+    frame.diff(&bytes);
+    ASSERT_EQ("\x1b[2;3H1086\x1b[4;1H\x1b[20X", bytes);
+}
+
+// ____________________________________________________________________________
+TEST(FrameBufferTest, random) {
+    // random frames: the terminal always shows what was drawn.
+    const int width = 30;
+    const int height = 8;
+    FrameBuffer frame(width, height);
+    Terminal terminal(width, height);
+    Xoshiro256 rng(3);
+    for (int round = 0; round < 200; round++) {
+        for (int k = rng.below(6); k > 0; k--) {
+            int bg = static_cast<int>(rng.below(4)) - 1;
+            if (rng.below(2)) {
+                frame.fill(rng.below(height), rng.below(width) - 3,
+                           rng.below(20), ' ', 7, bg);
+            } else {
+                char text[] = "x";
+                text[0] = 'a' + rng.below(3);
+                frame.print(rng.below(height), rng.below(width), text,
+                            rng.below(3), bg);
+            }
+        }
+        std::string bytes;
+        frame.diff(&bytes);
+        terminal.apply(bytes);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                ASSERT_EQ(frame.character(y, x), terminal.character(y, x));
+                ASSERT_EQ(frame.background(y, x),
+                          terminal.background(y, x));
+                if (frame.character(y, x) == ' ') continue;
+                ASSERT_EQ(frame.foreground(y, x),
+                          terminal.foreground(y, x));
+            }
+        }
+    }
+}
@@ -1,39 +1,156 @@
 // Copyright 2020, University of Freiburg,
 // Author: Leander Goldbach
 
+#include <fcntl.h>
 #include <getopt.h>
 #include <ncurses.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 #include <vector>
 #include <utility>
 #include <iostream>
-#include <unordered_map>
 #include <random>
 #include <string>
+#include "./CountingOutput.h"
 #include "./Game2048.h"
+#include "./Metrics.h"
+#include "./Snapshot.h"
+#include "./Spawn.h"
+
+constexpr int Board::kColors[];
+
+namespace {
+// A fresh seed for every game. Opening a random_device costs more than
+// the rest of a Game, so it only seeds a process wide sequence of seeds.
+uint64_t freshSeed() {
+    static const uint64_t base = [] {
+        std::random_device rd;
+        return (uint64_t(rd()) << 32) | rd();
+    }();
+    static std::atomic<uint64_t> games(0);
+    uint64_t state = base + games.fetch_add(1) * 0x9E3779B97F4A7C15ULL;
+    return splitmix64(state);
+}
+
+// How long readKey() waits for the rest of an escape sequence in ms.
+const int kEscapeMs = 25;
+
+// The key at the start of the n bytes read from a terminal, with its
+// length in *used: the arrows are ESC [ A to D (or ESC O A to D), other
+// sequences (ESC [, parameters and a final byte) are ERR, and ESC that
+// starts none is ESC. *used is 0 if the bytes end within a sequence.
+int parseKey(const char* keys, int n, int* used) {
+    *used = 1;
+    if (keys[0] != 27) return static_cast<unsigned char>(keys[0]);
+    if (n >= 2 && keys[1] != '[' && keys[1] != 'O') return 27;
+    // ESC O and a letter, or ESC [, parameters and a final byte.
+    int end = 2;
+    while (n > 1 && keys[1] == '[' && end < n && keys[end] >= 0x20 &&
+           keys[end] < 0x40) {
+        end++;
+    }
+    if (end >= n) {
+        *used = 0;
+        return ERR;
+    }
+    *used = end + 1;
+    const char arrows[] = "ABCD";
+    const int codes[] = { KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT };
+    const char* arrow = strchr(arrows, keys[end]);
+    if (end > 2 || arrow == NULL || keys[end] == '\0') return ERR;
+    return codes[arrow - arrows];
+}
+}  // namespace
 
-Board::Board() {
-    // coordinates for tile centers relative to terminal center.
-    std::vector<int> c = { -36, -12, 12, 36 };
-    tileSize = c.back()/4;
+Board::Board(int size, Renderer renderer)
+    : renderer(renderer), frame(0, 0), rawTerminal(false),
+      inputFd(STDIN_FILENO), numKeys(0) {
+    // coordinates for tile centers relative to terminal center: the board
+    // is about 96 columns wide whatever its size.
+    int spacing = 96 / size;
+    tileSize = spacing * 3 / 8;
 
     y_scale = 2.3;  // vertically squish the board by a factor.
-    // Save coordinate pairs in a vector.
-    for (const auto& i : c) {
-        for (const auto& j : c) {
-            std::pair<int, int> p(i/y_scale, j);
-            tileCoords.push_back(p);
+    inputTimeout = -1;
+    fields = size * size;
+    std::fill(drawn, drawn + fields, -1);
+    frameBytes = 0;
+    totalBytes = 0;
+    frames = 0;
+    screen = NULL;
+    cx = 0;
+    cy = 0;
+    // Save coordinate pairs row by row.
+    for (int r = 0; r < size; r++) {
+        int i = (2 * r - size + 1) * spacing / 2;
+        for (int k = 0; k < size; k++) {
+            int j = (2 * k - size + 1) * spacing / 2;
+            tileCoords[r * size + k] = std::pair<int, int>(i / y_scale, j);
         }
     }
 }
 
 void Board::initialize() {
-    initscr();              // Initializiation.
+    inputTimeout = -1;
+    std::fill(drawn, drawn + fields, -1);
+    // keys without echo and without waiting for RETURN, for ncurses too
+    // (its cbreak() and noecho() set the pipe below, not the terminal).
+    if (!rawTerminal && tcgetattr(STDIN_FILENO, &savedTerminal) == 0) {
+        struct termios raw = savedTerminal;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        rawTerminal = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+    }
+    int columns = 80;
+    int lines = 24;
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) {
+        columns = size.ws_col;
+        lines = size.ws_row;
+    }
+    if (renderer == RENDER_ANSI) {
+        cx = columns / 2;
+        cy = lines / 2;
+        frame.resize(columns, lines);
+        // the alternate screen, without cursor, blank.
+        std::string start = "\x1b[?1049h\x1b[?25l";
+        start += FrameBuffer::clearSequence();
+        ssize_t unused = write(STDOUT_FILENO, start.data(), start.size());
+        (void) unused;
+        return;
+    }
+    // ncurses writes to the terminal through a CountingOutput, so that
+    // finishFrame() counts the bytes of its frames and no other writes of
+    // the process. It cannot ask that pipe for the size of the terminal
+    // and takes it from LINES and COLUMNS instead.
+    if (screen == NULL) {
+        output = std::make_shared<CountingOutput>(STDOUT_FILENO);
+        setenv("LINES", std::to_string(lines).c_str(), 1);
+        setenv("COLUMNS", std::to_string(columns).c_str(), 1);
+        if (output->file()) screen = newterm(NULL, output->file(), stdin);
+    }
+    if (screen) {
+        set_term(screen);
+    } else {
+        output.reset();
+        initscr();          // Initializiation (exits if that fails).
+    }
     start_color();          // init colors.
     use_default_colors();   // default terminal colors.
     cbreak();               // Don't wait for RETURN.
     noecho();               // Don't echo key presses on screen.
     curs_set(false);        // Don't show the cursor.
-    nodelay(stdscr, true);  // Don't wait until key pressed.
+    timeout(-1);            // Wait for keys (see setInputTimeout).
     keypad(stdscr, true);   // For KEY_LEFT, KEY_UP, etc.
 
     // get center coordinates.
@@ -41,41 +158,266 @@ void Board::initialize() {
     cy = LINES / 2;
 
     init_pair(100, COLOR_BLACK, COLOR_WHITE);
+    // one pair per tile value for the tile and one for its number.
+    for (int exponent = 0; exponent < 18; exponent++) {
+        int color = kColors[exponent];
+        init_pair(tilePair(exponent), color, color);
+        init_pair(numberPair(exponent), 232, color);
+    }
 }
 
-void Board::drawBoard(std::vector<int> state) {
-    for (int i = 0; i < 16; i ++) {
-        init_pair(i+1, colors.at(state[i]), colors.at(state[i]));
-        init_pair(i+1+16, 232, colors.at(state[i]));
+void Board::finish() {
+    if (renderer == RENDER_CURSES) {
+        endwin();
+        if (screen) delscreen(screen);
+        screen = NULL;
+        // forwards what is left.
+        output.reset();
+    } else {
+        const char end[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+        ssize_t unused = write(STDOUT_FILENO, end, sizeof(end) - 1);
+        (void) unused;
+    }
+    if (rawTerminal) tcsetattr(STDIN_FILENO, TCSANOW, &savedTerminal);
+    rawTerminal = false;
+}
 
-        attron(COLOR_PAIR(i+1));
-        drawTile(tileCoords[i]);
-        attroff(COLOR_PAIR(i+1));
+void Board::setInputTimeout(int ms) {
+    if (ms < 0) ms = -1;
+    if (ms == inputTimeout) return;
+    if (renderer == RENDER_CURSES) timeout(ms);
+    inputTimeout = ms;
+}
 
-        if (state[i] != 0) {
-            attron(COLOR_PAIR(i + 1 + 16));
-            mvprintw(cy + tileCoords[i].first, cx + tileCoords[i].second, "%d",
-                     state[i]);
-            attroff(COLOR_PAIR(i + 1 + 16));
+int Board::readKey() {
+    if (renderer == RENDER_CURSES) return getch();
+    while (true) {
+        int used = 0;
+        int key = numKeys > 0 ? parseKey(keys, numKeys, &used) : ERR;
+        if (used > 0) {
+            numKeys -= used;
+            std::memmove(keys, keys + used, numKeys);
+            return key;
+        }
+        // nothing buffered, or an escape sequence cut short (e.g. by the
+        // end of a read): its rest follows at once if it is one.
+        bool partial = numKeys > 0;
+        struct pollfd input = { inputFd, POLLIN, 0 };
+        ssize_t length = 0;
+        if (poll(&input, 1, partial ? kEscapeMs : inputTimeout) > 0) {
+            length = read(inputFd, keys + numKeys, sizeof(keys) - numKeys);
+        }
+        if (length > 0) {
+            numKeys += length;
+        } else if (partial) {
+            // nothing followed: ESC was pressed.
+            numKeys--;
+            std::memmove(keys, keys + 1, numKeys);
+            return 27;
+        } else {
+            return ERR;
         }
     }
 }
 
-void Board::drawTile(std::pair<int, int> coords) {
+void Board::pairColors(int pair, int* fg, int* bg) {
+    *fg = -1;
+    *bg = -1;
+    if (pair >= tilePair(0) && pair < numberPair(0)) {
+        *fg = kColors[pair - tilePair(0)];
+        *bg = *fg;
+    } else if (pair >= numberPair(0) && pair < numberPair(18)) {
+        *fg = 232;
+        *bg = kColors[pair - numberPair(0)];
+    }
+}
+
+void Board::fillLine(int y, int x, int n, int pair) {
+    if (renderer == RENDER_ANSI) {
+        int fg, bg;
+        pairColors(pair, &fg, &bg);
+        frame.fill(y, x, n, ' ', fg, bg);
+        return;
+    }
+    attron(COLOR_PAIR(pair));
+    mvhline(y, x, ' ', n);
+    attroff(COLOR_PAIR(pair));
+}
+
+void Board::text(int y, int x, int pair, const char* format, ...) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (renderer == RENDER_ANSI) {
+        int fg, bg;
+        pairColors(pair, &fg, &bg);
+        frame.print(y, x, line, fg, bg);
+        return;
+    }
+    attron(COLOR_PAIR(pair));
+    mvaddstr(y, x, line);
+    attroff(COLOR_PAIR(pair));
+}
+
+void Board::drawBoard(const Bitboard &state) {
+    METRIC_TIME(DRAW_BOARD);
+    for (int i = 0; i < 16; i ++) drawField(i, state.exponent(i));
+}
+
+void Board::drawField(int i, int exponent) {
+    if (exponent == drawn[i]) return;
+    drawn[i] = exponent;
+    drawTile(tileCoords[i], exponent);
+}
+
+void Board::drawTile(std::pair<int, int> coords, int exponent) {
+    int color = std::min(exponent, 17);
+    // the tile is squished vertically, so several of its 2 * tileSize + 1
+    // rows fall onto the same line; draw every line once.
+    int lastY = -1;
     for (int i = -tileSize; i <= tileSize; i++) {
-        for (int j = -tileSize; j <= tileSize; j++) {
-            mvprintw(cy+coords.first+(i/y_scale), cx+coords.second+j, " ");
+        int y = cy + coords.first + (i / y_scale);
+        if (y == lastY) continue;
+        fillLine(y, cx + coords.second - tileSize, 2 * tileSize + 1,
+                 tilePair(color));
+        lastY = y;
+    }
+
+    if (exponent != 0) {
+        // keep the number inside the (small) tiles of large boards.
+        unsigned long long value = 1ULL << std::min(exponent, 63);
+        int length = 1;
+        for (unsigned long long v = value; v >= 10; v /= 10) length++;
+        int x = std::min(cx + coords.second,
+                         cx + coords.second + tileSize + 1 - length);
+        text(cy + coords.first, x, numberPair(color), "%llu", value);
+    }
+}
+
+void Board::clearTiles() {
+    std::pair<int, int> first = tileCoords[0];
+    std::pair<int, int> last = tileCoords[fields - 1];
+    // the same rounding as in drawTile().
+    int top = cy + first.first + (-tileSize / y_scale);
+    int bottom = cy + last.first + (tileSize / y_scale);
+    int left = cx + first.second - tileSize;
+    int width = last.second - first.second + 2 * tileSize + 1;
+    for (int y = top; y <= bottom; y++) fillLine(y, left, width, 0);
+}
+
+void Board::moveTiles(const Bitboard &before, Direction dir, int ms) {
+    if (ms <= 0 || fields != 16) return;
+    // where every tile goes: along each line (counted from the edge the
+    // tiles move to), a tile merges with the next equal one.
+    int target[16];
+    for (int line = 0; line < 4; line++) {
+        int out = 0;
+        int pending = -1;
+        for (int k = 0; k < 4; k++) {
+            int field = dir == LEFT ? line * 4 + k
+                      : dir == RIGHT ? line * 4 + 3 - k
+                      : dir == UP ? k * 4 + line
+                      : (3 - k) * 4 + line;
+            target[field] = -1;
+            if (before.exponent(field) == 0) continue;
+            int to = dir == LEFT ? line * 4 + out
+                   : dir == RIGHT ? line * 4 + 3 - out
+                   : dir == UP ? out * 4 + line
+                   : (3 - out) * 4 + line;
+            if (pending >= 0 &&
+                before.exponent(pending) == before.exponent(field)) {
+                // both go where the first one went.
+                target[field] = target[pending];
+                pending = -1;
+            } else {
+                target[field] = to;
+                pending = field;
+                out++;
+            }
         }
     }
+    // one frame per 16 ms (about 60 per second), the last one with all
+    // tiles at their targets.
+    int steps = std::max(1, ms / 16);
+    for (int step = 1; step <= steps; step++) {
+        double t = static_cast<double>(step) / steps;
+        clearTiles();
+        for (int i = 0; i < 16; i++) drawTile(tileCoords[i], 0);
+        for (int i = 0; i < 16; i++) {
+            if (target[i] < 0) continue;
+            std::pair<int, int> from = tileCoords[i];
+            std::pair<int, int> to = tileCoords[target[i]];
+            std::pair<int, int> at(
+                    from.first + std::lround(t * (to.first - from.first)),
+                    from.second + std::lround(t * (to.second - from.second)));
+            drawTile(at, before.exponent(i));
+        }
+        finishFrame();
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms / steps));
+    }
+    // the moved tiles covered fields and gaps: start over.
+    clearTiles();
+    std::fill(drawn, drawn + fields, -1);
 }
 
 void Board::drawStats(int steps, int points, bool gameOver, bool gameWon) {
-    mvprintw(cy-5, 3, "Round %d     ", steps);
-    mvprintw(cy-4, 3, "Points: %d     ", points);
-    mvprintw(cy-3, 3, "         ");
-    if (gameOver) mvprintw(cy-3, 3, "GAME OVER");
-    mvprintw(cy-2, 3, "                                               ");
-    if (gameWon) mvprintw(cy-2, 3, "You've reached 2048 and won! Yay!");
+    text(cy-5, 3, 0, "Round %d     ", steps);
+    text(cy-4, 3, 0, "Points: %d     ", points);
+    text(cy-3, 3, 0, "         ");
+    if (gameOver) text(cy-3, 3, 0, "GAME OVER");
+    text(cy-2, 3, 0, "                                               ");
+    if (gameWon) text(cy-2, 3, 0, "You've reached 2048 and won! Yay!");
+}
+
+void Board::drawAi(int hint, bool autoplay, double nodesPerSecond,
+        const char* unit) {
+    text(cy, 3, 0, "                                               ");
+    if (autoplay) {
+        text(cy, 3, 0, "Autoplay (%.0f %s/s)", nodesPerSecond, unit);
+    } else if (hint >= 0) {
+        text(cy, 3, 0, "Hint: %s (%.0f %s/s)", directionName(hint),
+             nodesPerSecond, unit);
+    }
+}
+
+void Board::drawOutcome(int move, float value, OutcomeTable::Kind kind) {
+    text(cy + 1, 3, 0, "                                               ");
+    if (move < 0) return;
+    if (kind == OutcomeTable::WIN) {
+        text(cy + 1, 3, 0, "Table: %s (win %.1f%%)", directionName(move),
+             100 * value);
+    } else {
+        text(cy + 1, 3, 0, "Table: %s (+%.0f points)", directionName(move),
+             value);
+    }
+}
+
+void Board::finishFrame() {
+    if (renderer == RENDER_ANSI) {
+        frameBytes = frame.flush(STDOUT_FILENO);
+        if (frameBytes < 0) return;
+        totalBytes += frameBytes;
+        frames++;
+        return;
+    }
+    if (!output) {
+        refresh();
+        frameBytes = -1;
+        return;
+    }
+    int64_t before = output->bytes();
+    refresh();
+    fflush(output->file());
+    frameBytes = output->bytes() - before;
+    totalBytes += frameBytes;
+    frames++;
+}
+
+double Board::meanFrameBytes() const {
+    if (frames == 0) return frameBytes;
+    return static_cast<double>(totalBytes) / frames;
 }
 
 Board::~Board() {
@@ -87,30 +429,25 @@ Board::~Board() {
 Game::Game() {
     run = true;
     maxUndo = 0;  // default undo limit.
-    steps = 0;  // set setp counter to 0.
-    gameOver = false;
-    gameWon = false;
-    points.push_back(0);
-
-    std::random_device rd;  // obtain a random number from hardware
-    std::mt19937 gen(rd());  // seed the generator
-    std::uniform_int_distribution<> distr(0, 15);  // define range
-
-    // get to random fields
-    int fieldOne = distr(gen);
-    int fieldTwo = distr(gen);
-
-
-    // Build the current state
-    std::vector<int> state(16, 0);
-    int field1 = randomField();
-    state[field1] = randomVal();
-    int field2 = randomField();
-    while (field2 == field1) field2 = randomField();
-    state[field2] = randomVal();
-
-    // Add the first state.
-    states.push_back(state);
+    simulate = 0;  // play interactively by default.
+    threads = 0;  // one simulation thread per core.
+    policy = "random";
+    hint = -1;
+    autoplay = false;
+    frameMs = 100;
+    renderer = Board::RENDER_CURSES;
+    animateMs = 0;
+    scriptFrameMs = -1;
+    size = 4;
+    metricsSeconds = 10;
+    rolloutMs = Policy::kRolloutMs;
+    searchMs = kSearchMs;
+    // a fresh seed for every game, unless --seed is given.
+    seed = freshSeed();
+    rng.seed(seed);
+
+    // Build the first state.
+    reset();
 }
 
 Game::~Game() {
@@ -119,171 +456,107 @@ Game::~Game() {
 
 // ___________________________________________________________________________
 bool Game::play(int key) {
+    METRIC_TIME(PLAY);
     // init the new state
-    std::vector<int> newState(16, 0);
+    Bitboard newState;
     // get the old state (last item in states)
-    std::vector<int> oldState = states.back();
+    Bitboard oldState = states.back();
 
     switch (key) {
-        case KEY_LEFT: if (!gameOver) updateState(newState, oldState, 1);
+        case KEY_LEFT: if (!gameOver) updateState(newState, oldState, LEFT);
         return true;
-        case KEY_RIGHT: if (!gameOver) updateState(newState, oldState, 2);
+        case KEY_RIGHT: if (!gameOver) updateState(newState, oldState, RIGHT);
         return true;
-        case KEY_UP: if (!gameOver) updateState(newState, oldState, 3);
+        case KEY_UP: if (!gameOver) updateState(newState, oldState, UP);
         return true;
-        case KEY_DOWN: if (!gameOver) updateState(newState, oldState, 4);
+        case KEY_DOWN: if (!gameOver) updateState(newState, oldState, DOWN);
         return true;
         case 'u': undo(); return true;
         case 27: run = false; return false;
-        case 'n': reset(); return true;
+        // a new game with a seed of its own, drawn from the generator, so
+        // the seed in its record reproduces it.
+        case 'n': restart(rng()); return true;
+        case 'h': hint = gameOver ? -1 : aiMove(oldState); return true;
+        case 'a': autoplay = !autoplay; return true;
     }
     return false;
 }
 
-void Game::updateState(std::vector<int> &newState, std::vector<int> &oldState,
-        const int move) {
-    // hash
-    std::vector<int> hashs;
+// ___________________________________________________________________________
+int Game::inputTimeout() const {
+    if (autoplay && !gameOver) return 0;
+    return frameMs;
+}
 
-    // depending on the move we have to consider a different slices of the
-    // board in different order. The numbers are used to get the relevant
-    // indices from hashLists, which stores each possible slice in a
-    // dictionary type data structure.
-    if ( move == 1 ) {
-        hashs = { 1, 2, 3, 4 };
-    }
-    if ( move == 2 ) {
-        hashs = { 5, 6, 7, 8 };
-    }
-    if ( move == 3 ) {
-        hashs = { 9, 10, 11, 12 };
-    }
-    if ( move == 4 ) {
-        hashs = { 13, 14, 15, 16 };
-    }
-    // update all the relevant slices.
-    for (const auto& idx : hashs) {
-        std::vector<int> hash = hashLists.at(idx);
-        updateSlice(newState, oldState, hash);
-    }
+bool Game::autoStep() {
+    if (!autoplay || gameOver) return false;
+    Bitboard oldState = states.back();
+    int move = aiMove(oldState);
+    if (move < 0) return false;
+    Bitboard newState;
+    updateState(newState, oldState, static_cast<Direction>(move));
+    return true;
+}
+
+void Game::updateState(Bitboard &newState, const Bitboard &oldState,
+        Direction move) {
+    METRIC_TIME(UPDATE_STATE);
+    // every row (or column for up and down) is moved by a table lookup,
+    // which also tells us the points gained by its merges.
+    int score = 0;
+    newState = MoveTables::move(oldState, move, &score);
 
     // only update if state was changed by click.
     if (newState != oldState) {
+        METRIC_COUNT(MOVES, 1);
+        hint = -1;
+        lastMove = move;
         steps += 1;
         undoCount = 0;
-        addRandom(newState);  // add a new random number (4/2)
-        states.push_back(newState);  // add the new state
-        gameOver = isGameOver();
-    }
-}
-
-void Game::updateSlice(std::vector<int> &newState, std::vector<int> &oldState,
-        std::vector<int> hash) {
-    // loop for first three elements
-    for (int i = 0; i < 4; i++) {
-        // ignore zeros.
-        if (oldState[hash[i]] == 0) continue;
-        // if we reached last field, always add it (if >0 obv.)
-        if (i == 3) {
-            insert(newState, oldState[hash[i]], hash);
-            break;
-        }
-        // loop over i+1 element to the fourth/last element.
-        for (int j = i+1; j < 4; j++) {
-            // if two numbers match, (i.e. when i=0, j=1 and oldState=2200)
-            // or when i=0, j=2 and oldState = 4040)
-            if (oldState[hash[i]] == oldState[hash[j]]) {
-                insert(newState, oldState[hash[i]] + oldState[hash[j]], hash);
-                points.push_back(points.back() +
-                oldState[hash[i]] + oldState[hash[j]]);
-                i = j;  // set i to j so at next loop i will be at j+1.
-                break;  // break the j-loop and continue i-loop at j+1.
-                // if ith and jth element don't match
-            } else {
-                // if jth element is not-zero, we have to add ith element.
-                if (oldState[hash[j]] > 0) {
-                    insert(newState, oldState[hash[i]], hash);
-                    break;
-                } else {
-                    // add ith ele. if jth element is zero but end is reached.
-                    if (j == 3) {
-                        insert(newState, oldState[hash[i]], hash);
-                    }
-                }
-            }
-        }
-    }
-}
-
-void Game::insert(std::vector<int> &state, int val, std::vector<int> hash) {
-    // insert value at lowest index possible.
-    for (int p = 0; p < 4; p++) {
-        if (state[hash[p]] == 0) {
-            state[hash[p]] = val;
-            break;
+        points += score;
+        int field = addRandom(newState);  // add a new random number (4/2)
+        if (recorder && field >= 0) {
+            recorder->move(move, field, newState.exponent(field) == 2);
         }
+        // keep maxUndo states to go back to (maxUndo may have changed).
+        states.setCapacity(maxUndo + 1);
+        states.push(newState, score);  // add the new state
+        gameOver = isGameOver();
     }
 }
 
 // check if no more moves are possible.
 bool Game::isGameOver() {
-    // first check if the board is even full.
-    bool boardFull = true;
-    for (int i = 0; i < 16; i++) {
-        // only set gameWon to true at first 2048.
-        if (states.back()[i] == 2048 && !gameWon) gameWon = true;
-        if (states.back()[i] == 0) {
-            boardFull = false;
-        }
-    }
-    if (boardFull) {
-        // check if any two neighboring (not diag.) tiles have same val.
-        bool stuck = true;
-        for (const auto& ct : coreTiles) {
-            if (states.back()[ct] == states.back()[ct-4] ||
-                states.back()[ct] == states.back()[ct+4] ||
-                states.back()[ct] == states.back()[ct+1] ||
-                states.back()[ct] == states.back()[ct-1]) {
-                stuck = false;
-            }
-        }
-        if (states.back()[0] == states.back()[1] ||
-            states.back()[0] == states.back()[4] ||
-            states.back()[3] == states.back()[2] ||
-            states.back()[3] == states.back()[7] ||
-            states.back()[12] == states.back()[13] ||
-            states.back()[12] == states.back()[8] ||
-            states.back()[15] == states.back()[14] ||
-            states.back()[15] == states.back()[11]) {
-            stuck = false;
-        }
-        return stuck;
-    } else {
-        return false;
-    }
+    METRIC_TIME(IS_GAME_OVER);
+    BoardSummary summary = MoveTables::summarize(states.back());
+    // gameWon stays true once 2048 (2^11) was reached.
+    if (summary.maxExponent >= 11) gameWon = true;
+    return summary.legalMoves == 0;
 }
 
-void Game::addRandom(std::vector<int> &state) {
-    int field;
-    while (true) {
-        std::uniform_int_distribution<> distr(0, 15);  // define range
-        // get to random fields
-        field = randomField();
-
-        // if found empty field we're done.
-        if (state[field] == 0) break;
+int Game::addRandom(Bitboard &state) {
+    METRIC_TIME(ADD_RANDOM);
+    // pick one of the empty fields directly, no retries needed.
+    int field = spawnTile(state, rng);
+    if (field < 0) {
+        METRIC_COUNT(SPAWN_FULL, 1);
+    } else {
+        METRIC_COUNT(SPAWNS, 1);
+        METRIC_COUNT(RNG_DRAWS, 2);
     }
-    state[field] = randomVal();
+    return field;
 }
 
 void Game::undo() {
     if (undoCount >= maxUndo) return;
-    if (states.size() <= 1) return;
+    // take back exactly the points of the undone move.
+    int score;
+    if (!states.pop(&score)) return;
     gameOver = false;
-    states.pop_back();
-    if (points.size() > 1) points.pop_back();
+    points -= score;
     steps--;
     undoCount++;
+    if (recorder) recorder->undo();
 }
 
 // _______________________________________________________________________
@@ -291,11 +564,34 @@ void Game::parseCommandLineArguments(int argc, char** argv) {
     struct option options[] = {
             { "max-undo", 1, NULL, 'u'},
             { "help", 1, NULL, 'h'},
+            { "simulate", 1, NULL, 's'},
+            { "threads", 1, NULL, 't'},
+            { "policy", 1, NULL, 'p'},
+            { "seed", 1, NULL, 'S'},
+            { "record", 1, NULL, 'r'},
+            { "frame-ms", 1, NULL, 'f'},
+            { "size", 1, NULL, 'x'},
+            { "serve", 1, NULL, 'v'},
+            { "metrics-file", 1, NULL, 'm'},
+            { "metrics-every", 1, NULL, 'M'},
+            { "rollout-ms", 1, NULL, 'R'},
+            { "search-ms", 1, NULL, 'b'},
+            { "table", 1, NULL, 'T'},
+            { "renderer", 1, NULL, 'e'},
+            { "animate-ms", 1, NULL, 'A'},
+            { "script", 1, NULL, 'i'},
+            { "script-frame-ms", 1, NULL, 'F'},
+            { "snapshot", 1, NULL, 'K'},
             { NULL, 0, NULL, 0 }
     };
+    std::string recordPath;
+    std::string tablePath;
+    std::string snapshotPath;
     optind = 1;
     while (true) {
-        char c = getopt_long(argc, argv, "u:h", options, NULL);
+        char c = getopt_long(argc, argv,
+                             "u:hs:t:p:S:r:f:x:v:m:M:R:b:T:e:A:i:F:K:",
+                             options, NULL);
         if (c == -1) break;
         switch (c) {
             case 'u':
@@ -304,61 +600,195 @@ void Game::parseCommandLineArguments(int argc, char** argv) {
             case 'h':
                 printUsageAndExit();
                 break;
+            case 's':
+                simulate = atoll(optarg);
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'p':
+                policy = optarg;
+                break;
+            case 'S':
+                // replay the game from the start with the given seed.
+                restart(strtoull(optarg, NULL, 10));
+                break;
+            case 'r':
+                recordPath = optarg;
+                break;
+            case 'f':
+                frameMs = atoi(optarg);
+                break;
+            case 'x':
+                size = atoi(optarg);
+                break;
+            case 'v':
+                serve = optarg;
+                break;
+            case 'm':
+                metricsFile = optarg;
+                break;
+            case 'M':
+                metricsSeconds = atof(optarg);
+                break;
+            case 'R':
+                rolloutMs = atof(optarg);
+                break;
+            case 'b':
+                searchMs = atof(optarg);
+                break;
+            case 'T':
+                tablePath = optarg;
+                break;
+            case 'e':
+                if (std::string(optarg) == "ansi") {
+                    renderer = Board::RENDER_ANSI;
+                } else if (std::string(optarg) == "curses") {
+                    renderer = Board::RENDER_CURSES;
+                } else {
+                    std::cerr << "Unknown renderer " << optarg << "\n";
+                    exit(1);
+                }
+                break;
+            case 'A':
+                animateMs = atoi(optarg);
+                break;
+            case 'i':
+                script = optarg;
+                break;
+            case 'F':
+                scriptFrameMs = atoi(optarg);
+                break;
+            case 'K':
+                snapshotPath = optarg;
+                break;
+        }
+    }
+    // a saved game replaces the new one before it is recorded.
+    if (!snapshotPath.empty()) {
+        if (Snapshot::load(snapshotPath, this) < 0) {
+            std::cerr << "Cannot resume from snapshot " << snapshotPath
+                      << "\n";
+            exit(1);
+        }
+        snapshots = std::make_shared<SnapshotWriter>(snapshotPath);
+    }
+    if (!recordPath.empty()) {
+        recorder = std::make_shared<GameRecordWriter>();
+        if (!recorder->open(recordPath)) {
+            std::cerr << "Cannot open record file " << recordPath << "\n";
+            exit(1);
+        }
+        // the first state was set up before the recorder existed. A
+        // resumed game brings its undo window along: the record starts at
+        // its oldest state and has the moves to the newest, so undos into
+        // the window replay as well (behind a pair of states no move
+        // leads between, if any).
+        Direction dir;
+        int field;
+        bool four;
+        size_t first = 0;
+        for (size_t i = 1; i < states.size(); i++) {
+            if (!GameRecord::findMove(states[i - 1], states[i], &dir, &field,
+                                      &four)) {
+                first = i;
+            }
+        }
+        recorder->beginGame(seed, states[first]);
+        for (size_t i = first + 1; i < states.size(); i++) {
+            GameRecord::findMove(states[i - 1], states[i], &dir, &field,
+                                 &four);
+            recorder->move(dir, field, four);
+        }
+    }
+    if (!tablePath.empty()) {
+        table = std::make_shared<OutcomeTable>();
+        if (!table->open(tablePath)) {
+            std::cerr << "Cannot open outcome table " << tablePath << "\n";
+            exit(1);
         }
     }
 }
 
+// ___________________________________________________________________________
+int Game::aiMove(const Bitboard &board) {
+    if (table) {
+        float value;
+        int move = table->bestMove(Grid<4>(board), &value);
+        if (move >= 0) return move;
+    }
+    // the rollout threads start with the first move they are asked for.
+    MonteCarlo::Rollout rollout;
+    if (!rollouts && MonteCarlo::parsePolicy(policy, &rollout)) {
+        rollouts = std::make_shared<MonteCarlo>(rolloutMs, threads, rollout);
+    }
+    if (rollouts) return rollouts->bestMove(board);
+    if (!search) search = std::make_shared<ParallelExpectimax>(0, threads);
+    return search->bestMove(board, searchMs);
+}
+
+// ___________________________________________________________________________
+GameState Game::current() const {
+    GameState state = { states.back(), points, steps, gameOver, gameWon };
+    return state;
+}
+
+// ___________________________________________________________________________
+void Game::restart(uint64_t seed) {
+    this->seed = seed;
+    rng.seed(seed);
+    reset();
+}
+
 void Game::reset() {
     run = true;
+    lastMove = -1;
     steps = 0;  // set setp counter to 0.
+    undoCount = 0;
     gameOver = false;
     gameWon = false;
-    points.clear();
-    points.push_back(0);
+    points = 0;
 
-    // Build the current state
-    std::vector<int> state(16, 0);
-    int field1 = randomField();
-    state[field1] = randomVal();
-    int field2 = randomField();
-    while (field2 == field1) field2 = randomField();
-    state[field2] = randomVal();
+    // Build the current state from two random tiles.
+    Bitboard state;
+    addRandom(state);
+    addRandom(state);
 
-    // clear
-    states.clear();
-    // Add the first state.
-    states.push_back(state);
+    // Start the history with the first state.
+    states.setCapacity(maxUndo + 1);
+    states.clear(state);
+    if (recorder) recorder->beginGame(seed, state);
 }
 
 const int Game::randomField() {
-    std::random_device rd;  // obtain a random number from hardware
-    std::mt19937 gen(rd());  // seed the generator
-    std::uniform_int_distribution<> distr(0, 15);  // define range
-
-    int field;
-    field = distr(gen);
-    return field;
+    return rng.below(16);
 }
 
 const int Game::randomVal() {
-    std::random_device rd;  // obtain a random number from hardware
-    std::mt19937 gen(rd());  // seed the generator
-
-    std::uniform_int_distribution<> distr(1, 10);  // redefine range
-
-    // random numbers to be put into the two fields.
-    int num;
-
     // 4 has 10% prob, 2 has 90% prob.
-    int rand = distr(gen);
-    if (rand == 10) {
-        num = 4;
-    } else {
-        num = 2;
-    }
-    return num;
+    return rng.below(10) == 0 ? 4 : 2;
 }
 
 const void Game::printUsageAndExit() {
-    std::cout << "Usage: Game2048Main [optional] max-undo [-u]\nDefault = 1.\n";
+    std::cout << "Usage: Game2048Main [optional] max-undo [-u]\nDefault = 1.\n"
+              << "Headless: Game2048Main --simulate N [--threads T] "
+              << "[--policy random|greedy|corner|expectimax|montecarlo|"
+              << "montecarlo-greedy] [--rollout-ms MS] [--seed S]\n"
+              << "Autoplay and hints use --policy montecarlo(-greedy) too, "
+              << "else expectimax on --threads T for --search-ms MS "
+              << "(default 50)\n"
+              << "Record games: Game2048Main --record FILE\n"
+              << "Input timeout: --frame-ms MS (default 100, -1 = none)\n"
+              << "Drawing: --renderer curses|ansi (default curses) "
+              << "[--animate-ms MS]\n"
+              << "Board size: --size N (3 to 8, default 4)\n"
+              << "Scripted keys: Game2048Main --script FILE|- "
+              << "[--script-frame-ms MS] [--seed S]\n"
+              << "Serve games: Game2048Main --serve SOCKET|- "
+              << "[--max-undo N]\n"
+              << "Save and resume the game: --snapshot FILE\n"
+              << "Outcome table for hints and autoplay: --table FILE "
+              << "(see OutcomeTableMain)\n"
+              << "Metrics: --metrics-file FILE[.json] [--metrics-every SEC]"
+              << " (needs make METRICS=1)\n";
 }
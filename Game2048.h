@@ -6,37 +6,142 @@
 
 #include <getopt.h>
 #include <gtest/gtest.h>
+#include <termios.h>
 #include <vector>
 #include <utility>
-#include <unordered_map>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <string>
+#include "./Bitboard.h"
+#include "./Expectimax.h"
+#include "./FrameBuffer.h"
+#include "./GameRecord.h"
+#include "./GameState.h"
+#include "./History.h"
+#include "./MonteCarlo.h"
+#include "./MoveTables.h"
+#include "./OutcomeTable.h"
+#include "./ParallelSearch.h"
+#include "./Random.h"
+
+class CountingOutput;
+class SnapshotWriter;
 
 // Class for visual representation of the game.
 class Board {
  public:
-    // A default constructor.
-    Board();
+    // How frames reach the terminal: through ncurses, or composed in a
+    // FrameBuffer and sent as ANSI escape sequences in one write() (keys
+    // are then read from the terminal in raw mode, without ncurses).
+    enum Renderer { RENDER_CURSES = 0, RENDER_ANSI = 1 };
+
+    // A board of size x size tiles (4x4 by default).
+    explicit Board(int size = 4, Renderer renderer = RENDER_CURSES);
 
     // Destructor.
     ~Board();
 
     void initialize();
 
-    // Draw the input state on the board.
-    void drawBoard(std::vector<int> state);
+    // Give the terminal back (as it was before initialize()).
+    void finish();
+
+    // The next key, with the arrows as KEY_LEFT etc. like getch(), or ERR
+    // if none is pressed within the input timeout (or for escape
+    // sequences of other keys).
+    int readKey();
+
+    // Read the keys of the ANSI renderer from fd instead of stdin.
+    void setInputFd(int fd) { inputFd = fd; }
+
+    // Draw the input state on the board. Only the tiles that differ from
+    // the last drawn state are painted again.
+    void drawBoard(const Bitboard &state);
+
+    // The same for the boards of other sizes (see Grid.h).
+    template <class G>
+    void drawGrid(const G &grid) {
+        for (int i = 0; i < G::kFields; i++) drawField(i, grid.exponent(i));
+    }
 
     void drawStats(int steps, int points, bool gameOver, bool gameWon);
 
- private:
-    friend class Game;
-    std::vector<std::pair<int, int>> tileCoords;
+    // Show the AI's suggested move (none if hint < 0), whether it plays by
+    // itself and how fast it searches (in units, e.g. nodes, per second).
+    void drawAi(int hint, bool autoplay, double nodesPerSecond,
+                const char* unit = "nodes");
+
+    // Show the best move by an outcome table and its value, a win
+    // probability or expected points (nothing if move < 0).
+    void drawOutcome(int move, float value, OutcomeTable::Kind kind);
 
-    // Helper function for update_board: "Animate" the movement of the tiles to
-    // interpolate the old and the new state in an aesthetically pleasing way.
-    void moveTiles();
+    // Let readKey() wait up to ms milliseconds for a key (forever if
+    // negative) before it returns ERR.
+    void setInputTimeout(int ms);
 
-    void drawTile(std::pair<int, int> coords);
+    // Send everything drawn since the last frame to the terminal in one
+    // refresh (or write) and count the bytes that took.
+    void finishFrame();
+
+    // Animate a move: slide the tiles of before in direction dir to where
+    // the move takes them, in frames spread over ms milliseconds. The
+    // next drawBoard() draws all fields again, merged and with the new
+    // tile.
+    void moveTiles(const Bitboard &before, Direction dir, int ms);
+
+    // Bytes sent to the terminal by the last frame and on average per
+    // frame (-1 if ncurses writes to it uncounted, see initialize()).
+    int64_t lastFrameBytes() const { return frameBytes; }
+    double meanFrameBytes() const;
+
+ private:
+    friend class Game;
+    // center of every tile relative to the terminal center (row, column).
+    std::pair<int, int> tileCoords[64];
+
+    // Draw a tile (with its number) centered at coords.
+    void drawTile(std::pair<int, int> coords, int exponent);
+
+    // Blank the rectangle the tiles are drawn in.
+    void clearTiles();
+
+    // The primitives all drawing goes through, to ncurses or the frame:
+    // n blanks, and formatted text, in a color pair (0 = default colors).
+    void fillLine(int y, int x, int n, int pair);
+    void text(int y, int x, int pair, const char* format, ...);
+
+    // Draw the tile of a field, unless it is already on screen.
+    void drawField(int field, int exponent);
+
+    // the exponents on screen (-1 if a field must be drawn anyway, as in
+    // the first frame), for boards up to 8x8.
+    int drawn[64];
+    int fields;
+
+    // the timeout readKey() currently uses.
+    int inputTimeout;
+
+    Renderer renderer;
+    // the screen of the ANSI renderer, and the terminal settings to
+    // restore if readKey() switched it to raw mode.
+    FrameBuffer frame;
+    struct termios savedTerminal;
+    bool rawTerminal;
+    // bytes read from the terminal but not yet returned by readKey().
+    int inputFd;
+    char keys[64];
+    int numKeys;
+
+    // the screen of ncurses and the output it writes the terminal
+    // through (NULL until initialize() and after finish()).
+    struct screen* screen;
+    std::shared_ptr<CountingOutput> output;
+
+    // bytes of the last frame, all frames and their number.
+    int64_t frameBytes;
+    int64_t totalBytes;
+    int64_t frames;
 
     // center coordinates of terminal
     int cx;
@@ -48,17 +153,18 @@ class Board {
 
     int exp(int base, int expo);
 
-    // predefine color-palette (131072 is max possible tile value in 4x4
-    std::unordered_map<int, int> const colors
-        {{ 0, 231 }, { 2, 230 },
-        { 4, 228 }, { 8, 220 },
-        { 16, 215 }, { 32, 202 },
-        { 64, 169 }, { 128, 221 },
-        { 256, 214 }, { 512, 178 },
-        { 1024, 172 }, { 2048, 136 },
-        { 4096, 236 }, { 8192, 236 },
-        { 16384, 236 }, { 32768, 236 },
-        { 65536, 236 }, { 131072, 236 }
+    // color pairs of a tile with the given exponent and of its number,
+    // allocated once in initialize().
+    static int tilePair(int exponent) { return 1 + exponent; }
+    static int numberPair(int exponent) { return 1 + 32 + exponent; }
+    // the colors of a pair (-1 = default), as the ANSI renderer needs them.
+    static void pairColors(int pair, int* fg, int* bg);
+
+    // predefine color-palette by exponent, shared by all boards (131072
+    // is max possible tile value in 4x4, larger tiles use its color)
+    static constexpr int kColors[18] = {
+        231, 230, 228, 220, 215, 202, 169, 221, 214, 178, 172, 136,
+        236, 236, 236, 236, 236, 236
     };
 };
 
@@ -76,7 +182,7 @@ class Game {
     int steps;
 
     // Count points.
-    std::vector<int> points;
+    int points;
 
     bool gameOver;
 
@@ -85,10 +191,60 @@ class Game {
     // core function that takes user input and advances the game.
     bool play(int key);
 
-    // Keep a reference to all the states that existed during the game.
-    // to inner vectors each represent one state. Whenever the player
-    // makes a move, we append the new state as a vector to the end.
-    std::vector<std::vector<int>> states;
+    // If autoplay is on, let the AI make one move. Returns true if the
+    // game changed.
+    bool autoStep();
+
+    // Move suggested by the AI after pressing 'h' (-1 = no hint).
+    int hint;
+
+    // Let the AI play by itself (toggled by 'a').
+    bool autoplay;
+
+    // Board size (--size, 3 to 8). Everything but 4x4 is played by
+    // GridGame without AI, records and simulation.
+    int size;
+
+    // How the game is drawn (--renderer curses|ansi), and how long moves
+    // are animated in ms (--animate-ms, 0 = not at all).
+    Board::Renderer renderer;
+    int animateMs;
+
+    // Direction of the last move that changed the board (-1 if none was
+    // made since the game started).
+    int lastMove;
+
+    // Longest wait for a key in ms (--frame-ms), i.e. the frame budget
+    // of the input loop. Negative: wait until a key is pressed.
+    int frameMs;
+
+    // How long the input loop may wait for the next key: not at all while
+    // the AI plays, else frameMs.
+    int inputTimeout() const;
+
+    // Expectimax search behind hints and autoplay: on --threads threads
+    // (0 = all cores), deepening until --search-ms per move are used up.
+    // NULL until the first AI move; shared, so copies of the game do not
+    // start threads of their own.
+    std::shared_ptr<ParallelExpectimax> search;
+    double searchMs;
+    static constexpr double kSearchMs = 50;
+
+    // Monte Carlo rollouts used instead of search if --policy names them
+    // (--rollout-ms per move, --threads threads), NULL until the first AI
+    // move. Shared, so copies of the game do not start threads of their
+    // own.
+    std::shared_ptr<MonteCarlo> rollouts;
+    double rolloutMs;
+
+    // Solved positions (--table, see OutcomeTable), NULL if none. Hints
+    // and autoplay take their moves as long as the position is in it.
+    std::shared_ptr<OutcomeTable> table;
+
+    // The last maxUndo + 1 states of the game, each a packed Bitboard with
+    // the points its move scored. Whenever the player makes a move, we
+    // append the new state to the end (dropping the oldest if full).
+    History states;
 
     void parseCommandLineArguments(int argc, char** argv);
 
@@ -96,6 +252,47 @@ class Game {
 
     bool run;
 
+    // Options of the headless simulation mode. simulate is the number of
+    // games to play without ncurses (0 = play interactively).
+    int64_t simulate;
+    int threads;
+    std::string policy;
+
+    // Seed of the game's random number generator (--seed). Random by
+    // default; the same seed and the same keys give the same game. A new
+    // game ('n') draws its seed from the generator.
+    uint64_t seed;
+
+    // Serve many headless games instead of playing one (--serve): on the
+    // Unix domain socket at this path, or on stdin/stdout if it is "-".
+    std::string serve;
+
+    // Play the keys of this file ("-": stdin) instead of the keyboard
+    // (--script, see ScriptPlayer), drawing at most every scriptFrameMs
+    // (--script-frame-ms, negative: not at all).
+    std::string script;
+    int scriptFrameMs;
+
+    // Where the hot path metrics are dumped to (--metrics-file, JSON if
+    // the name ends in ".json"), every metricsSeconds (--metrics-every)
+    // and at exit. Empty if not dumped.
+    std::string metricsFile;
+    double metricsSeconds;
+
+    // The current state as a plain value, e.g. to explore moves on.
+    GameState current() const;
+
+    // Start a new game with the given seed (like --seed).
+    void restart(uint64_t seed);
+
+    // Where the game is recorded to (--record), NULL if not recorded.
+    // Shared, so a copy of the game appends to the same record.
+    std::shared_ptr<GameRecordWriter> recorder;
+
+    // Where the game is saved to after every move (--snapshot, resumed
+    // from there at start), NULL if it is not. See Snapshot.
+    std::shared_ptr<SnapshotWriter> snapshots;
+
  private:
     FRIEND_TEST(Game2048Test, constructor);
     FRIEND_TEST(Game2048Test, play);
@@ -105,34 +302,29 @@ class Game {
     FRIEND_TEST(Game2048Test, reset);
     FRIEND_TEST(Game2048Test, isGameOver);
     FRIEND_TEST(Game2048Test, gameWon);
+    FRIEND_TEST(Game2048Test, seed);
+    FRIEND_TEST(Game2048Test, ai);
+    FRIEND_TEST(Game2048Test, undoExact);
+    // the microbenchmarks time the private steps of a move.
+    friend class Game2048Bench;
+    // a snapshot holds all of the game, the generator included.
+    friend class Snapshot;
 
     int undoCount;
 
+    // generator for all random decisions of this game (fields and values).
+    Xoshiro256 rng;
+
     // reference to the board.
     Board board;
 
-    // the hashlists needed for each move (up, down, right, left).
-    std::unordered_map<int, std::vector<int>> const hashLists {
-            { 1, { 0, 1, 2, 3 } }, { 2, { 4, 5, 6, 7 } },
-            { 3, { 8, 9, 10, 11 } }, { 4, { 12, 13, 14, 15 } },
-            { 5, { 3, 2, 1, 0 } }, { 6, { 7, 6, 5, 4 } },
-            { 7, { 11, 10, 9, 8 } }, { 8, { 15, 14, 13, 12 } },
-            { 9, { 0, 4, 8, 12 } }, { 10, { 1, 5, 9, 13 } },
-            { 11, { 2, 6, 10, 14 } }, { 12, { 3, 7, 11, 15 } },
-            { 13, { 12, 8, 4, 0 } }, { 14, { 13, 9, 5, 1 } },
-            { 15, { 14, 10, 6, 2 } }, { 16, { 15, 11, 7, 3 } },
-    };
-
-    // function for each possible move.
-    void updateState(std::vector<int> &newState, std::vector<int> &oldState,
-            const int move);
-
-    void updateSlice(std::vector<int> &newState, std::vector<int> &oldState,
-            std::vector<int> hash);
+    // apply a move to oldState (using the precomputed MoveTables) and store
+    // the result in newState. If the board changed, this counts as a step.
+    void updateState(Bitboard &newState, const Bitboard &oldState,
+            Direction move);
 
-    void insert(std::vector<int> &state, int val, std::vector<int> hash);
-
-    void addRandom(std::vector<int> &state);
+    // add a 2 or a 4 on an empty field and return that field (-1 if full).
+    int addRandom(Bitboard &state);
 
     const int randomField();
 
@@ -142,11 +334,13 @@ class Game {
 
     void undo();
 
+    // The move of the AI (rollouts or ai) for a board, -1 if none.
+    int aiMove(const Bitboard &board);
+
     void reset();
 
+    // also sets gameWon once a 2048 tile is on the board.
     bool isGameOver();
-
-    const std::vector<int> coreTiles { 5, 6, 9, 10 };
 };
 
 #endif  // GAME2048_H_
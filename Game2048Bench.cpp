@@ -0,0 +1,500 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <ncurses.h>
+#include <term.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "./BatchMove.h"
+#include "./Game2048.h"
+#include "./GameState.h"
+#include "./Grid.h"
+#include "./MoveTables.h"
+#include "./Random.h"
+#include "./Spawn.h"
+
+// Microbenchmarks of the game core and the renderer on a fixed corpus of
+// boards. Every benchmark reports ns/op, heap allocations/op and ops/s
+// (for the moves, moves/s). The results can be saved to a baseline file
+// and later runs compared against it to catch regressions:
+//
+//   Game2048Bench --save Game2048Bench.baseline
+//   Game2048Bench --compare Game2048Bench.baseline  (what "make bench" does)
+
+namespace {
+// heap allocations so far, counted by the operators new below.
+int64_t allocations = 0;
+}  // namespace
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+namespace {
+struct BenchResult {
+    std::string name;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+// Boards reached in random games with a fixed seed, so every run (and
+// every machine) times the same positions.
+std::vector<Bitboard> buildCorpus(size_t size) {
+    std::vector<Bitboard> corpus;
+    Xoshiro256 rng(2020);
+    Bitboard board;
+    spawnTile(board, rng);
+    spawnTile(board, rng);
+    while (corpus.size() < size) {
+        corpus.push_back(board);
+        Bitboard next = MoveTables::move(board,
+                static_cast<Direction>(rng.below(4)), NULL);
+        if (next == board) {
+            // try all directions before starting a new game.
+            bool moved = false;
+            for (int dir = 0; dir < 4 && !moved; dir++) {
+                next = MoveTables::move(board, static_cast<Direction>(dir),
+                                        NULL);
+                moved = next != board;
+            }
+            if (!moved) {
+                next = Bitboard();
+                spawnTile(next, rng);
+            }
+        }
+        spawnTile(next, rng);
+        board = next;
+    }
+    return corpus;
+}
+
+// Time body(iterations) in 7 rounds of at least 20 ms each and keep the
+// median round: a single fast or slow round (a lucky cache, a preempted
+// thread) does not move it. body returns a checksum so the compiler
+// cannot drop the work.
+BenchResult measure(const std::string &name,
+        const std::function<uint64_t(int64_t)> &body) {
+    static volatile uint64_t sink;
+    int64_t iterations = 1;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        sink = sink + body(iterations);
+        std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+        if (elapsed.count() >= 0.02) break;
+        iterations *= 2;
+    }
+    BenchResult result = { name, 0, 0 };
+    std::vector<double> rounds;
+    for (int round = 0; round < 7; round++) {
+        int64_t before = allocations;
+        auto start = std::chrono::steady_clock::now();
+        sink = sink + body(iterations);
+        std::chrono::duration<double, std::nano> elapsed =
+                std::chrono::steady_clock::now() - start;
+        rounds.push_back(elapsed.count() / iterations);
+        result.allocsPerOp = double(allocations - before) / iterations;
+    }
+    std::sort(rounds.begin(), rounds.end());
+    result.nsPerOp = rounds[rounds.size() / 2];
+    return result;
+}
+
+std::map<std::string, BenchResult> readBaseline(const std::string &path) {
+    std::map<std::string, BenchResult> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        BenchResult result;
+        std::istringstream fields(line);
+        if (fields >> result.name >> result.nsPerOp >> result.allocsPerOp) {
+            baseline[result.name] = result;
+        }
+    }
+    return baseline;
+}
+
+bool writeBaseline(const std::string &path,
+        const std::vector<BenchResult> &results) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "# benchmark ns/op allocs/op\n";
+    for (const auto& result : results) {
+        out << result.name << " " << result.nsPerOp << " "
+            << result.allocsPerOp << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+void printUsageAndExit() {
+    std::cout << "Usage: Game2048Bench [--save FILE] [--compare FILE]"
+              << " [--tolerance PERCENT] [--min-ns NS] [--filter NAME]\n"
+              << "A baseline only holds on the machine that saved it.\n";
+    exit(1);
+}
+}  // namespace
+
+// Has access to the private parts of Game (see Game2048.h).
+class Game2048Bench {
+ public:
+    explicit Game2048Bench(const std::vector<Bitboard> &corpus)
+        : corpus(corpus), mask(corpus.size() - 1), dirs(corpus.size()),
+          out(corpus.size()), scores(corpus.size()),
+          changed(corpus.size() / 64) {
+        for (size_t i = 0; i < corpus.size(); i++) {
+            dirs[i] = static_cast<Direction>(i & 3);
+        }
+    }
+
+    // BatchMove::move with the given kernel on the whole corpus at a time.
+    uint64_t batchMove(BatchMove::Kernel kernel, int64_t n) {
+        BatchMove::Kernel before = BatchMove::kernel();
+        BatchMove::setKernel(kernel);
+        uint64_t sum = 0;
+        for (int64_t done = 0; done < n; done += corpus.size()) {
+            size_t batch = std::min<int64_t>(n - done, corpus.size());
+            BatchMove::move(corpus.data(), dirs.data(), batch, out.data(),
+                            scores.data(), changed.data());
+            sum += out[0].bits + scores[0] + changed[0];
+        }
+        BatchMove::setKernel(before);
+        return sum;
+    }
+
+    uint64_t moveTables(int64_t n) {
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) {
+            sum += MoveTables::move(corpus[i & mask],
+                    static_cast<Direction>(i & 3), NULL).bits;
+        }
+        return sum;
+    }
+
+    // MoveTables::move through Grid<N>, on the corpus boards put into the
+    // top left corner of the larger grids.
+    template <int N>
+    uint64_t gridMove(int64_t n) {
+        static std::vector<Grid<N>> grids;
+        if (grids.empty()) {
+            for (const auto& board : corpus) {
+                Grid<N> grid;
+                for (int i = 0; i < 16; i++) {
+                    grid.setExponent(i / 4 * N + i % 4, board.exponent(i));
+                }
+                grids.push_back(grid);
+            }
+        }
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) {
+            sum += Grid<N>::move(grids[i & mask],
+                    static_cast<Direction>(i & 3), NULL).exponent(0);
+        }
+        return sum;
+    }
+
+    uint64_t summarize(int64_t n) {
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) {
+            BoardSummary summary = MoveTables::summarize(corpus[i & mask]);
+            sum += summary.legalMoves + summary.maxExponent + summary.empty;
+        }
+        return sum;
+    }
+
+    uint64_t updateState(int64_t n) {
+        Game game;
+        game.maxUndo = 4;
+        uint64_t sum = 0;
+        Bitboard newState;
+        for (int64_t i = 0; i < n; i++) {
+            game.updateState(newState, corpus[i & mask],
+                    static_cast<Direction>(i & 3));
+            sum += newState.bits;
+        }
+        return sum;
+    }
+
+    uint64_t isGameOver(int64_t n) {
+        Game game;
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) {
+            game.states.back() = corpus[i & mask];
+            sum += game.isGameOver();
+        }
+        return sum;
+    }
+
+    uint64_t addRandom(int64_t n) {
+        Game game;
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) {
+            Bitboard board = corpus[i & mask];
+            sum += game.addRandom(board);
+        }
+        return sum;
+    }
+
+    uint64_t randomField(int64_t n) {
+        Game game;
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) sum += game.randomField();
+        return sum;
+    }
+
+    uint64_t construct(int64_t n) {
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) {
+            Game game;
+            sum += game.states.back().bits;
+        }
+        return sum;
+    }
+
+    // a new game as a plain value, the counterpart of construct().
+    uint64_t startState(int64_t n) {
+        Xoshiro256 rng(1);
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) {
+            sum += GameState::start(rng).board.bits;
+        }
+        return sum;
+    }
+
+    // one step (move, spawn, flags) on a copy of a state.
+    uint64_t playState(int64_t n) {
+        Xoshiro256 rng(1);
+        uint64_t sum = 0;
+        for (int64_t i = 0; i < n; i++) {
+            GameState state = GameState::fromBoard(corpus[i & mask]);
+            sum += GameState::play(state, static_cast<Direction>(i & 3),
+                                   rng).board.bits;
+        }
+        return sum;
+    }
+
+    // board must be initialized; render also sends the frame to the
+    // terminal.
+    uint64_t drawBoard(Board* board, int64_t n, bool render) {
+        for (int64_t i = 0; i < n; i++) {
+            board->drawBoard(corpus[i & mask]);
+            if (render) board->finishFrame();
+        }
+        return n;
+    }
+
+ private:
+    const std::vector<Bitboard> &corpus;
+    // the corpus size is a power of two.
+    size_t mask;
+    // inputs and outputs of the batch moves.
+    std::vector<Direction> dirs;
+    std::vector<Bitboard> out;
+    std::vector<int> scores;
+    std::vector<uint64_t> changed;
+};
+
+int main(int argc, char** argv) {
+    std::string savePath;
+    std::string comparePath;
+    double tolerance = 30;
+    // a regression must also cost this many ns/op: the fastest ops take
+    // a few ns, where 30% is within the noise of a busy machine.
+    double minNs = 2;
+    std::string filter;
+    struct option options[] = {
+            { "save", 1, NULL, 's'},
+            { "compare", 1, NULL, 'c'},
+            { "tolerance", 1, NULL, 't'},
+            { "min-ns", 1, NULL, 'n'},
+            { "filter", 1, NULL, 'f'},
+            { "help", 0, NULL, 'h'},
+            { NULL, 0, NULL, 0 }
+    };
+    while (true) {
+        int c = getopt_long(argc, argv, "s:c:t:n:f:h", options, NULL);
+        if (c == -1) break;
+        switch (c) {
+            case 's': savePath = optarg; break;
+            case 'c': comparePath = optarg; break;
+            case 't': tolerance = atof(optarg); break;
+            case 'n': minNs = atof(optarg); break;
+            case 'f': filter = optarg; break;
+            default: printUsageAndExit();
+        }
+    }
+
+    std::vector<Bitboard> corpus = buildCorpus(1 << 12);
+    Game2048Bench bench(corpus);
+    using std::placeholders::_1;
+    std::vector<std::pair<std::string, std::function<uint64_t(int64_t)>>>
+        cases = {
+            { "MoveTables::move",
+              std::bind(&Game2048Bench::moveTables, &bench, _1) },
+            { "MoveTables::summarize",
+              std::bind(&Game2048Bench::summarize, &bench, _1) },
+            { "Grid<3>::move",
+              std::bind(&Game2048Bench::gridMove<3>, &bench, _1) },
+            { "Grid<4>::move",
+              std::bind(&Game2048Bench::gridMove<4>, &bench, _1) },
+            { "Grid<8>::move",
+              std::bind(&Game2048Bench::gridMove<8>, &bench, _1) },
+            { "Game::updateState",
+              std::bind(&Game2048Bench::updateState, &bench, _1) },
+            { "Game::isGameOver",
+              std::bind(&Game2048Bench::isGameOver, &bench, _1) },
+            { "Game::addRandom",
+              std::bind(&Game2048Bench::addRandom, &bench, _1) },
+            { "Game::randomField",
+              std::bind(&Game2048Bench::randomField, &bench, _1) },
+            { "Game::Game", std::bind(&Game2048Bench::construct, &bench, _1) },
+            { "GameState::start",
+              std::bind(&Game2048Bench::startState, &bench, _1) },
+            { "GameState::play",
+              std::bind(&Game2048Bench::playState, &bench, _1) },
+    };
+
+    // the batch moves with every kernel this CPU has.
+    for (int k = BatchMove::SCALAR; k <= BatchMove::AVX2; k++) {
+        BatchMove::Kernel kernel = static_cast<BatchMove::Kernel>(k);
+        if (!BatchMove::supported(kernel)) continue;
+        cases.push_back(std::make_pair(
+                std::string("BatchMove::") + BatchMove::kernelName(kernel),
+                std::bind(&Game2048Bench::batchMove, &bench, kernel, _1)));
+    }
+
+    std::vector<BenchResult> results;
+    for (const auto& c : cases) {
+        if (c.first.find(filter) == std::string::npos) continue;
+        results.push_back(measure(c.first, c.second));
+    }
+
+    // the renderers draw into a terminal on /dev/null, so no real screen
+    // is needed (only the terminfo entry for ncurses). Both get the 256
+    // color palette of the game: with 8 colors, ncurses maps all tiles to
+    // the same pair and sends far fewer bytes than on a real terminal.
+    double renderBytes = -1;
+    double ansiBytes = -1;
+    if (std::string("Board::drawBoard").find(filter) != std::string::npos ||
+        std::string("Board::render").find(filter) != std::string::npos ||
+        std::string("Board::renderAnsi").find(filter) != std::string::npos) {
+        setenv("TERM", "xterm-256color", 1);
+        int error;
+        int saved = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        std::cout.flush();
+        dup2(null, STDOUT_FILENO);
+        if (setupterm(NULL, STDOUT_FILENO, &error) == OK) {
+            Board board;
+            board.initialize();
+            results.push_back(measure("Board::drawBoard",
+                    std::bind(&Game2048Bench::drawBoard, &bench, &board, _1,
+                              false)));
+            results.push_back(measure("Board::render",
+                    std::bind(&Game2048Bench::drawBoard, &bench, &board, _1,
+                              true)));
+            board.finish();
+            renderBytes = board.meanFrameBytes();
+        }
+        Board ansi(4, Board::RENDER_ANSI);
+        ansi.initialize();
+        results.push_back(measure("Board::renderAnsi",
+                std::bind(&Game2048Bench::drawBoard, &bench, &ansi, _1,
+                          true)));
+        ansi.finish();
+        ansiBytes = ansi.meanFrameBytes();
+        fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        close(null);
+        close(saved);
+    }
+
+    std::map<std::string, BenchResult> baseline;
+    if (!comparePath.empty()) {
+        baseline = readBaseline(comparePath);
+        if (baseline.empty()) {
+            std::cout << "No baseline in " << comparePath
+                      << " (create one with --save)\n";
+        }
+    }
+
+    int regressions = 0;
+    std::cout << std::left << std::setw(22) << "benchmark" << std::right
+              << std::setw(12) << "ns/op" << std::setw(12) << "allocs/op"
+              << std::setw(14) << "ops/s";
+    if (!baseline.empty()) std::cout << std::setw(11) << "vs. base";
+    std::cout << "\n" << std::fixed;
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(22) << result.name << std::right
+                  << std::setprecision(1) << std::setw(12) << result.nsPerOp
+                  << std::setprecision(2) << std::setw(12)
+                  << result.allocsPerOp << std::setprecision(0)
+                  << std::setw(14) << 1e9 / result.nsPerOp;
+        auto base = baseline.find(result.name);
+        if (base != baseline.end()) {
+            double change = 100 * (result.nsPerOp / base->second.nsPerOp - 1);
+            bool slower = change > tolerance &&
+                    result.nsPerOp - base->second.nsPerOp >= minNs;
+            bool moreAllocs =
+                    result.allocsPerOp > base->second.allocsPerOp + 0.01;
+            std::cout << std::setprecision(1) << std::setw(10)
+                      << std::showpos << change << std::noshowpos << "%";
+            if (slower || moreAllocs) {
+                std::cout << "  REGRESSION";
+                regressions++;
+            }
+        }
+        std::cout << "\n";
+    }
+
+    if (renderBytes >= 0) {
+        std::cout << "Board::render sends " << std::setprecision(0)
+                  << renderBytes << " bytes per frame\n";
+    }
+    if (ansiBytes >= 0) {
+        std::cout << "Board::renderAnsi sends " << std::setprecision(0)
+                  << ansiBytes << " bytes per frame\n";
+    }
+
+    if (!savePath.empty()) {
+        if (!writeBaseline(savePath, results)) {
+            std::cerr << "Cannot write " << savePath << "\n";
+            return 1;
+        }
+        std::cout << "Saved baseline to " << savePath << "\n";
+    }
+    if (regressions > 0) {
+        std::cout << regressions << " regression(s) beyond " << tolerance
+                  << "% (and " << minNs << " ns) of the baseline\n";
+        return 1;
+    }
+    return 0;
+}
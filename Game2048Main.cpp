@@ -1,29 +1,211 @@
 // Copyright 2020, University of Freiburg,
 // Author: Leander Goldbach
 
+#include <fcntl.h>
 #include <ncurses.h>
 #include <unistd.h>
+#include <chrono>
+#include <memory>
+#include <string>
 #include "./Game2048.h"
+#include "./GameServer.h"
+#include "./Grid.h"
+#include "./Metrics.h"
+#include "./OutcomeTable.h"
+#include "./ScriptPlayer.h"
+#include "./Snapshot.h"
+#include "./Simulation.h"
+
+namespace {
+// Show the best move and the value of a position by an outcome table.
+template <int N>
+void drawOutcome(const OutcomeTable &table, const Grid<N> &grid,
+                 Board* board) {
+    float value = 0;
+    int move = table.bestMove(grid, &value);
+    board->drawOutcome(move, value, table.kind());
+}
+
+// The game on a board of any other size than 4x4: no AI and no records,
+// just the moves, undo ('u'), new game ('n') and ESC, and the best move
+// by an outcome table (--table) of the same size.
+template <int N>
+struct GridLoop {
+    static int run(const Game &options) {
+        GridGame<N> game(options.seed, options.maxUndo);
+        Board board(N, options.renderer);
+        board.initialize();
+        board.setInputTimeout(options.frameMs);
+        bool change = true;
+        while (true) {
+            if (change) {
+                board.drawGrid(game.grid());
+                board.drawStats(game.steps, game.points, game.gameOver,
+                                game.gameWon);
+                if (options.table) drawOutcome(*options.table, game.grid(),
+                                               &board);
+                board.finishFrame();
+            }
+            int key = board.readKey();
+            if (key == 27) break;
+            switch (key) {
+                case KEY_LEFT: change = game.play(LEFT); break;
+                case KEY_RIGHT: change = game.play(RIGHT); break;
+                case KEY_UP: change = game.play(UP); break;
+                case KEY_DOWN: change = game.play(DOWN); break;
+                case 'u': change = game.undo(); break;
+                case 'n': game.reset(); change = true; break;
+                default: change = false;
+            }
+        }
+        board.finish();
+        return 0;
+    }
+};
+}  // namespace
 
 int main(int argc, char** argv) {
-    std::cout << argv[0] << std::endl;
     Game game = Game();
     game.parseCommandLineArguments(argc, argv);
-    Board board = Board();
+    // stdout belongs to the protocol when serving on stdio, and to the
+    // results when playing a script.
+    if (game.serve != "-" && game.script.empty()) {
+        std::cout << argv[0] << std::endl;
+    }
+    std::unique_ptr<MetricsDumper> metrics;
+    if (!game.metricsFile.empty()) {
+        if (!Metrics::enabled()) {
+            std::cerr << "Metrics are compiled out, build with make METRICS=1"
+                      << std::endl;
+        }
+        metrics.reset(new MetricsDumper(game.metricsFile,
+                                        game.metricsSeconds));
+    }
+
+    if (game.size != 4) {
+        if (game.size < kMinGridSize || game.size > kMaxGridSize) {
+            std::cerr << "Unsupported board size: " << game.size << std::endl;
+            return 1;
+        }
+        if (game.simulate > 0 || game.recorder || !game.serve.empty() ||
+            !game.script.empty() || game.snapshots) {
+            std::cerr << "--simulate, --record, --serve, --script and "
+                      << "--snapshot need a 4x4 board" << std::endl;
+            return 1;
+        }
+        return dispatchGridSize<GridLoop>(game.size, game);
+    }
+
+    // headless mode: play many games without ncurses and report stats.
+    if (game.simulate > 0) {
+        std::unique_ptr<Policy> probe(Policy::create(game.policy));
+        if (!probe) {
+            std::cerr << "Unknown policy: " << game.policy << std::endl;
+            return 1;
+        }
+        std::cout << "seed:         " << game.seed << std::endl;
+        // the Monte Carlo policies with the --rollout-ms budget.
+        std::string name = game.policy;
+        double budget = game.rolloutMs;
+        MonteCarlo::Rollout rollout;
+        bool rollouts = MonteCarlo::parsePolicy(name, &rollout);
+        Simulation simulation([name, budget, rollouts, rollout]() -> Policy* {
+            if (!rollouts) return Policy::create(name);
+            return new MonteCarloPolicy(budget, 1, rollout);
+        }, game.seed);
+        SimulationStats stats = simulation.run(game.simulate, game.threads);
+        Simulation::printReport(stats, std::cout);
+        return 0;
+    }
+
+    // server mode: many headless games for clients of a socket or stdio.
+    if (!game.serve.empty()) {
+        GameServer server(game.maxUndo);
+        if (game.serve == "-") {
+            server.serveStream(0, 1);
+            return 0;
+        }
+        if (!server.listen(game.serve) || !server.serve()) {
+            std::cerr << "Cannot serve on " << game.serve << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // scripted mode: the keys come in bulk from a file or a pipe.
+    if (!game.script.empty()) {
+        int fd = game.script == "-" ? 0 : open(game.script.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Cannot open script " << game.script << std::endl;
+            return 1;
+        }
+        Board board(4, game.renderer);
+        Board* drawOn = game.scriptFrameMs >= 0 ? &board : NULL;
+        ScriptPlayer player(&game);
+        auto start = std::chrono::steady_clock::now();
+        bool ok = player.run(fd, 1, drawOn, game.scriptFrameMs);
+        std::chrono::duration<double> seconds =
+                std::chrono::steady_clock::now() - start;
+        if (player.errorOffset() >= 0) {
+            std::cerr << "No key at byte " << player.errorOffset()
+                      << " of the script" << std::endl;
+        }
+        std::cerr << player.keys() << " keys, " << player.games()
+                  << " games in " << seconds.count() << " s ("
+                  << player.keys() / seconds.count() << " keys/s)"
+                  << std::endl;
+        if (fd != 0) close(fd);
+        return ok ? 0 : 1;
+    }
+
+    Board board(4, game.renderer);
     board.initialize();
     board.drawBoard(game.states.back());
-    board.drawStats(game.steps, game.points.back(),
+    board.drawStats(game.steps, game.points,
             game.gameOver, game.gameWon);
+    if (game.table) {
+        drawOutcome(*game.table, Grid<4>(game.states.back()), &board);
+    }
+    board.finishFrame();
 
     bool change;
     while (game.run) {
-        int key = getch();  // get key press event
+        // sleep until a key is pressed or the frame budget is used up,
+        // instead of polling; the AI does not wait while it plays.
+        board.setInputTimeout(game.inputTimeout());
+        int key = board.readKey();  // get key press event (ERR on timeout)
+        Bitboard before = game.states.back();
+        int steps = game.steps;
         change = game.play(key);  // update game based on user input
+        change = game.autoStep() || change;  // AI move if autoplay is on
+        // slide the tiles of a single move before showing its result.
+        if (game.animateMs > 0 && game.steps == steps + 1) {
+            board.moveTiles(before, static_cast<Direction>(game.lastMove),
+                            game.animateMs);
+        }
         if (change) {
             board.drawBoard(game.states.back());
-            board.drawStats(game.steps, game.points.back(),
+            board.drawStats(game.steps, game.points,
                     game.gameOver, game.gameWon);
+            if (game.table) {
+                drawOutcome(*game.table, Grid<4>(game.states.back()),
+                            &board);
+            }
+            if (game.rollouts) {
+                board.drawAi(game.hint, game.autoplay,
+                        game.rollouts->rolloutsPerSecond(), "rollouts");
+            } else {
+                board.drawAi(game.hint, game.autoplay, game.search ?
+                        game.search->stats().nodesPerSecond() : 0);
+            }
+            board.finishFrame();
+            // written in the background, the next key is not delayed.
+            if (game.snapshots) game.snapshots->save(game);
         }
     }
-    endwin();
+    board.finish();
+    if (board.meanFrameBytes() >= 0) {
+        std::cout << "Mean bytes per frame: " << board.meanFrameBytes()
+                  << std::endl;
+    }
 }
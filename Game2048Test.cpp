@@ -2,6 +2,10 @@
 // Author: Leander Goldbach
 
 #include <gtest/gtest.h>
+#include <ncurses.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
 #include <vector>
 #include <iostream>
 #include "./Game2048.h"
@@ -25,6 +29,7 @@ TEST(Game2048Test, constructor) {
 // ____________________________________________________________________________
 TEST(Game2048Test, play) {
     Game game = Game();
+    game.maxUndo = 1;  // keep the previous state.
     game.play(10);  // do nothing
     game.play(10);
     ASSERT_EQ(1, game.states.size());
@@ -61,15 +66,15 @@ TEST(Game2048Test, updateState) {
 
     game.play(259);  // arrow up
     // column 1
-    ASSERT_EQ(4, game.states[1][0]);
-    ASSERT_EQ(8, game.states[1][4]);
+    ASSERT_EQ(4, game.states.back()[0]);
+    ASSERT_EQ(8, game.states.back()[4]);
     // column 2
-    ASSERT_EQ(4, game.states[1][1]);
+    ASSERT_EQ(4, game.states.back()[1]);
     // column 3
-    ASSERT_EQ(2, game.states[1][2]);
+    ASSERT_EQ(2, game.states.back()[2]);
     // column 4
-    ASSERT_EQ(2, game.states[1][3]);
-    ASSERT_EQ(8, game.states[1][7]);
+    ASSERT_EQ(2, game.states.back()[3]);
+    ASSERT_EQ(8, game.states.back()[7]);
 }
 
 // ____________________________________________________________________________
@@ -90,7 +95,7 @@ TEST(Game2048Test, undo) {
     game.maxUndo = 1;
 
     int steps1 = game.steps;
-    int points1 = game.points.back();
+    int points1 = game.points;
 
     game.states[0][15] = 2;  // set 2 at bottom (force a change when KEY_UP).
 
@@ -102,7 +107,7 @@ TEST(Game2048Test, undo) {
     game.play(259);  // KEY_UP
 
     int steps2 = game.steps;
-    int points2 = game.points.back();
+    int points2 = game.points;
 
     std::vector<int> vals2;
     for (int i = 0; i < 16; i++) {
@@ -110,7 +115,7 @@ TEST(Game2048Test, undo) {
     }
     game.undo();
     int steps3 = game.steps;
-    int points3 = game.points.back();
+    int points3 = game.points;
 
     std::vector<int> vals3;
     for (int i = 0; i < 16; i++) {
@@ -130,17 +135,18 @@ TEST(Game2048Test, undo) {
 TEST(Game2048Test, reset) {
     Game game = Game();
     game.play(259);
-    game.points.push_back(4);  // simulate scoring points
+    game.points += 4;  // simulate scoring points
 
     game.reset();
     ASSERT_EQ(0, game.steps);
-    ASSERT_EQ(0, game.points.back());
+    ASSERT_EQ(0, game.points);
 }
 
 TEST(Game2048Test, isGameOver) {
     Game game = Game();
-    for (int i = 1; i < 17; i++) {
-        game.states[0][i-1] = i;
+    // checkerboard of 2s and 4s, so no two neighbours can be merged.
+    for (int i = 0; i < 16; i++) {
+        game.states[0][i] = (i + i / 4) % 2 == 0 ? 2 : 4;
     }
     ASSERT_EQ(true, game.isGameOver());
 }
@@ -157,7 +163,156 @@ TEST(Game2048Test, gameWon) {
     ASSERT_EQ(true, game.gameWon);
 
     // we won but we can continue to play
-    game.states[1][4] = 2048;
+    game.states.back()[4] = 2048;
     game.play(259);
-    ASSERT_EQ(4096, game.states[2][0]);
+    ASSERT_EQ(4096, game.states.back()[0]);
+}
+
+// ____________________________________________________________________________
+TEST(Game2048Test, seed) {
+    // the same seed and the same keys give the same game.
+    char arg0[] = "Game2048Main";
+    char arg1[] = "--seed";
+    char arg2[] = "1234";
+    char* argv[] = { arg0, arg1, arg2 };
+    Game game1 = Game();
+    Game game2 = Game();
+    game1.parseCommandLineArguments(3, argv);
+    game2.parseCommandLineArguments(3, argv);
+    ASSERT_EQ(1234u, game1.seed);
+
+    const int keys[4] = { 259, 260, 258, 261 };  // up, left, down, right
+    for (int i = 0; i < 200; i++) {
+        game1.play(keys[i % 4]);
+        game2.play(keys[i % 4]);
+    }
+    ASSERT_EQ(game1.states.size(), game2.states.size());
+    for (size_t i = 0; i < game1.states.size(); i++) {
+        ASSERT_EQ(game1.states[i].bits, game2.states[i].bits);
+    }
+    ASSERT_TRUE(game1.rng == game2.rng);
+}
+
+// ____________________________________________________________________________
+TEST(Game2048Test, ai) {
+    Game game = Game();
+    game.threads = 2;
+    game.searchMs = 1;
+    ASSERT_FALSE(game.autoStep());  // autoplay is off.
+
+    game.play('h');
+    ASSERT_GE(game.hint, 0);
+    Bitboard moved = MoveTables::move(game.states.back(),
+                                      static_cast<Direction>(game.hint), NULL);
+    ASSERT_NE(game.states.back(), moved);
+
+    game.play('a');
+    ASSERT_TRUE(game.autoplay);
+    ASSERT_TRUE(game.autoStep());
+    ASSERT_EQ(1, game.steps);
+    ASSERT_EQ(-1, game.hint);  // the hint is gone after a move.
+    game.play('a');
+    ASSERT_FALSE(game.autoStep());
+}
+
+// ____________________________________________________________________________
+TEST(Game2048Test, undoExact) {
+    Game game = Game();
+    game.maxUndo = 2;
+    // two merges in one move: 2+2 and 4+4.
+    game.states[0] = Bitboard();
+    game.states[0][0] = 2;
+    game.states[0][4] = 2;
+    game.states[0][1] = 4;
+    game.states[0][5] = 4;
+    Bitboard before = game.states.back();
+    game.play(259);  // KEY_UP
+    ASSERT_EQ(12, game.points);
+    game.undo();
+    ASSERT_EQ(0, game.points);
+    ASSERT_EQ(0, game.steps);
+    ASSERT_EQ(before, game.states.back());
+
+    // the history never grows beyond maxUndo + 1 states.
+    const int keys[4] = { 259, 260, 258, 261 };
+    for (int i = 0; i < 100; i++) game.play(keys[i % 4]);
+    ASSERT_EQ(3u, game.states.size());
+    ASSERT_EQ(3u, game.states.capacity());
+}
+
+// ____________________________________________________________________________
+TEST(Game2048Test, inputTimeout) {
+    char arg0[] = "Game2048Main";
+    char arg1[] = "--frame-ms";
+    char arg2[] = "250";
+    char* argv[] = { arg0, arg1, arg2 };
+    Game game = Game();
+    ASSERT_EQ(100, game.inputTimeout());
+    game.parseCommandLineArguments(3, argv);
+    ASSERT_EQ(250, game.inputTimeout());
+    // no waiting while the AI plays, but once the game is over.
+    ASSERT_TRUE(game.play('a'));
+    ASSERT_EQ(0, game.inputTimeout());
+    game.gameOver = true;
+    ASSERT_EQ(250, game.inputTimeout());
+    // a timeout of getch() is no key.
+    ASSERT_FALSE(game.play(-1));  // ERR
+}
+
+// ____________________________________________________________________________
+TEST(Game2048Test, renderer) {
+    char arg0[] = "Game2048Main";
+    char arg1[] = "--renderer";
+    char arg2[] = "ansi";
+    char arg3[] = "--animate-ms";
+    char arg4[] = "80";
+    char* argv[] = { arg0, arg1, arg2, arg3, arg4 };
+    Game game = Game();
+    ASSERT_EQ(Board::RENDER_CURSES, game.renderer);
+    ASSERT_EQ(0, game.animateMs);
+    game.parseCommandLineArguments(5, argv);
+    ASSERT_EQ(Board::RENDER_ANSI, game.renderer);
+    ASSERT_EQ(80, game.animateMs);
+
+    // the animation needs the direction of the last move.
+    ASSERT_EQ(-1, game.lastMove);
+    game.states[0][15] = 2;  // set 2 at bottom.
+    game.play(259);  // arrow up
+    ASSERT_EQ(UP, game.lastMove);
+    game.play('n');
+    ASSERT_EQ(-1, game.lastMove);
+}
+
+// ____________________________________________________________________________
+TEST(Game2048Test, readKey) {
+    int keys[2];
+    ASSERT_EQ(0, pipe(keys));
+    Board board(4, Board::RENDER_ANSI);
+    board.setInputFd(keys[0]);
+    board.setInputTimeout(0);
+    ASSERT_EQ(ERR, board.readKey());
+
+    // an arrow cut in two by the reads is still one arrow.
+    ASSERT_EQ(2, write(keys[1], "\x1b[", 2));
+    std::thread rest([&keys] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ASSERT_EQ(1, write(keys[1], "A", 1));
+    });
+    ASSERT_EQ(KEY_UP, board.readKey());
+    rest.join();
+
+    // held keys: more arrows than one read takes, then a whole sequence
+    // of another key, a letter and ESC alone.
+    std::string held;
+    for (int i = 0; i < 30; i++) held += "\x1bOD";
+    held += "\x1b[1;5Ah\x1b";
+    ASSERT_EQ(static_cast<ssize_t>(held.size()),
+              write(keys[1], held.data(), held.size()));
+    for (int i = 0; i < 30; i++) ASSERT_EQ(KEY_LEFT, board.readKey());
+    ASSERT_EQ(ERR, board.readKey());
+    ASSERT_EQ('h', board.readKey());
+    ASSERT_EQ(27, board.readKey());
+    ASSERT_EQ(ERR, board.readKey());
+    close(keys[0]);
+    close(keys[1]);
 }
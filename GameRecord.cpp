@@ -0,0 +1,211 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "./GameRecord.h"
+
+namespace {
+void putUint64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint64_t getUint64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) value |= uint64_t(in[i]) << (8 * i);
+    return value;
+}
+}  // namespace
+
+// ___________________________________________________________________________
+bool GameRecord::findMove(const Bitboard &before, const Bitboard &after,
+        Direction* dir, int* field, bool* four) {
+    for (int d = 0; d < 4; d++) {
+        Bitboard moved = MoveTables::move(before, static_cast<Direction>(d),
+                                          NULL);
+        if (moved == before) continue;
+        // after has exactly one more tile, a 2 or a 4 on an empty field.
+        int spawned = -1;
+        int differences = 0;
+        for (int i = 0; i < 16; i++) {
+            if (moved.exponent(i) == after.exponent(i)) continue;
+            differences++;
+            spawned = i;
+        }
+        if (differences != 1 || moved.exponent(spawned) != 0 ||
+            after.exponent(spawned) > 2) {
+            continue;
+        }
+        *dir = static_cast<Direction>(d);
+        *field = spawned;
+        *four = after.exponent(spawned) == 2;
+        return true;
+    }
+    return false;
+}
+
+// ___________________________________________________________________________
+GameRecordWriter::GameRecordWriter() : file(NULL), inGame(false) {
+}
+
+// ___________________________________________________________________________
+GameRecordWriter::~GameRecordWriter() {
+    if (file == NULL) return;
+    endGame();
+    std::fclose(file);
+}
+
+// ___________________________________________________________________________
+bool GameRecordWriter::open(const std::string &path) {
+    file = std::fopen(path.c_str(), "ab");
+    if (file == NULL) return false;
+    // moves are single bytes, so give stdio a large buffer.
+    std::setvbuf(file, NULL, _IOFBF, 1 << 16);
+    return true;
+}
+
+// ___________________________________________________________________________
+void GameRecordWriter::beginGame(uint64_t seed, const Bitboard &first) {
+    if (file == NULL) return;
+    endGame();
+    uint8_t header[GameRecord::kHeaderSize] = { 0 };
+    std::memcpy(header, GameRecord::kMagic, 4);
+    header[4] = GameRecord::kVersion;
+    putUint64(header + 8, seed);
+    putUint64(header + 16, first.bits);
+    std::fwrite(header, 1, sizeof(header), file);
+    inGame = true;
+}
+
+// ___________________________________________________________________________
+void GameRecordWriter::move(Direction dir, int field, bool four) {
+    if (!inGame) return;
+    std::fputc(GameRecord::encodeMove(dir, field, four), file);
+}
+
+// ___________________________________________________________________________
+void GameRecordWriter::undo() {
+    if (!inGame) return;
+    std::fputc(GameRecord::kUndo, file);
+}
+
+// ___________________________________________________________________________
+void GameRecordWriter::endGame() {
+    if (!inGame) return;
+    std::fputc(GameRecord::kEnd, file);
+    std::fflush(file);
+    inGame = false;
+}
+
+// ___________________________________________________________________________
+GameRecordReader::GameRecordReader() : data(NULL), size(0), offset(0) {
+}
+
+// ___________________________________________________________________________
+GameRecordReader::~GameRecordReader() {
+    close();
+}
+
+// ___________________________________________________________________________
+bool GameRecordReader::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size = info.st_size;
+    if (size > 0) {
+        void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            size = 0;
+            return false;
+        }
+        // records are read front to back.
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const uint8_t*>(mapped);
+    }
+    ::close(fd);
+    offset = 0;
+    return true;
+}
+
+// ___________________________________________________________________________
+void GameRecordReader::close() {
+    if (data != NULL) munmap(const_cast<uint8_t*>(data), size);
+    data = NULL;
+    size = 0;
+    offset = 0;
+}
+
+// ___________________________________________________________________________
+bool GameRecordReader::next(GameRecordView* view) {
+    if (offset + GameRecord::kHeaderSize > size) return false;
+    const uint8_t* header = data + offset;
+    if (std::memcmp(header, GameRecord::kMagic, 4) != 0 ||
+        header[4] != GameRecord::kVersion) {
+        return false;
+    }
+    view->seed = getUint64(header + 8);
+    view->first = Bitboard(getUint64(header + 16));
+    view->events = header + GameRecord::kHeaderSize;
+
+    // the events run up to the end byte (or the end of the file).
+    const uint8_t* end = data + size;
+    const uint8_t* p = view->events;
+    while (p < end && *p != GameRecord::kEnd) p++;
+    view->numEvents = p - view->events;
+    view->complete = p < end;
+    offset = (p - data) + (view->complete ? 1 : 0);
+    return true;
+}
+
+// ___________________________________________________________________________
+bool GameRecordReader::replay(const GameRecordView &view,
+        ReplayResult* result) {
+    Bitboard board = view.first;
+    int score = 0;
+    boards.clear();
+    scores.clear();
+    for (size_t i = 0; i < view.numEvents; i++) {
+        uint8_t event = view.events[i];
+        if (event == GameRecord::kUndo) {
+            if (boards.empty()) return false;
+            board = boards.back();
+            score = scores.back();
+            boards.pop_back();
+            scores.pop_back();
+            continue;
+        }
+        if (event & 0x80) return false;  // unknown control byte.
+
+        Direction dir = static_cast<Direction>(event & 3);
+        int field = (event >> 2) & 0xF;
+        int gained = 0;
+        Bitboard moved = MoveTables::move(board, dir, &gained);
+        if (moved == board || moved.exponent(field) != 0) return false;
+        moved.setExponent(field, event & 0x40 ? 2 : 1);
+
+        boards.push_back(board);
+        scores.push_back(score);
+        board = moved;
+        score += gained;
+    }
+    result->board = board;
+    result->score = score;
+    result->steps = static_cast<int>(boards.size());
+    result->maxExponent = 0;
+    for (int i = 0; i < 16; i++) {
+        result->maxExponent = std::max(result->maxExponent,
+                                       board.exponent(i));
+    }
+    return true;
+}
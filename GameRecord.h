@@ -0,0 +1,124 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef GAMERECORD_H_
+#define GAMERECORD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "./Bitboard.h"
+#include "./MoveTables.h"
+
+// Binary format for archiving games. A file is a sequence of records, one
+// per game, each a 24 byte header followed by one byte per event:
+//
+//   header: "G48R", version (1 byte), 3 reserved bytes, the seed of the
+//           game and its first board (both 64 bit little endian).
+//   move:   0vffffdd - dd is the Direction, ffff the field of the tile
+//           spawned after the move and v is set if that tile is a 4.
+//   undo:   0x81 - take back the last move.
+//   end:    0x80 - end of the record.
+//
+// Since every spawned tile is stored, replaying a record needs no random
+// numbers. A record without an end byte (e.g. after a crash) is read up to
+// where it stops.
+namespace GameRecord {
+const char kMagic[4] = { 'G', '4', '8', 'R' };
+const uint8_t kVersion = 1;
+const size_t kHeaderSize = 24;
+const uint8_t kEnd = 0x80;
+const uint8_t kUndo = 0x81;
+
+// One move byte.
+inline uint8_t encodeMove(Direction dir, int field, bool four) {
+    return static_cast<uint8_t>(dir | field << 2 | (four ? 0x40 : 0));
+}
+
+// The move event that leads from before to after: the direction and the
+// tile spawned after the move. Returns false if no move and spawn do.
+bool findMove(const Bitboard &before, const Bitboard &after, Direction* dir,
+              int* field, bool* four);
+}  // namespace GameRecord
+
+// Appends records to a file, buffered by stdio. Every record is finished
+// (and flushed) by endGame, which the destructor calls if needed.
+class GameRecordWriter {
+ public:
+    GameRecordWriter();
+    ~GameRecordWriter();
+
+    // Open the file for appending. Returns false if that fails.
+    bool open(const std::string &path);
+    bool isOpen() const { return file != NULL; }
+
+    // Start the record of a new game (ending the current one).
+    void beginGame(uint64_t seed, const Bitboard &first);
+
+    // A move, followed by a tile spawned at field (4 if four, else 2).
+    void move(Direction dir, int field, bool four);
+
+    void undo();
+
+    void endGame();
+
+ private:
+    std::FILE* file;
+    bool inGame;
+};
+
+// A record inside a mapped file. The events point into the mapping.
+struct GameRecordView {
+    uint64_t seed;
+    Bitboard first;
+    const uint8_t* events;
+    size_t numEvents;
+    // false if the record has no end byte.
+    bool complete;
+};
+
+// Result of replaying a record.
+struct ReplayResult {
+    Bitboard board;
+    int score;
+    int steps;
+    int maxExponent;
+};
+
+// Reads record files through a read-only memory mapping, so scanning them
+// costs no copies and no allocation per record.
+class GameRecordReader {
+ public:
+    GameRecordReader();
+    ~GameRecordReader();
+
+    // Map the file. Returns false if it cannot be opened or mapped.
+    bool open(const std::string &path);
+    void close();
+
+    // Read the next record into view. Returns false at the end of the
+    // file or if the next bytes are not a valid record header.
+    bool next(GameRecordView* view);
+
+    // Start reading at the first record again.
+    void rewind() { offset = 0; }
+
+    // Replay the events of a record. Returns false if the record does not
+    // describe a legal game (a move not changing the board or a tile
+    // spawned on an occupied field).
+    bool replay(const GameRecordView &view, ReplayResult* result);
+
+    size_t fileSize() const { return size; }
+
+ private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    // states and scores to go back to on undo, reused for every replay.
+    std::vector<Bitboard> boards;
+    std::vector<int> scores;
+};
+
+#endif  // GAMERECORD_H_
@@ -0,0 +1,193 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "./Game2048.h"
+#include "./GameRecord.h"
+#include "./Snapshot.h"
+
+namespace {
+std::string tempPath() {
+    char path[] = "/tmp/GameRecordTestXXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    return path;
+}
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(GameRecordTest, encodeMove) {
+    ASSERT_EQ(0x00, GameRecord::encodeMove(LEFT, 0, false));
+    ASSERT_EQ(0x3F, GameRecord::encodeMove(DOWN, 15, false));
+    ASSERT_EQ(0x49, GameRecord::encodeMove(RIGHT, 2, true));
+    // moves never collide with the control bytes.
+    ASSERT_FALSE(GameRecord::encodeMove(DOWN, 15, true) & 0x80);
+}
+
+// ____________________________________________________________________________
+TEST(GameRecordTest, recordAndReplay) {
+    std::string path = tempPath();
+    Game game = Game();
+    game.maxUndo = 3;
+    game.recorder = std::make_shared<GameRecordWriter>();
+    ASSERT_TRUE(game.recorder->open(path));
+    game.recorder->beginGame(game.seed, game.states.back());
+
+    // a game with some undos, followed by a second one.
+    const int keys[4] = { 259, 260, 258, 261 };
+    for (int i = 0; i < 200 && !game.gameOver; i++) {
+        game.play(keys[i % 4]);
+        if (i % 7 == 6) game.play('u');
+    }
+    Bitboard firstEnd = game.states.back();
+    int firstPoints = game.points;
+    int firstSteps = game.steps;
+    uint64_t firstSeed = game.seed;
+    game.play('n');
+    for (int i = 0; i < 50; i++) game.play(keys[(i / 3) % 4]);
+    game.recorder.reset();  // ends the second record and closes the file.
+
+    GameRecordReader reader;
+    ASSERT_TRUE(reader.open(path));
+    GameRecordView view;
+    ReplayResult result;
+    ASSERT_TRUE(reader.next(&view));
+    ASSERT_TRUE(view.complete);
+    ASSERT_EQ(firstSeed, view.seed);
+    ASSERT_TRUE(reader.replay(view, &result));
+    ASSERT_EQ(firstEnd, result.board);
+    ASSERT_EQ(firstPoints, result.score);
+    ASSERT_EQ(firstSteps, result.steps);
+
+    ASSERT_TRUE(reader.next(&view));
+    // the second game has a seed of its own, which starts it over.
+    ASSERT_EQ(game.seed, view.seed);
+    ASSERT_NE(firstSeed, view.seed);
+    Game again;
+    again.restart(view.seed);
+    ASSERT_EQ(view.first, again.states.back());
+    ASSERT_TRUE(reader.replay(view, &result));
+    ASSERT_EQ(game.states.back(), result.board);
+    ASSERT_EQ(game.points, result.score);
+    ASSERT_EQ(game.steps, result.steps);
+    ASSERT_FALSE(reader.next(&view));
+
+    // rewinding starts over with the first record.
+    reader.rewind();
+    ASSERT_TRUE(reader.next(&view));
+    ASSERT_TRUE(reader.replay(view, &result));
+    ASSERT_EQ(firstEnd, result.board);
+    std::remove(path.c_str());
+}
+
+// ____________________________________________________________________________
+TEST(GameRecordTest, resumedSnapshot) {
+    // a game saved with a full undo window.
+    std::string snapshot = tempPath();
+    std::string path = tempPath();
+    Game saved;
+    saved.maxUndo = 3;
+    saved.restart(9);
+    const int keys[4] = { 259, 260, 258, 261 };
+    for (int i = 0; i < 20; i++) saved.play(keys[i % 4]);
+    std::string bytes;
+    Snapshot::encode(saved, &bytes);
+    ASSERT_TRUE(Snapshot::write(snapshot, bytes));
+
+    // resumed and recorded: the undos into the window replay.
+    char arg0[] = "Game2048Main";
+    char arg1[] = "-u";
+    char arg2[] = "3";
+    char arg3[] = "--snapshot";
+    char arg5[] = "--record";
+    char* argv[] = { arg0, arg1, arg2, arg3, &snapshot[0], arg5, &path[0] };
+    Game game;
+    game.parseCommandLineArguments(7, argv);
+    ASSERT_EQ(saved.current(), game.current());
+    ASSERT_EQ(4u, game.states.size());
+    for (int i = 0; i < 3; i++) game.play('u');
+    game.play(keys[0]);
+    Bitboard end = game.states.back();
+    game.recorder.reset();
+    game.snapshots.reset();
+
+    GameRecordReader reader;
+    ASSERT_TRUE(reader.open(path));
+    GameRecordView view;
+    ReplayResult result;
+    ASSERT_TRUE(reader.next(&view));
+    ASSERT_EQ(saved.states[0], view.first);
+    ASSERT_TRUE(reader.replay(view, &result));
+    ASSERT_EQ(end, result.board);
+    std::remove(path.c_str());
+    std::remove(snapshot.c_str());
+}
+
+// ____________________________________________________________________________
+TEST(GameRecordTest, findMove) {
+    Bitboard before;
+    before[0] = 2;
+    before[1] = 2;
+    Bitboard after;
+    after[3] = 4;
+    after[4] = 4;
+    Direction dir;
+    int field;
+    bool four;
+    ASSERT_TRUE(GameRecord::findMove(before, after, &dir, &field, &four));
+    ASSERT_EQ(RIGHT, dir);
+    ASSERT_EQ(4, field);
+    ASSERT_TRUE(four);
+    // two new tiles, or none.
+    after[5] = 2;
+    ASSERT_FALSE(GameRecord::findMove(before, after, &dir, &field, &four));
+    ASSERT_FALSE(GameRecord::findMove(before, before, &dir, &field, &four));
+}
+
+// ____________________________________________________________________________
+TEST(GameRecordTest, truncatedAndInvalid) {
+    std::string path = tempPath();
+    Bitboard first;
+    first[0] = 2;
+    first[1] = 2;
+    {
+        GameRecordWriter writer;
+        ASSERT_TRUE(writer.open(path));
+        writer.beginGame(7, first);
+        writer.move(LEFT, 15, true);
+    }
+    // cut off the end byte, as after a crash.
+    ASSERT_EQ(0, truncate(path.c_str(), GameRecord::kHeaderSize + 1));
+
+    GameRecordReader reader;
+    ASSERT_TRUE(reader.open(path));
+    GameRecordView view;
+    ReplayResult result;
+    ASSERT_TRUE(reader.next(&view));
+    ASSERT_FALSE(view.complete);
+    ASSERT_EQ(1u, view.numEvents);
+    ASSERT_TRUE(reader.replay(view, &result));
+    ASSERT_EQ(4, result.score);
+    ASSERT_EQ(1, result.steps);
+    ASSERT_EQ(2, result.board.exponent(0));
+    ASSERT_EQ(2, result.board.exponent(15));
+    ASSERT_FALSE(reader.next(&view));
+
+    // LEFT does not change this board, so the record is not a legal game.
+    uint8_t events[1] = { GameRecord::encodeMove(LEFT, 15, false) };
+    view.first = Bitboard();
+    view.first[0] = 2;
+    view.events = events;
+    view.numEvents = 1;
+    ASSERT_FALSE(reader.replay(view, &result));
+    // nor is an undo before the first move.
+    events[0] = GameRecord::kUndo;
+    ASSERT_FALSE(reader.replay(view, &result));
+
+    ASSERT_FALSE(reader.open("/nonexistent/record"));
+    std::remove(path.c_str());
+}
@@ -0,0 +1,392 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <errno.h>
+#include <ncurses.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include "./GameServer.h"
+
+namespace {
+// events handled per epoll_wait and bytes read per read().
+const int kMaxEvents = 256;
+const size_t kReadSize = 65536;
+// stop reading from a client whose replies pile up beyond this.
+const size_t kMaxPending = 1 << 20;
+// longest request line: a client that sends more without a newline is
+// cut off, its partial line is not kept.
+const size_t kMaxLine = 4096;
+
+// Compare the word at *line with word and skip it (and the blanks after
+// it) if it matches.
+bool takeWord(const char** line, const char* end, const char* word) {
+    size_t length = std::strlen(word);
+    if (static_cast<size_t>(end - *line) < length) return false;
+    if (std::memcmp(*line, word, length) != 0) return false;
+    const char* next = *line + length;
+    if (next != end && *next != ' ') return false;
+    while (next != end && *next == ' ') next++;
+    *line = next;
+    return true;
+}
+
+// Parse the unsigned number at *line and skip it (and blanks after it).
+bool takeNumber(const char** line, const char* end, uint64_t* value) {
+    const char* p = *line;
+    if (p == end || *p < '0' || *p > '9') return false;
+    uint64_t v = 0;
+    for (; p != end && *p >= '0' && *p <= '9'; p++) v = v * 10 + (*p - '0');
+    if (p != end && *p != ' ') return false;
+    while (p != end && *p == ' ') p++;
+    *value = v;
+    *line = p;
+    return true;
+}
+
+// CPU time of this process in ms.
+int64_t cpuMillis() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+}
+}  // namespace
+
+// ___________________________________________________________________________
+GameServer::GameServer(int maxUndo)
+    : maxUndo(maxUndo), nextId(1), listenFd(-1) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+// ___________________________________________________________________________
+GameServer::~GameServer() {
+    for (const auto& connection : connections) close(connection.first);
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (epollFd >= 0) close(epollFd);
+    if (wakeFd >= 0) close(wakeFd);
+}
+
+// ___________________________________________________________________________
+void GameServer::appendState(uint64_t id, const Game &game,
+        std::string* reply) {
+    char buffer[96];
+    int length = snprintf(buffer, sizeof(buffer),
+                          "ok %" PRIu64 " %016" PRIx64 " %d %d %d\n", id,
+                          game.states.back().bits, game.points, game.steps,
+                          game.gameOver ? 1 : 0);
+    reply->append(buffer, length);
+}
+
+// ___________________________________________________________________________
+void GameServer::handle(const char* line, size_t length, SessionIds* owned,
+        std::string* reply) {
+    const char* end = line + length;
+    if (length > 0 && line[length - 1] == '\r') end--;
+    uint64_t id = 0;
+    uint64_t seed;
+
+    if (takeWord(&line, end, "new")) {
+        std::unique_ptr<Game> game(new Game());
+        game->maxUndo = maxUndo;
+        if (takeNumber(&line, end, &seed)) game->restart(seed);
+        id = nextId++;
+        appendState(id, *game, reply);
+        sessions[id] = std::move(game);
+        owned->insert(id);
+        return;
+    }
+    if (takeWord(&line, end, "stats")) {
+        char buffer[64];
+        int n = snprintf(buffer, sizeof(buffer), "ok %zu %" PRId64 "\n",
+                         sessions.size(), cpuMillis());
+        reply->append(buffer, n);
+        return;
+    }
+
+    // all other requests name a session.
+    enum { MOVE, UNDO, RESET, STATE, CLOSE } request;
+    if (takeWord(&line, end, "move")) {
+        request = MOVE;
+    } else if (takeWord(&line, end, "undo")) {
+        request = UNDO;
+    } else if (takeWord(&line, end, "reset")) {
+        request = RESET;
+    } else if (takeWord(&line, end, "state")) {
+        request = STATE;
+    } else if (takeWord(&line, end, "close")) {
+        request = CLOSE;
+    } else {
+        reply->append("error unknown request\n");
+        return;
+    }
+    if (!takeNumber(&line, end, &id)) {
+        reply->append("error missing session id\n");
+        return;
+    }
+    auto it = sessions.find(id);
+    if (it == sessions.end() || owned->count(id) == 0) {
+        reply->append("error unknown session\n");
+        return;
+    }
+    Game* game = it->second.get();
+
+    switch (request) {
+        case MOVE: {
+            int key = -1;
+            if (end - line == 1) {
+                switch (*line) {
+                    case 'l': key = KEY_LEFT; break;
+                    case 'r': key = KEY_RIGHT; break;
+                    case 'u': key = KEY_UP; break;
+                    case 'd': key = KEY_DOWN; break;
+                }
+            }
+            if (key < 0) {
+                reply->append("error direction must be l, r, u or d\n");
+                return;
+            }
+            game->play(key);
+            break;
+        }
+        case UNDO:
+            game->play('u');
+            break;
+        case RESET:
+            if (takeNumber(&line, end, &seed)) {
+                game->restart(seed);
+            } else {
+                game->play('n');
+            }
+            break;
+        case STATE:
+            break;
+        case CLOSE:
+            sessions.erase(it);
+            owned->erase(id);
+            reply->append("ok " + std::to_string(id) + "\n");
+            return;
+    }
+    appendState(id, *game, reply);
+}
+
+// ___________________________________________________________________________
+bool GameServer::handleLines(std::string* in, SessionIds* owned,
+        std::string* reply) {
+    size_t start = 0;
+    while (true) {
+        size_t newline = in->find('\n', start);
+        if (newline == std::string::npos) break;
+        if (newline - start > kMaxLine) break;
+        handle(in->data() + start, newline - start, owned, reply);
+        start = newline + 1;
+    }
+    in->erase(0, start);
+    size_t newline = in->find('\n');
+    if (std::min(newline, in->size()) > kMaxLine) {
+        reply->append("error line too long\n");
+        in->clear();
+        return false;
+    }
+    return true;
+}
+
+// ___________________________________________________________________________
+void GameServer::dropSessions(SessionIds* owned) {
+    for (uint64_t id : *owned) sessions.erase(id);
+    owned->clear();
+}
+
+// ___________________________________________________________________________
+bool GameServer::listen(const std::string &path) {
+    struct sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address),
+             sizeof(address)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return false;
+    }
+    if (listenFd >= 0) close(listenFd);
+    listenFd = fd;
+    socketPath = path;
+    return true;
+}
+
+// ___________________________________________________________________________
+bool GameServer::serve() {
+    if (listenFd < 0 || epollFd < 0 || wakeFd < 0) return false;
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+
+    struct epoll_event events[kMaxEvents];
+    bool running = true;
+    while (running) {
+        int n = epoll_wait(epollFd, events, kMaxEvents, -1);
+        if (n < 0 && errno != EINTR) return false;
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                accept();
+            } else if (fd == wakeFd) {
+                uint64_t count;
+                if (read(wakeFd, &count, sizeof(count)) > 0) running = false;
+            } else {
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                if (events[i].events & (EPOLLERR | EPOLLHUP) &&
+                    !(events[i].events & EPOLLIN)) {
+                    closeConnection(fd);
+                } else if (events[i].events & EPOLLIN) {
+                    receive(fd);
+                } else if (!flush(fd, &it->second)) {
+                    closeConnection(fd);
+                }
+            }
+        }
+    }
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, listenFd, NULL);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, wakeFd, NULL);
+    return true;
+}
+
+// ___________________________________________________________________________
+void GameServer::stop() {
+    if (wakeFd < 0) return;
+    uint64_t one = 1;
+    ssize_t written = write(wakeFd, &one, sizeof(one));
+    (void) written;
+}
+
+// ___________________________________________________________________________
+void GameServer::accept() {
+    while (true) {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        Connection& connection = connections[fd];
+        connection.outPos = 0;
+        connection.events = EPOLLIN;
+    }
+}
+
+// ___________________________________________________________________________
+void GameServer::receive(int fd) {
+    Connection& connection = connections[fd];
+    // one read per event, so a busy client cannot starve the others.
+    char buffer[kReadSize];
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+        closeConnection(fd);
+        return;
+    }
+    if (n < 0) return;
+    connection.in.append(buffer, n);
+    // all replies to this batch of requests go out in one write.
+    bool ok = handleLines(&connection.in, &connection.sessions,
+                          &connection.out);
+    // the error of a line too long is sent as far as the socket takes it.
+    if (!flush(fd, &connection) || !ok) closeConnection(fd);
+}
+
+// ___________________________________________________________________________
+bool GameServer::flush(int fd, Connection* connection) {
+    std::string& out = connection->out;
+    while (connection->outPos < out.size()) {
+        ssize_t n = send(fd, out.data() + connection->outPos,
+                         out.size() - connection->outPos, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) return false;
+            break;
+        }
+        connection->outPos += n;
+    }
+    if (connection->outPos == out.size()) {
+        out.clear();
+        connection->outPos = 0;
+    }
+    // wait for the socket to take more if replies are left, and stop
+    // reading requests while too many of them are.
+    size_t pending = out.size() - connection->outPos;
+    uint32_t events = pending <= kMaxPending ?
+                      static_cast<uint32_t>(EPOLLIN) : uint32_t(0);
+    if (pending > 0) events |= EPOLLOUT;
+    if (events != connection->events) {
+        struct epoll_event event;
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+        connection->events = events;
+    }
+    return true;
+}
+
+// ___________________________________________________________________________
+void GameServer::closeConnection(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    auto it = connections.find(fd);
+    if (it == connections.end()) return;
+    dropSessions(&it->second.sessions);
+    connections.erase(it);
+}
+
+// ___________________________________________________________________________
+void GameServer::serveStream(int inFd, int outFd) {
+    std::string in;
+    std::string out;
+    SessionIds owned;
+    char buffer[kReadSize];
+    while (true) {
+        ssize_t n = read(inFd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        in.append(buffer, n);
+        bool ok = handleLines(&in, &owned, &out);
+        size_t written = 0;
+        while (written < out.size()) {
+            ssize_t w = write(outFd, out.data() + written,
+                              out.size() - written);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) {
+                ok = false;
+                break;
+            }
+            written += w;
+        }
+        out.clear();
+        if (!ok) break;
+    }
+    dropSessions(&owned);
+}
@@ -0,0 +1,109 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef GAMESERVER_H_
+#define GAMESERVER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "./Game2048.h"
+
+// Serves many games (sessions) at once, without any ncurses: one thread
+// runs an epoll loop over a Unix domain socket and all its connections,
+// or a blocking loop over stdin and stdout. Every connection may own any
+// number of sessions, which end with it.
+//
+// The protocol is line based, one request per line and one reply line per
+// request, in order, so clients can pipeline requests:
+//
+//   new [SEED]       start a session (random seed if none is given)
+//   move ID l|r|u|d  move the tiles of session ID
+//   undo ID          undo a move (if the server allows undos)
+//   reset ID [SEED]  start a new game in session ID
+//   state ID         just report the state
+//   close ID         end session ID, replies "ok ID"
+//   stats            replies "ok SESSIONS CPU_MS" (CPU time of the server)
+//
+// All but close and stats reply "ok ID BOARD POINTS STEPS OVER": BOARD is
+// the 16 hex digits of the Bitboard, OVER is 1 if no move is left.
+// Failed requests reply "error MESSAGE". A line longer than 4 KB is
+// answered with "error line too long" and ends the connection.
+class GameServer {
+ public:
+    // The ids of the sessions a client owns.
+    typedef std::unordered_set<uint64_t> SessionIds;
+
+    // Sessions keep maxUndo moves to undo (like --max-undo).
+    explicit GameServer(int maxUndo = 0);
+    ~GameServer();
+
+    // Handle one request (a line without its newline) of the client that
+    // owns the sessions in owned and append the reply (with newline) to
+    // reply. New and closed sessions are added to and removed from owned.
+    void handle(const char* line, size_t length, SessionIds* owned,
+                std::string* reply);
+
+    // Listen on a Unix domain socket at path (replacing a stale one).
+    // Returns false if that fails.
+    bool listen(const std::string &path);
+
+    // Run the event loop on the socket until stop() is called. Returns
+    // false if the loop cannot be set up.
+    bool serve();
+
+    // Make serve() return (from any thread).
+    void stop();
+
+    // Serve a single client reading from inFd and writing to outFd (e.g.
+    // stdin and stdout) until the end of its input.
+    void serveStream(int inFd, int outFd);
+
+    size_t sessionCount() const { return sessions.size(); }
+
+ private:
+    struct Connection {
+        // received bytes not yet handled (at most a partial line).
+        std::string in;
+        // replies not yet sent, from outPos on.
+        std::string out;
+        size_t outPos;
+        // the epoll events the loop waits for.
+        uint32_t events;
+        // the sessions it owns, ended when it closes.
+        SessionIds sessions;
+    };
+
+    // Handle all complete lines of in and remove them. Returns false (and
+    // replies the error) if a line is too long: the client is to be cut
+    // off.
+    bool handleLines(std::string* in, SessionIds* owned,
+                     std::string* reply);
+
+    // Append the state of a session to reply.
+    void appendState(uint64_t id, const Game &game, std::string* reply);
+
+    // Connection events.
+    void accept();
+    void receive(int fd);
+    bool flush(int fd, Connection* connection);
+    void closeConnection(int fd);
+
+    // End the sessions of a client.
+    void dropSessions(SessionIds* owned);
+
+    int maxUndo;
+    std::unordered_map<uint64_t, std::unique_ptr<Game>> sessions;
+    uint64_t nextId;
+
+    int listenFd;
+    int epollFd;
+    int wakeFd;
+    std::string socketPath;
+    std::unordered_map<int, Connection> connections;
+};
+
+#endif  // GAMESERVER_H_
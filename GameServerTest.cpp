@@ -0,0 +1,176 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "./GameServer.h"
+
+namespace {
+std::string request(GameServer* server, const std::string &line,
+                    GameServer::SessionIds* owned) {
+    std::string reply;
+    server->handle(line.data(), line.size(), owned, &reply);
+    return reply;
+}
+
+// The state reply for a game.
+std::string stateOf(uint64_t id, const Game &game) {
+    char buffer[96];
+    snprintf(buffer, sizeof(buffer),
+             "ok %" PRIu64 " %016" PRIx64 " %d %d %d\n", id,
+             game.states.back().bits, game.points, game.steps,
+             game.gameOver ? 1 : 0);
+    return buffer;
+}
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(GameServerTest, protocol) {
+    GameServer server(1);
+    Game game;
+    game.maxUndo = 1;
+    game.restart(42);
+    GameServer::SessionIds first;
+    GameServer::SessionIds second;
+
+    // a session with a seed plays like a game with that seed.
+    ASSERT_EQ(stateOf(1, game), request(&server, "new 42", &first));
+    ASSERT_EQ(1u, server.sessionCount());
+    ASSERT_EQ(stateOf(1, game), request(&server, "state 1\r", &first));
+    const char* moves[4] = { "l", "u", "r", "d" };
+    const int keys[4] = { 260, 259, 261, 258 };
+    for (int i = 0; i < 20; i++) {
+        game.play(keys[i % 4]);
+        ASSERT_EQ(stateOf(1, game),
+                  request(&server, std::string("move 1 ") + moves[i % 4],
+                          &first));
+    }
+    game.play('u');
+    ASSERT_EQ(stateOf(1, game), request(&server, "undo 1", &first));
+    game.restart(7);
+    ASSERT_EQ(stateOf(1, game), request(&server, "reset 1 7", &first));
+
+    // sessions belong to the client that started them.
+    ASSERT_EQ("error unknown session\n",
+              request(&server, "state 1", &second));
+    ASSERT_EQ("error unknown session\n",
+              request(&server, "state 2", &first));
+    ASSERT_EQ("error missing session id\n",
+              request(&server, "move x", &first));
+    ASSERT_EQ("error direction must be l, r, u or d\n",
+              request(&server, "move 1 left", &first));
+    ASSERT_EQ("error unknown request\n", request(&server, "news", &first));
+    ASSERT_EQ(0u, request(&server, "stats", &first).find("ok 1 "));
+
+    ASSERT_EQ(0u, request(&server, "new", &first).find("ok 2 "));
+    ASSERT_EQ("ok 1\n", request(&server, "close 1", &first));
+    ASSERT_EQ("error unknown session\n",
+              request(&server, "close 1", &first));
+    ASSERT_EQ(1u, server.sessionCount());
+    ASSERT_EQ(GameServer::SessionIds{2}, first);
+    ASSERT_TRUE(second.empty());
+}
+
+// ____________________________________________________________________________
+TEST(GameServerTest, socket) {
+    char path[] = "/tmp/GameServerTest.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    GameServer server;
+    ASSERT_TRUE(server.listen(path));
+    std::thread loop([&server] { server.serve(); });
+
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path, sizeof(path));
+    ASSERT_EQ(0, connect(client, reinterpret_cast<struct sockaddr*>(&address),
+                         sizeof(address)));
+    // pipelined requests, the last one split across two writes.
+    std::string requests = "new 5\nmove 1 l\nmove 1 r\nstate 1\nclo";
+    ASSERT_EQ(static_cast<ssize_t>(requests.size()),
+              write(client, requests.data(), requests.size()));
+    ASSERT_EQ(4, write(client, "se 1", 4));
+    // and an empty line.
+    ASSERT_EQ(2, write(client, "\n\n", 2));
+
+    std::string replies;
+    char buffer[256];
+    while (std::count(replies.begin(), replies.end(), '\n') < 6) {
+        ssize_t n = read(client, buffer, sizeof(buffer));
+        ASSERT_GT(n, 0);
+        replies.append(buffer, n);
+    }
+    ASSERT_EQ(0u, replies.find("ok 1 "));
+    ASSERT_NE(std::string::npos, replies.find("\nok 1\n"));
+    ASSERT_NE(std::string::npos, replies.find("\nerror unknown request\n"));
+
+    close(client);
+    server.stop();
+    loop.join();
+    ASSERT_EQ(0u, server.sessionCount());
+}
+
+// ____________________________________________________________________________
+TEST(GameServerTest, lineTooLong) {
+    // on a stream: the requests before are answered, the rest is not read.
+    int in[2];
+    int out[2];
+    ASSERT_EQ(0, pipe(in));
+    ASSERT_EQ(0, pipe(out));
+    std::string requests = "new 5\n" + std::string(5000, 'x') + "\nstate 1\n";
+    ASSERT_EQ(static_cast<ssize_t>(requests.size()),
+              write(in[1], requests.data(), requests.size()));
+    GameServer server;
+    // returns although the input is still open.
+    server.serveStream(in[0], out[1]);
+    close(out[1]);
+    std::string replies;
+    char buffer[256];
+    ssize_t n;
+    while ((n = read(out[0], buffer, sizeof(buffer))) > 0) {
+        replies.append(buffer, n);
+    }
+    ASSERT_EQ(0u, replies.find("ok 1 "));
+    ASSERT_EQ("\nerror line too long\n", replies.substr(replies.find('\n')));
+    ASSERT_EQ(0u, server.sessionCount());
+    close(in[0]);
+    close(in[1]);
+    close(out[0]);
+
+    // on the socket: a partial line too long, and the connection ends.
+    char path[] = "/tmp/GameServerTest.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    ASSERT_TRUE(server.listen(path));
+    std::thread loop([&server] { server.serve(); });
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path, sizeof(path));
+    ASSERT_EQ(0, connect(client, reinterpret_cast<struct sockaddr*>(&address),
+                         sizeof(address)));
+    std::string line(5000, 'x');
+    ASSERT_EQ(static_cast<ssize_t>(line.size()),
+              write(client, line.data(), line.size()));
+    replies.clear();
+    while ((n = read(client, buffer, sizeof(buffer))) > 0) {
+        replies.append(buffer, n);
+    }
+    ASSERT_EQ("error line too long\n", replies);
+    close(client);
+    server.stop();
+    loop.join();
+}
@@ -0,0 +1,62 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include "./GameState.h"
+#include "./Spawn.h"
+
+// ___________________________________________________________________________
+GameState GameState::withFlags(GameState state) {
+    BoardSummary summary = MoveTables::summarize(state.board);
+    state.gameOver = summary.legalMoves == 0;
+    // gameWon stays true once 2048 (2^11) was reached.
+    state.gameWon = state.gameWon || summary.maxExponent >= 11;
+    return state;
+}
+
+// ___________________________________________________________________________
+GameState GameState::fromBoard(const Bitboard &board) {
+    GameState state = { board, 0, 0, false, false };
+    return withFlags(state);
+}
+
+// ___________________________________________________________________________
+GameState GameState::start(Xoshiro256 &rng) {
+    Bitboard board;
+    spawnTile(board, rng);
+    spawnTile(board, rng);
+    return fromBoard(board);
+}
+
+// ___________________________________________________________________________
+GameState GameState::move(const GameState &state, Direction dir) {
+    int score = 0;
+    Bitboard moved = MoveTables::move(state.board, dir, &score);
+    if (moved == state.board) return state;
+    GameState next = state;
+    next.board = moved;
+    next.points += score;
+    next.steps++;
+    return next;
+}
+
+// ___________________________________________________________________________
+GameState GameState::place(const GameState &state, int field, int exponent) {
+    GameState next = state;
+    next.board.setExponent(field, exponent);
+    return withFlags(next);
+}
+
+// ___________________________________________________________________________
+GameState GameState::spawn(const GameState &state, Xoshiro256 &rng) {
+    GameState next = state;
+    if (spawnTile(next.board, rng) < 0) return state;
+    return withFlags(next);
+}
+
+// ___________________________________________________________________________
+GameState GameState::play(const GameState &state, Direction dir,
+        Xoshiro256 &rng) {
+    GameState moved = move(state, dir);
+    if (moved.board == state.board) return state;
+    return spawn(moved, rng);
+}
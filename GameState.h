@@ -0,0 +1,64 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef GAMESTATE_H_
+#define GAMESTATE_H_
+
+#include <type_traits>
+#include "./Bitboard.h"
+#include "./MoveTables.h"
+#include "./Random.h"
+
+// Everything a 4x4 game is at one point, as a plain 24 byte value: no
+// Board, no history, no options. Copying one is copying three words, so
+// searches and simulations can explore moves on copies. Game keeps the
+// same values next to its undo history, recording and terminal (see
+// Game::current()).
+//
+// The game advances by the static functions, which take a state and
+// return the next one (the random ones draw from the given generator).
+struct GameState {
+    Bitboard board;
+    int points;
+    int steps;
+    // no move is left / a 2048 tile was reached at some point.
+    bool gameOver;
+    bool gameWon;
+
+    // The state of a game that starts with board (nothing scored yet).
+    static GameState fromBoard(const Bitboard &board);
+
+    // A new game: two tiles spawned on an empty board.
+    static GameState start(Xoshiro256 &rng);
+
+    // The state after moving in dir, before the new tile is spawned (the
+    // flags are not updated). The same state if the move changes nothing.
+    static GameState move(const GameState &state, Direction dir);
+
+    // The state with a tile of the given exponent on an empty field.
+    static GameState place(const GameState &state, int field, int exponent);
+
+    // The state with a new tile spawned (see spawnTile) and the flags
+    // updated. The same state if the board is full.
+    static GameState spawn(const GameState &state, Xoshiro256 &rng);
+
+    // One whole step of the game: move, then spawn if the board changed.
+    static GameState play(const GameState &state, Direction dir,
+                          Xoshiro256 &rng);
+
+    bool operator==(const GameState &other) const {
+        return board == other.board && points == other.points &&
+               steps == other.steps && gameOver == other.gameOver &&
+               gameWon == other.gameWon;
+    }
+
+ private:
+    // The state with gameOver and gameWon computed from the board.
+    static GameState withFlags(GameState state);
+};
+
+static_assert(std::is_trivially_copyable<GameState>::value,
+              "a GameState must be copyable with memcpy");
+static_assert(sizeof(GameState) == 24, "a GameState is 24 bytes");
+
+#endif  // GAMESTATE_H_
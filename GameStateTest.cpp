@@ -0,0 +1,84 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include "./Game2048.h"
+#include "./GameState.h"
+
+// ____________________________________________________________________________
+TEST(GameStateTest, start) {
+    Xoshiro256 rng(3);
+    Xoshiro256 same(3);
+    GameState state = GameState::start(rng);
+    ASSERT_TRUE(state == GameState::start(same));
+    ASSERT_EQ(14, state.board.countEmpty());
+    ASSERT_EQ(0, state.points);
+    ASSERT_EQ(0, state.steps);
+    ASSERT_FALSE(state.gameOver);
+    ASSERT_FALSE(state.gameWon);
+
+    // a copy is a copy of the bytes.
+    GameState copy;
+    std::memcpy(&copy, &state, sizeof(state));
+    ASSERT_TRUE(copy == state);
+}
+
+// ____________________________________________________________________________
+TEST(GameStateTest, move) {
+    // 2 2 4 . in the first row.
+    Bitboard board;
+    board.setExponent(0, 1);
+    board.setExponent(1, 1);
+    board.setExponent(2, 2);
+    GameState state = GameState::fromBoard(board);
+    GameState left = GameState::move(state, LEFT);
+    ASSERT_EQ(4, left.points);
+    ASSERT_EQ(1, left.steps);
+    ASSERT_EQ(2, left.board.exponent(0));
+    ASSERT_EQ(2, left.board.exponent(1));
+    // the state it came from is unchanged, and so is a useless move.
+    ASSERT_EQ(0, state.points);
+    ASSERT_TRUE(GameState::move(left, UP) == left);
+
+    GameState placed = GameState::place(left, 5, 11);
+    ASSERT_TRUE(placed.gameWon);
+    ASSERT_EQ(11, placed.board.exponent(5));
+
+    Xoshiro256 rng(1);
+    GameState played = GameState::play(state, LEFT, rng);
+    ASSERT_EQ(left.points, played.points);
+    ASSERT_EQ(left.board.countEmpty() - 1, played.board.countEmpty());
+    ASSERT_TRUE(GameState::play(left, UP, rng) == left);
+}
+
+// ____________________________________________________________________________
+TEST(GameStateTest, gameOver) {
+    // a full board without equal neighbors.
+    Bitboard board;
+    for (int i = 0; i < 16; i++) board.setExponent(i, (i + i / 4) % 2 + 1);
+    GameState state = GameState::fromBoard(board);
+    ASSERT_TRUE(state.gameOver);
+    Xoshiro256 rng(1);
+    ASSERT_TRUE(GameState::spawn(state, rng) == state);
+    // with a gap, some tile can move.
+    board.setExponent(0, 0);
+    ASSERT_FALSE(GameState::fromBoard(board).gameOver);
+}
+
+// ____________________________________________________________________________
+TEST(GameStateTest, game) {
+    // a Game reports the state it plays.
+    Game game;
+    game.restart(9);
+    Xoshiro256 rng(9);
+    GameState state = GameState::start(rng);
+    ASSERT_TRUE(state == game.current());
+    const int keys[4] = { 258, 259, 260, 261 };
+    const Direction dirs[4] = { DOWN, UP, LEFT, RIGHT };
+    for (int i = 0; i < 200 && !state.gameOver; i++) {
+        game.play(keys[i % 4]);
+        state = GameState::play(state, dirs[i % 4], rng);
+        ASSERT_TRUE(state == game.current());
+    }
+}
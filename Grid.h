@@ -0,0 +1,247 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef GRID_H_
+#define GRID_H_
+
+#include <cstdint>
+#include "./Bitboard.h"
+#include "./History.h"
+#include "./MoveTables.h"
+#include "./Random.h"
+#include "./Spawn.h"
+
+// An NxN board (3 <= N <= 8) with one byte per field holding the log2
+// exponent of its tile, as in Bitboard. The size is a template parameter,
+// so the field of every line position is a compile time constant (see
+// field()) and the compiler unrolls the move loops for each size.
+//
+// Grid<4> is specialized to wrap a Bitboard, so the classic game keeps
+// its table driven moves. Unlike there, tiles of the generic grids merge
+// up to any exponent.
+template <int N>
+class Grid {
+ public:
+    static_assert(N >= 3 && N <= 8, "boards from 3x3 to 8x8 are supported");
+    enum { kSize = N, kFields = N * N };
+
+    // An empty board.
+    Grid() : cells() {}
+
+    int exponent(int field) const { return cells[field]; }
+    void setExponent(int field, int expo) {
+        cells[field] = static_cast<uint8_t>(expo);
+    }
+
+    int countEmpty() const {
+        int empty = 0;
+        for (int i = 0; i < kFields; i++) empty += cells[i] == 0;
+        return empty;
+    }
+
+    // The board after moving all tiles in direction dir. Adds the points of
+    // the merges to *score (if not NULL), like MoveTables::move.
+    static Grid move(const Grid &grid, Direction dir, int* score) {
+        switch (dir) {
+            case LEFT: return moveTo<LEFT>(grid, score);
+            case RIGHT: return moveTo<RIGHT>(grid, score);
+            case UP: return moveTo<UP>(grid, score);
+            default: return moveTo<DOWN>(grid, score);
+        }
+    }
+
+    // Put a 2 (90%) or a 4 (10%) on a uniformly chosen empty field, drawing
+    // the field and then the value from rng like spawnTile. Returns the
+    // field, or -1 if the board is full.
+    int spawn(Xoshiro256 &rng) {
+        int empty = countEmpty();
+        if (empty == 0) return -1;
+        int n = rng.below(empty);
+        for (int i = 0; i < kFields; i++) {
+            if (cells[i] == 0 && n-- == 0) {
+                cells[i] = rng.below(10) == 0 ? 2 : 1;
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Field of the k-th position of a line when moving in direction dir,
+    // counting from the edge the tiles move to. Lines are the rows for
+    // LEFT and RIGHT and the columns for UP and DOWN.
+    static constexpr int field(int dir, int line, int k) {
+        return dir == LEFT ? line * N + k
+             : dir == RIGHT ? line * N + N - 1 - k
+             : dir == UP ? k * N + line
+             : (N - 1 - k) * N + line;
+    }
+
+    bool operator==(const Grid& other) const {
+        for (int i = 0; i < kFields; i++) {
+            if (cells[i] != other.cells[i]) return false;
+        }
+        return true;
+    }
+    bool operator!=(const Grid& other) const { return !(*this == other); }
+
+ private:
+    template <int Dir>
+    static Grid moveTo(const Grid &grid, int* score) {
+        Grid result;
+        int gained = 0;
+        for (int line = 0; line < N; line++) {
+            // next free position and the tile waiting for a merge partner.
+            int out = 0;
+            int pending = 0;
+            for (int k = 0; k < N; k++) {
+                int expo = grid.cells[field(Dir, line, k)];
+                if (expo == 0) continue;
+                if (expo == pending) {
+                    result.cells[field(Dir, line, out++)] = expo + 1;
+                    gained += 1 << (expo + 1);
+                    pending = 0;
+                } else {
+                    if (pending != 0) {
+                        result.cells[field(Dir, line, out++)] = pending;
+                    }
+                    pending = expo;
+                }
+            }
+            if (pending != 0) result.cells[field(Dir, line, out)] = pending;
+        }
+        if (score != NULL) *score += gained;
+        return result;
+    }
+
+    uint8_t cells[kFields];
+};
+
+// The 4x4 board: a Bitboard moved by the precomputed MoveTables.
+template <>
+class Grid<4> {
+ public:
+    enum { kSize = 4, kFields = 16 };
+
+    Grid() {}
+    explicit Grid(const Bitboard &board) : board(board) {}
+
+    int exponent(int field) const { return board.exponent(field); }
+    void setExponent(int field, int expo) { board.setExponent(field, expo); }
+
+    int countEmpty() const { return board.countEmpty(); }
+
+    static Grid move(const Grid &grid, Direction dir, int* score) {
+        return Grid(MoveTables::move(grid.board, dir, score));
+    }
+
+    int spawn(Xoshiro256 &rng) { return spawnTile(board, rng); }
+
+    bool operator==(const Grid& other) const { return board == other.board; }
+    bool operator!=(const Grid& other) const { return board != other.board; }
+
+    Bitboard board;
+};
+
+// The rules of 2048 on an NxN board: moves, spawned tiles, points, undo
+// and the end of the game. Game adds the interface (and the AI) for 4x4.
+template <int N>
+class GridGame {
+ public:
+    // A new game whose tiles are drawn from a generator seeded with seed.
+    explicit GridGame(uint64_t seed, int maxUndo = 0)
+        : maxUndo(maxUndo), rng(seed) {
+        reset();
+    }
+
+    // Start a new game with two random tiles.
+    void reset() {
+        Grid<N> first;
+        first.spawn(rng);
+        first.spawn(rng);
+        states.clear(first);
+        points = 0;
+        steps = 0;
+        undoCount = 0;
+        gameOver = false;
+        gameWon = false;
+    }
+
+    // Move in direction dir and spawn a tile. Returns false (and changes
+    // nothing) if the move does not change the board or the game is over.
+    bool play(Direction dir) {
+        if (gameOver) return false;
+        int score = 0;
+        Grid<N> next = Grid<N>::move(states.back(), dir, &score);
+        if (next == states.back()) return false;
+        next.spawn(rng);
+        // keep the last maxUndo + 1 states.
+        states.setCapacity(maxUndo + 1);
+        states.push(next, score);
+        points += score;
+        steps++;
+        undoCount = 0;
+        for (int i = 0; i < N * N; i++) {
+            if (next.exponent(i) >= 11) gameWon = true;
+        }
+        gameOver = isGameOver();
+        return true;
+    }
+
+    // Take back the last move (at most maxUndo in a row). Returns false if
+    // there is nothing to undo.
+    bool undo() {
+        int score;
+        if (undoCount >= maxUndo || !states.pop(&score)) return false;
+        points -= score;
+        steps--;
+        undoCount++;
+        gameOver = false;
+        return true;
+    }
+
+    // True if no move changes the board.
+    bool isGameOver() const {
+        for (int dir = 0; dir < 4; dir++) {
+            Direction d = static_cast<Direction>(dir);
+            if (Grid<N>::move(states.back(), d, NULL) != states.back()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const Grid<N>& grid() const { return states.back(); }
+
+    int points;
+    int steps;
+    bool gameOver;
+    bool gameWon;
+    int maxUndo;
+
+ private:
+    Xoshiro256 rng;
+    // the last states and the points of the moves leading to them.
+    BasicHistory<Grid<N>> states;
+    int undoCount;
+};
+
+// Board sizes selectable at run time.
+const int kMinGridSize = 3;
+const int kMaxGridSize = 8;
+
+// Call F<n>::run(args...) for a board size n only known at run time, so
+// each size runs its own instantiation. Returns -1 if n is not supported.
+template <template <int> class F, class... Args>
+int dispatchGridSize(int n, Args&... args) {
+    switch (n) {
+        case 3: return F<3>::run(args...);
+        case 4: return F<4>::run(args...);
+        case 5: return F<5>::run(args...);
+        case 6: return F<6>::run(args...);
+        case 7: return F<7>::run(args...);
+        case 8: return F<8>::run(args...);
+    }
+    return -1;
+}
+
+#endif  // GRID_H_
@@ -0,0 +1,153 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include "./Grid.h"
+#include "./MoveTables.h"
+#include "./Random.h"
+
+namespace {
+// A grid with the 4x4 board in its top left corner.
+template <int N>
+Grid<N> embed(const Bitboard &board) {
+    Grid<N> grid;
+    for (int r = 0; r < 4; r++) {
+        for (int c = 0; c < 4; c++) {
+            grid.setExponent(r * N + c, board.exponent(r * 4 + c));
+        }
+    }
+    return grid;
+}
+
+// Moving a board in the corner left or up must give the moves of the 4x4
+// tables (as long as no two 32768 tiles meet).
+template <int N>
+void checkAgainstMoveTables() {
+    Xoshiro256 rng(N);
+    for (int i = 0; i < 10000; i++) {
+        Bitboard board;
+        for (int f = 0; f < 16; f++) {
+            if (rng.below(3) != 0) board.setExponent(f, 1 + rng.below(14));
+        }
+        for (const auto& dir : { LEFT, UP }) {
+            int expected = 0;
+            int score = 0;
+            Bitboard moved = MoveTables::move(board, dir, &expected);
+            ASSERT_EQ(embed<N>(moved),
+                      Grid<N>::move(embed<N>(board), dir, &score));
+            ASSERT_EQ(expected, score);
+        }
+    }
+}
+
+template <int N>
+struct SizeOf {
+    static int run(int &calls) {
+        calls++;
+        return N;
+    }
+};
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(GridTest, field) {
+    static_assert(Grid<3>::field(LEFT, 1, 0) == 3, "row 1 starts at 3");
+    static_assert(Grid<3>::field(RIGHT, 1, 0) == 5, "from the right edge");
+    static_assert(Grid<3>::field(UP, 2, 1) == 5, "column 2, second row");
+    static_assert(Grid<3>::field(DOWN, 2, 0) == 8, "from the bottom edge");
+    ASSERT_EQ(63, Grid<8>::field(DOWN, 7, 0));
+    ASSERT_EQ(56, Grid<8>::field(LEFT, 7, 0));
+}
+
+// ____________________________________________________________________________
+TEST(GridTest, move) {
+    // 2 2 4 in the first row.
+    Grid<3> grid;
+    grid.setExponent(0, 1);
+    grid.setExponent(1, 1);
+    grid.setExponent(2, 2);
+    int score = 0;
+    Grid<3> left = Grid<3>::move(grid, LEFT, &score);
+    ASSERT_EQ(4, score);
+    ASSERT_EQ(2, left.exponent(0));
+    ASSERT_EQ(2, left.exponent(1));
+    ASSERT_EQ(0, left.exponent(2));
+    Grid<3> right = Grid<3>::move(grid, RIGHT, &score);
+    ASSERT_EQ(8, score);
+    ASSERT_EQ(0, right.exponent(0));
+    ASSERT_EQ(2, right.exponent(1));
+    ASSERT_EQ(2, right.exponent(2));
+    Grid<3> down = Grid<3>::move(grid, DOWN, NULL);
+    ASSERT_EQ(1, down.exponent(6));
+    ASSERT_EQ(2, down.exponent(8));
+    ASSERT_EQ(6, down.countEmpty());
+
+    // unlike on a Bitboard, 32768 tiles merge.
+    Grid<5> big;
+    big.setExponent(0, 15);
+    big.setExponent(1, 15);
+    ASSERT_EQ(16, Grid<5>::move(big, LEFT, NULL).exponent(0));
+
+    checkAgainstMoveTables<5>();
+    checkAgainstMoveTables<8>();
+}
+
+// ____________________________________________________________________________
+TEST(GridTest, spawn) {
+    Xoshiro256 rng(1);
+    Grid<3> grid;
+    for (int i = 0; i < 9; i++) {
+        int field = grid.spawn(rng);
+        ASSERT_GE(field, 0);
+        ASSERT_GE(grid.exponent(field), 1);
+        ASSERT_LE(grid.exponent(field), 2);
+    }
+    ASSERT_EQ(0, grid.countEmpty());
+    ASSERT_EQ(-1, grid.spawn(rng));
+}
+
+// ____________________________________________________________________________
+TEST(GridTest, game) {
+    GridGame<3> game(42, 2);
+    GridGame<3> same(42, 2);
+    ASSERT_EQ(7, game.grid().countEmpty());
+    ASSERT_TRUE(game.grid() == same.grid());
+
+    Grid<3> before = game.grid();
+    const Direction dirs[4] = { UP, LEFT, DOWN, RIGHT };
+    bool moved = false;
+    for (int i = 0; !moved; i++) moved = game.play(dirs[i % 4]);
+    ASSERT_EQ(1, game.steps);
+    ASSERT_TRUE(game.undo());
+    ASSERT_EQ(0, game.steps);
+    ASSERT_EQ(0, game.points);
+    ASSERT_TRUE(game.grid() == before);
+    ASSERT_FALSE(game.undo());
+
+    // a 3x3 game ends soon.
+    for (int i = 0; i < 10000 && !game.gameOver; i++) game.play(dirs[i % 4]);
+    ASSERT_TRUE(game.gameOver);
+    ASSERT_TRUE(game.isGameOver());
+    ASSERT_FALSE(game.play(LEFT));
+    ASSERT_GT(game.points, 0);
+
+    // after many moves, the last two can still be taken back.
+    int points = game.points;
+    int steps = game.steps;
+    ASSERT_TRUE(game.undo());
+    ASSERT_TRUE(game.undo());
+    ASSERT_FALSE(game.undo());
+    ASSERT_EQ(steps - 2, game.steps);
+    ASSERT_LE(game.points, points);
+    ASSERT_FALSE(game.gameOver);
+}
+
+// ____________________________________________________________________________
+TEST(GridTest, dispatchGridSize) {
+    int calls = 0;
+    for (int n = kMinGridSize; n <= kMaxGridSize; n++) {
+        ASSERT_EQ(n, dispatchGridSize<SizeOf>(n, calls));
+    }
+    ASSERT_EQ(-1, dispatchGridSize<SizeOf>(9, calls));
+    ASSERT_EQ(6, calls);
+}
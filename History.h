@@ -0,0 +1,102 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "./Bitboard.h"
+
+// The last few states of a game in a ring buffer of fixed capacity, each
+// with the points its move scored, so undoing a move restores board and
+// score exactly. Once full, pushing a state drops the oldest one, so the
+// memory stays O(capacity) however long the game gets. State is the board
+// type: a Bitboard for the classic game (History), a Grid for the others.
+template <class State>
+class BasicHistory {
+ public:
+    // A history with room for capacity states (at least 1).
+    explicit BasicHistory(size_t capacity = 1)
+        : boards(std::max<size_t>(capacity, 1)),
+          deltas(std::max<size_t>(capacity, 1), 0), first(0), count(1) {}
+
+    // Change the capacity, keeping the newest states.
+    void setCapacity(size_t capacity) {
+        capacity = std::max<size_t>(capacity, 1);
+        if (capacity == boards.size()) return;
+        size_t keep = std::min(count, capacity);
+        std::vector<State> newBoards(capacity);
+        std::vector<int> newDeltas(capacity, 0);
+        for (size_t i = 0; i < keep; i++) {
+            newBoards[i] = (*this)[count - keep + i];
+            newDeltas[i] = scoreDelta(count - keep + i);
+        }
+        // the oldest kept state has no move to undo anymore.
+        newDeltas[0] = 0;
+        boards.swap(newBoards);
+        deltas.swap(newDeltas);
+        first = 0;
+        count = keep;
+    }
+    size_t capacity() const { return boards.size(); }
+
+    // Forget everything and start over with the first state of a game.
+    void clear(const State &board) {
+        first = 0;
+        count = 1;
+        boards[0] = board;
+        deltas[0] = 0;
+    }
+
+    // Append the state after a move that scored scoreDelta points.
+    void push(const State &board, int scoreDelta) {
+        if (count == boards.size()) {
+            // full: overwrite the oldest state.
+            first = (first + 1) % boards.size();
+            count--;
+            deltas[first] = 0;
+        }
+        size_t slot = index(count);
+        boards[slot] = board;
+        deltas[slot] = scoreDelta;
+        count++;
+    }
+
+    // Drop the newest state and return the points its move scored. The
+    // oldest state is never dropped; returns false if it is the only one.
+    bool pop(int* scoreDelta) {
+        if (count <= 1) return false;
+        *scoreDelta = deltas[index(count - 1)];
+        count--;
+        return true;
+    }
+
+    // Number of states kept, at least 1.
+    size_t size() const { return count; }
+
+    // State i, counting from the oldest kept one (size() - 1 is newest).
+    State& operator[](size_t i) { return boards[index(i)]; }
+    const State& operator[](size_t i) const { return boards[index(i)]; }
+
+    // Points scored by the move leading to state i (0 for the first state).
+    int scoreDelta(size_t i) const { return deltas[index(i)]; }
+
+    // The current state.
+    State& back() { return (*this)[count - 1]; }
+    const State& back() const { return (*this)[count - 1]; }
+
+ private:
+    size_t index(size_t i) const { return (first + i) % boards.size(); }
+
+    std::vector<State> boards;
+    std::vector<int> deltas;
+    // slot of the oldest state and number of states kept.
+    size_t first;
+    size_t count;
+};
+
+typedef BasicHistory<Bitboard> History;
+
+#endif  // HISTORY_H_
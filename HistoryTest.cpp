@@ -0,0 +1,50 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include "./History.h"
+
+// ____________________________________________________________________________
+TEST(HistoryTest, ring) {
+    History history(3);
+    history.clear(Bitboard(1));
+    ASSERT_EQ(1u, history.size());
+    ASSERT_EQ(Bitboard(1), history.back());
+
+    for (int i = 2; i <= 5; i++) history.push(Bitboard(i), 10 * i);
+    // only the newest three are kept.
+    ASSERT_EQ(3u, history.size());
+    ASSERT_EQ(Bitboard(3), history[0]);
+    ASSERT_EQ(Bitboard(5), history.back());
+    ASSERT_EQ(0, history.scoreDelta(0));  // nothing to undo before it.
+    ASSERT_EQ(50, history.scoreDelta(2));
+
+    int score;
+    ASSERT_TRUE(history.pop(&score));
+    ASSERT_EQ(50, score);
+    ASSERT_TRUE(history.pop(&score));
+    ASSERT_EQ(40, score);
+    ASSERT_FALSE(history.pop(&score));
+    ASSERT_EQ(Bitboard(3), history.back());
+}
+
+// ____________________________________________________________________________
+TEST(HistoryTest, setCapacity) {
+    History history(1);
+    history.clear(Bitboard(1));
+    history.push(Bitboard(2), 20);
+    ASSERT_EQ(1u, history.size());
+    ASSERT_EQ(Bitboard(2), history.back());
+
+    history.setCapacity(4);
+    for (int i = 3; i <= 5; i++) history.push(Bitboard(i), 10 * i);
+    ASSERT_EQ(4u, history.size());
+    ASSERT_EQ(Bitboard(2), history[0]);
+
+    // shrinking keeps the newest states.
+    history.setCapacity(2);
+    ASSERT_EQ(2u, history.size());
+    ASSERT_EQ(Bitboard(4), history[0]);
+    ASSERT_EQ(Bitboard(5), history[1]);
+    ASSERT_EQ(50, history.scoreDelta(1));
+}
@@ -0,0 +1,190 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <cstdio>
+#include <fstream>
+#include "./Metrics.h"
+
+namespace {
+const char* const kCounterNames[Metrics::kCounters] = {
+    "moves", "spawns", "spawn_full", "rng_draws"
+};
+const char* const kTimerNames[Metrics::kTimers] = {
+    "play", "update_state", "add_random", "is_game_over", "draw_board"
+};
+const double kQuantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+}  // namespace
+
+std::atomic<int64_t> Metrics::counters[kCounters];
+std::atomic<int64_t> Metrics::buckets[kTimers][kBuckets];
+std::atomic<int64_t> Metrics::sums[kTimers];
+std::atomic<int64_t> Metrics::maxima[kTimers];
+
+// ___________________________________________________________________________
+bool Metrics::enabled() {
+#ifdef GAME2048_METRICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// ___________________________________________________________________________
+int Metrics::bucket(int64_t nanos) {
+    if (nanos < 4) return nanos < 0 ? 0 : nanos;
+    // the leading bit and the two bits after it.
+    int e = 63 - __builtin_clzll(nanos);
+    int sub = (nanos >> (e - 2)) & 3;
+    return 4 + (e - 2) * 4 + sub;
+}
+
+// ___________________________________________________________________________
+int64_t Metrics::bucketStart(int bucket) {
+    if (bucket < 4) return bucket;
+    int e = (bucket - 4) / 4 + 2;
+    return int64_t(4 + (bucket - 4) % 4) << (e - 2);
+}
+
+// ___________________________________________________________________________
+void Metrics::record(Timer timer, int64_t nanos) {
+    buckets[timer][bucket(nanos)].fetch_add(1, std::memory_order_relaxed);
+    sums[timer].fetch_add(nanos, std::memory_order_relaxed);
+    int64_t max = maxima[timer].load(std::memory_order_relaxed);
+    while (nanos > max && !maxima[timer].compare_exchange_weak(
+            max, nanos, std::memory_order_relaxed)) {}
+}
+
+// ___________________________________________________________________________
+int64_t Metrics::calls(Timer timer) {
+    int64_t total = 0;
+    for (const auto& count : buckets[timer]) {
+        total += count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// ___________________________________________________________________________
+int64_t Metrics::maxNanos(Timer timer) {
+    return maxima[timer].load(std::memory_order_relaxed);
+}
+
+// ___________________________________________________________________________
+double Metrics::meanNanos(Timer timer) {
+    int64_t n = calls(timer);
+    if (n == 0) return 0;
+    return static_cast<double>(sums[timer].load(std::memory_order_relaxed)) /
+           n;
+}
+
+// ___________________________________________________________________________
+int64_t Metrics::percentile(Timer timer, double p) {
+    int64_t n = calls(timer);
+    if (n == 0) return 0;
+    // the same rank as Histogram::percentile.
+    int64_t rank = static_cast<int64_t>(p * (n - 1));
+    int64_t seen = 0;
+    for (int b = 0; b < kBuckets; b++) {
+        seen += buckets[timer][b].load(std::memory_order_relaxed);
+        if (seen > rank) return bucketStart(b);
+    }
+    return bucketStart(kBuckets - 1);
+}
+
+// ___________________________________________________________________________
+void Metrics::reset() {
+    for (auto& counter : counters) counter.store(0);
+    for (int t = 0; t < kTimers; t++) {
+        for (auto& count : buckets[t]) count.store(0);
+        sums[t].store(0);
+        maxima[t].store(0);
+    }
+}
+
+// ___________________________________________________________________________
+void Metrics::writeText(std::ostream &out) {
+    for (int c = 0; c < kCounters; c++) {
+        out << "game2048_" << kCounterNames[c] << "_total "
+            << counter(static_cast<Counter>(c)) << "\n";
+    }
+    for (int t = 0; t < kTimers; t++) {
+        Timer timer = static_cast<Timer>(t);
+        const char* name = kTimerNames[t];
+        for (const auto& q : kQuantiles) {
+            out << "game2048_" << name << "_ns{quantile=\"" << q << "\"} "
+                << percentile(timer, q) << "\n";
+        }
+        out << "game2048_" << name << "_ns_sum "
+            << sums[t].load(std::memory_order_relaxed) << "\n"
+            << "game2048_" << name << "_ns_count " << calls(timer) << "\n"
+            << "game2048_" << name << "_ns_max " << maxNanos(timer) << "\n";
+    }
+}
+
+// ___________________________________________________________________________
+void Metrics::writeJson(std::ostream &out) {
+    out << "{\"enabled\": " << (enabled() ? "true" : "false")
+        << ", \"counters\": {";
+    for (int c = 0; c < kCounters; c++) {
+        out << (c > 0 ? ", " : "") << "\"" << kCounterNames[c] << "\": "
+            << counter(static_cast<Counter>(c));
+    }
+    out << "}, \"timers\": {";
+    for (int t = 0; t < kTimers; t++) {
+        Timer timer = static_cast<Timer>(t);
+        out << (t > 0 ? ", " : "") << "\"" << kTimerNames[t] << "\": {"
+            << "\"count\": " << calls(timer)
+            << ", \"mean_ns\": " << meanNanos(timer)
+            << ", \"p50_ns\": " << percentile(timer, 0.5)
+            << ", \"p90_ns\": " << percentile(timer, 0.9)
+            << ", \"p99_ns\": " << percentile(timer, 0.99)
+            << ", \"p999_ns\": " << percentile(timer, 0.999)
+            << ", \"max_ns\": " << maxNanos(timer) << "}";
+    }
+    out << "}}\n";
+}
+
+// ___________________________________________________________________________
+bool Metrics::dump(const std::string &path) {
+    // write a new file and rename it, so readers never see half a dump.
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary.c_str());
+        if (!file) return false;
+        bool json = path.size() >= 5 &&
+                    path.compare(path.size() - 5, 5, ".json") == 0;
+        if (json) {
+            writeJson(file);
+        } else {
+            writeText(file);
+        }
+        if (!file.flush()) return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+// ___________________________________________________________________________
+MetricsDumper::MetricsDumper(const std::string &path, double seconds)
+    : path(path), seconds(seconds), stopping(false) {
+    if (seconds > 0) thread = std::thread(&MetricsDumper::loop, this);
+}
+
+// ___________________________________________________________________________
+MetricsDumper::~MetricsDumper() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable()) thread.join();
+    Metrics::dump(path);
+}
+
+// ___________________________________________________________________________
+void MetricsDumper::loop() {
+    auto period = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::duration<double>(seconds));
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, period, [this] { return stopping; })) {
+        Metrics::dump(path);
+    }
+}
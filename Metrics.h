@@ -0,0 +1,127 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Counters and latency histograms of the hot paths of the game (play,
+// updateState, addRandom, isGameOver, drawBoard), shared by all games of
+// the process. The instrumentation is compiled in only with
+// -DGAME2048_METRICS ("make METRICS=1"); otherwise the METRIC_ macros
+// expand to nothing and all metrics stay 0.
+//
+// Latencies go into log-linear buckets (4 per power of two, so within
+// 25%) of relaxed atomic counts, which makes recording a few
+// nanoseconds and safe from any thread.
+class Metrics {
+ public:
+    enum Counter {
+        // moves that changed the board.
+        MOVES,
+        // tiles spawned, spawns on a full board and random numbers drawn
+        // by spawns (two per tile, spawning never retries).
+        SPAWNS,
+        SPAWN_FULL,
+        RNG_DRAWS,
+        kCounters
+    };
+    enum Timer {
+        PLAY,
+        UPDATE_STATE,
+        ADD_RANDOM,
+        IS_GAME_OVER,
+        DRAW_BOARD,
+        kTimers
+    };
+
+    // Whether the instrumentation is compiled in.
+    static bool enabled();
+
+    static void count(Counter counter, int64_t n) {
+        counters[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+    static void record(Timer timer, int64_t nanos);
+
+    static int64_t counter(Counter counter) {
+        return counters[counter].load(std::memory_order_relaxed);
+    }
+    static int64_t calls(Timer timer);
+    static int64_t maxNanos(Timer timer);
+    static double meanNanos(Timer timer);
+    // Lower bound of the bucket containing the p-th percentile.
+    static int64_t percentile(Timer timer, double p);
+
+    // Set all metrics back to 0.
+    static void reset();
+
+    // All metrics in the Prometheus text format or as JSON.
+    static void writeText(std::ostream &out);
+    static void writeJson(std::ostream &out);
+
+    // Write all metrics to path (JSON if it ends in ".json", text else),
+    // replacing the file atomically. Returns false on errors.
+    static bool dump(const std::string &path);
+
+    // Measures the time until the end of its scope.
+    class ScopedTimer {
+     public:
+        explicit ScopedTimer(Timer timer)
+            : timer(timer), start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() {
+            record(timer, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+        }
+
+     private:
+        Timer timer;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    static const int kBuckets = 4 + 62 * 4;
+
+ private:
+    static int bucket(int64_t nanos);
+    static int64_t bucketStart(int bucket);
+
+    static std::atomic<int64_t> counters[kCounters];
+    static std::atomic<int64_t> buckets[kTimers][kBuckets];
+    static std::atomic<int64_t> sums[kTimers];
+    static std::atomic<int64_t> maxima[kTimers];
+};
+
+// Dumps the metrics to a file every few seconds (if seconds > 0) from a
+// thread of its own, and once more when it is destroyed.
+class MetricsDumper {
+ public:
+    MetricsDumper(const std::string &path, double seconds);
+    ~MetricsDumper();
+
+ private:
+    void loop();
+
+    std::string path;
+    double seconds;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread thread;
+};
+
+#ifdef GAME2048_METRICS
+#define METRIC_COUNT(counter, n) Metrics::count(Metrics::counter, n)
+#define METRIC_TIME(timer) Metrics::ScopedTimer metricTimer(Metrics::timer)
+#else
+#define METRIC_COUNT(counter, n) do {} while (0)
+#define METRIC_TIME(timer) do {} while (0)
+#endif
+
+#endif  // METRICS_H_
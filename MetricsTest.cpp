@@ -0,0 +1,88 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "./Game2048.h"
+#include "./Metrics.h"
+
+// ____________________________________________________________________________
+TEST(MetricsTest, percentiles) {
+    Metrics::reset();
+    for (int i = 1; i <= 100; i++) Metrics::record(Metrics::PLAY, i * 100);
+    ASSERT_EQ(100, Metrics::calls(Metrics::PLAY));
+    ASSERT_EQ(10000, Metrics::maxNanos(Metrics::PLAY));
+    ASSERT_DOUBLE_EQ(5050, Metrics::meanNanos(Metrics::PLAY));
+    // buckets are at most 25% wide.
+    int64_t p50 = Metrics::percentile(Metrics::PLAY, 0.5);
+    ASSERT_LE(p50, 5000);
+    ASSERT_GT(p50, 5000 * 3 / 4);
+    int64_t p99 = Metrics::percentile(Metrics::PLAY, 0.99);
+    ASSERT_LE(p99, 9900);
+    ASSERT_GT(p99, 9900 * 3 / 4);
+    ASSERT_EQ(0, Metrics::percentile(Metrics::DRAW_BOARD, 0.5));
+
+    Metrics::count(Metrics::MOVES, 5);
+    ASSERT_EQ(5, Metrics::counter(Metrics::MOVES));
+    Metrics::reset();
+    ASSERT_EQ(0, Metrics::counter(Metrics::MOVES));
+    ASSERT_EQ(0, Metrics::calls(Metrics::PLAY));
+}
+
+// ____________________________________________________________________________
+TEST(MetricsTest, game) {
+    Metrics::reset();
+    Game game;
+    const int keys[4] = { 258, 259, 260, 261 };
+    for (int i = 0; i < 100; i++) game.play(keys[i % 4]);
+    if (Metrics::enabled()) {
+        ASSERT_EQ(100, Metrics::calls(Metrics::PLAY));
+        ASSERT_EQ(game.steps, Metrics::counter(Metrics::MOVES));
+        // two spawns for the board of the constructor.
+        ASSERT_EQ(game.steps, Metrics::counter(Metrics::SPAWNS) - 2);
+        ASSERT_EQ(2 * Metrics::counter(Metrics::SPAWNS),
+                  Metrics::counter(Metrics::RNG_DRAWS));
+        ASSERT_EQ(game.steps, Metrics::calls(Metrics::IS_GAME_OVER));
+    } else {
+        // compiled out: nothing is measured.
+        ASSERT_EQ(0, Metrics::calls(Metrics::PLAY));
+        ASSERT_EQ(0, Metrics::counter(Metrics::MOVES));
+    }
+}
+
+// ____________________________________________________________________________
+TEST(MetricsTest, dump) {
+    Metrics::reset();
+    Metrics::record(Metrics::UPDATE_STATE, 40);
+    Metrics::count(Metrics::SPAWNS, 7);
+    std::ostringstream text;
+    Metrics::writeText(text);
+    ASSERT_NE(std::string::npos,
+              text.str().find("game2048_spawns_total 7\n"));
+    ASSERT_NE(std::string::npos, text.str().find(
+            "game2048_update_state_ns{quantile=\"0.5\"} 40\n"));
+    ASSERT_NE(std::string::npos,
+              text.str().find("game2048_update_state_ns_count 1\n"));
+
+    char directory[] = "/tmp/MetricsTest.XXXXXX";
+    ASSERT_TRUE(mkdtemp(directory) != NULL);
+    std::string path = std::string(directory) + "/metrics.json";
+    {
+        // dumps at least once when it is destroyed.
+        MetricsDumper dumper(path, 0.01);
+        usleep(30000);
+    }
+    std::ifstream file(path.c_str());
+    std::string json((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    ASSERT_EQ(0u, json.find("{\"enabled\": "));
+    ASSERT_NE(std::string::npos, json.find("\"spawns\": 7"));
+    ASSERT_NE(std::string::npos, json.find(
+            "\"update_state\": {\"count\": 1, \"mean_ns\": 40"));
+    unlink(path.c_str());
+    rmdir(directory);
+}
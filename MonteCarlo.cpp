@@ -0,0 +1,151 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include "./MonteCarlo.h"
+
+// ___________________________________________________________________________
+MonteCarlo::MonteCarlo(double budgetMs, int numThreads, Rollout rollout,
+        uint64_t seed)
+    : budgetMs(budgetMs), kind(rollout), pool(numThreads), total(0),
+      seconds(0) {
+    rngs.resize(pool.size());
+    reseed(seed);
+    tasks.resize(pool.size());
+    for (auto& score : scores) score = -1;
+}
+
+// ___________________________________________________________________________
+void MonteCarlo::reseed(uint64_t seed) {
+    for (int t = 0; t < pool.size(); t++) {
+        rngs[t].seed(Simulation::gameSeed(seed, t));
+    }
+}
+
+// ___________________________________________________________________________
+bool MonteCarlo::parsePolicy(const std::string &name, Rollout* rollout) {
+    if (name == "montecarlo") {
+        *rollout = RANDOM;
+    } else if (name == "montecarlo-greedy") {
+        *rollout = GREEDY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ___________________________________________________________________________
+int MonteCarlo::rollout(GameState state, Rollout rollout, Xoshiro256 &rng) {
+    int start = state.points;
+    while (!state.gameOver) {
+        Direction dir = static_cast<Direction>(rng.below(4));
+        if (rollout == GREEDY) {
+            // the move scoring the most, ties broken by the random one.
+            int best = -1;
+            for (int i = 0; i < 4; i++) {
+                Direction d = static_cast<Direction>((dir + i) & 3);
+                int score = 0;
+                Bitboard moved = MoveTables::move(state.board, d, &score);
+                if (moved != state.board && score > best) {
+                    best = score;
+                    dir = d;
+                }
+            }
+        }
+        // illegal random moves leave the state as it is and are drawn again.
+        state = GameState::play(state, dir, rng);
+    }
+    return state.points - start;
+}
+
+// ___________________________________________________________________________
+void MonteCarlo::runTask(int task, const GameState &root, const int* moves,
+        int numMoves, int64_t minRollouts,
+        std::chrono::steady_clock::time_point deadline) {
+    Task& result = tasks[task];
+    Xoshiro256& rng = rngs[task];
+    for (int d = 0; d < 4; d++) {
+        result.sums[d] = 0;
+        result.counts[d] = 0;
+    }
+    // the tasks start at different moves, so all get about as many.
+    for (int64_t i = 0;; i++) {
+        if (i >= minRollouts &&
+            std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        int move = moves[(task + i) % numMoves];
+        GameState after = GameState::play(root, static_cast<Direction>(move),
+                                          rng);
+        result.sums[move] += after.points - root.points +
+                             rollout(after, kind, rng);
+        result.counts[move]++;
+    }
+}
+
+// ___________________________________________________________________________
+int MonteCarlo::bestMove(const Bitboard &board) {
+    for (auto& score : scores) score = -1;
+    int legal = MoveTables::summarize(board).legalMoves;
+    int moves[4];
+    int numMoves = 0;
+    for (int d = 0; d < 4; d++) {
+        if (legal & (1 << d)) moves[numMoves++] = d;
+    }
+    if (numMoves == 0) return -1;
+    if (numMoves == 1) return moves[0];
+
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<
+            std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::milli>(budgetMs));
+    GameState root = GameState::fromBoard(board);
+    WorkStealingPool::Group group(&pool);
+    for (int t = 0; t < pool.size(); t++) {
+        // task 0 makes sure that every move gets a rollout.
+        int64_t minRollouts = t == 0 ? numMoves : 0;
+        group.spawn([this, t, &root, &moves, numMoves, minRollouts,
+                     deadline] {
+            runTask(t, root, moves, numMoves, minRollouts, deadline);
+        });
+    }
+    group.wait();
+
+    int64_t sums[4] = { 0, 0, 0, 0 };
+    int64_t counts[4] = { 0, 0, 0, 0 };
+    for (const auto& task : tasks) {
+        for (int d = 0; d < 4; d++) {
+            sums[d] += task.sums[d];
+            counts[d] += task.counts[d];
+        }
+    }
+    int best = moves[0];
+    for (int i = 0; i < numMoves; i++) {
+        int d = moves[i];
+        total += counts[d];
+        scores[d] = counts[d] > 0 ? static_cast<double>(sums[d]) / counts[d]
+                                  : 0;
+        if (scores[d] > scores[best]) best = d;
+    }
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    seconds += elapsed.count();
+    return best;
+}
+
+// ___________________________________________________________________________
+double MonteCarlo::rolloutsPerSecond() const {
+    return seconds > 0 ? total / seconds : 0;
+}
+
+// ___________________________________________________________________________
+MonteCarloPolicy::MonteCarloPolicy(double budgetMs, int numThreads,
+        MonteCarlo::Rollout rollout)
+    : search(budgetMs, numThreads, rollout) {
+}
+
+// ___________________________________________________________________________
+Direction MonteCarloPolicy::choose(const Bitboard &board, SimulationRng &rng) {
+    search.reseed(rng());
+    int move = search.bestMove(board);
+    return move < 0 ? UP : static_cast<Direction>(move);
+}
@@ -0,0 +1,93 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef MONTECARLO_H_
+#define MONTECARLO_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "./Bitboard.h"
+#include "./GameState.h"
+#include "./ParallelSearch.h"
+#include "./Random.h"
+#include "./Simulation.h"
+
+// Picks moves by Monte Carlo rollouts instead of deep search: every legal
+// move is played many times, each time followed by a quick game to the
+// end (random or greedy moves, tiles spawned as in the game), and the move
+// whose games score the most points on average wins. The rollouts are
+// split into one task per thread on a WorkStealingPool, every task with a
+// generator of its own, and stop at a deadline, so the time per move is
+// fixed while the quality grows with the budget and the cores (anytime).
+class MonteCarlo {
+ public:
+    enum Rollout { RANDOM = 0, GREEDY = 1 };
+
+    // budgetMs is the time per move; numThreads counts the calling thread
+    // (0 = one per core).
+    MonteCarlo(double budgetMs, int numThreads, Rollout rollout = RANDOM,
+               uint64_t seed = 1);
+
+    // The move with the best mean rollout score, or -1 if no move is
+    // possible. Every legal move gets at least one rollout, even if that
+    // takes longer than the budget.
+    int bestMove(const Bitboard &board);
+
+    // Seed the generators of the tasks anew, as the constructor does.
+    void reseed(uint64_t seed);
+
+    // Mean rollout score of the four moves in the last search (-1 for
+    // illegal ones).
+    const double* lastScores() const { return scores; }
+
+    // Whether name is one of the Monte Carlo policies, and its rollouts.
+    static bool parsePolicy(const std::string &name, Rollout* rollout);
+
+    // Points gained by a rollout from state until the game is over.
+    static int rollout(GameState state, Rollout rollout, Xoshiro256 &rng);
+
+    // Rollouts and time of all searches so far.
+    int64_t rollouts() const { return total; }
+    double rolloutsPerSecond() const;
+
+    int threads() const { return pool.size(); }
+
+ private:
+    // Rollouts of one task until the deadline (at least minRollouts).
+    struct Task {
+        int64_t sums[4];
+        int64_t counts[4];
+    };
+    void runTask(int task, const GameState &root, const int* moves,
+                 int numMoves, int64_t minRollouts,
+                 std::chrono::steady_clock::time_point deadline);
+
+    double budgetMs;
+    Rollout kind;
+    WorkStealingPool pool;
+    std::vector<Xoshiro256> rngs;
+    std::vector<Task> tasks;
+    double scores[4];
+    int64_t total;
+    double seconds;
+};
+
+// MonteCarlo as a Policy for headless games ("montecarlo" and
+// "montecarlo-greedy" in Policy::create). The rollouts of every move are
+// seeded from the game's generator, so games of different seeds do not
+// share them.
+class MonteCarloPolicy : public Policy {
+ public:
+    MonteCarloPolicy(double budgetMs, int numThreads,
+                     MonteCarlo::Rollout rollout);
+
+    Direction choose(const Bitboard &board, SimulationRng &rng);
+    int64_t rollouts() const { return search.rollouts(); }
+
+ private:
+    MonteCarlo search;
+};
+
+#endif  // MONTECARLO_H_
@@ -0,0 +1,96 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "./MonteCarlo.h"
+#include "./Simulation.h"
+
+// ____________________________________________________________________________
+TEST(MonteCarloTest, rollout) {
+    Xoshiro256 rng(1);
+    Xoshiro256 same(1);
+    GameState start = GameState::start(rng);
+    same = rng;
+    int points = MonteCarlo::rollout(start, MonteCarlo::RANDOM, rng);
+    ASSERT_GT(points, 0);
+    ASSERT_EQ(points, MonteCarlo::rollout(start, MonteCarlo::RANDOM, same));
+    // greedy rollouts last longer than random ones on average.
+    int64_t random = 0;
+    int64_t greedy = 0;
+    for (int i = 0; i < 200; i++) {
+        random += MonteCarlo::rollout(start, MonteCarlo::RANDOM, rng);
+        greedy += MonteCarlo::rollout(start, MonteCarlo::GREEDY, rng);
+    }
+    ASSERT_GT(greedy, random);
+
+    MonteCarlo::Rollout rollout;
+    ASSERT_TRUE(MonteCarlo::parsePolicy("montecarlo-greedy", &rollout));
+    ASSERT_EQ(MonteCarlo::GREEDY, rollout);
+    ASSERT_FALSE(MonteCarlo::parsePolicy("greedy", &rollout));
+}
+
+// ____________________________________________________________________________
+TEST(MonteCarloTest, bestMove) {
+    MonteCarlo search(5, 2);
+    ASSERT_EQ(2, search.threads());
+    // a full board without any move.
+    Bitboard board;
+    for (int i = 0; i < 16; i++) board.setExponent(i, (i + i / 4) % 2 + 1);
+    ASSERT_EQ(-1, search.bestMove(board));
+    ASSERT_EQ(0, search.rollouts());
+    // with one gap, the move found is one of the legal ones.
+    board.setExponent(12, 0);
+    int move = search.bestMove(board);
+    ASSERT_GE(move, 0);
+    ASSERT_TRUE(MoveTables::summarize(board).legalMoves & (1 << move));
+    ASSERT_LT(search.lastScores()[UP], 0);
+
+    // a fresh board: all four moves are legal and get rollouts.
+    Bitboard two(0);
+    two.setExponent(0, 10);
+    two.setExponent(5, 10);
+    auto start = std::chrono::steady_clock::now();
+    move = search.bestMove(two);
+    std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+    // the budget holds (with some slack for a busy machine).
+    ASSERT_LT(elapsed.count(), 200);
+    ASSERT_GT(search.rollouts(), 4);
+    ASSERT_GT(search.rolloutsPerSecond(), 0);
+    for (int d = 0; d < 4; d++) {
+        ASSERT_GT(search.lastScores()[d], 0);
+        ASSERT_LE(search.lastScores()[d], search.lastScores()[move]);
+    }
+
+    // without a budget, one rollout per move: the same seed gives the
+    // same rollouts, another seed others.
+    MonteCarlo single(0, 1);
+    single.reseed(7);
+    single.bestMove(two);
+    std::vector<double> first(single.lastScores(), single.lastScores() + 4);
+    single.reseed(7);
+    single.bestMove(two);
+    ASSERT_EQ(first, std::vector<double>(single.lastScores(),
+                                         single.lastScores() + 4));
+    single.reseed(8);
+    single.bestMove(two);
+    ASSERT_NE(first, std::vector<double>(single.lastScores(),
+                                         single.lastScores() + 4));
+}
+
+// ____________________________________________________________________________
+TEST(MonteCarloTest, policy) {
+    // a short game: the policy with a tiny budget beats random moves.
+    std::unique_ptr<Policy> policy(Policy::create("montecarlo"));
+    ASSERT_TRUE(policy != NULL);
+    Simulation simulation([] {
+        return new MonteCarloPolicy(0.2, 1, MonteCarlo::RANDOM);
+    }, 1);
+    SimulationStats stats = simulation.run(2, 1);
+    ASSERT_GT(stats.rollouts, 0);
+    Simulation random("random", 1);
+    ASSERT_GT(stats.scores.mean(), random.run(2, 1).scores.mean());
+}
@@ -0,0 +1,75 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include "./MoveTables.h"
+
+uint16_t MoveTables::rowLeft[65536];
+uint16_t MoveTables::rowRight[65536];
+uint32_t MoveTables::scoreLeft[65536];
+uint32_t MoveTables::scoreRight[65536];
+const bool MoveTables::built = MoveTables::build();
+
+namespace {
+// mirror the four nibbles of a row.
+uint16_t reverseRow(uint16_t row) {
+    return static_cast<uint16_t>((row >> 12) | ((row >> 4) & 0x00F0) |
+                                 ((row << 4) & 0x0F00) | (row << 12));
+}
+}  // namespace
+
+// ___________________________________________________________________________
+bool MoveTables::build() {
+    for (int row = 0; row < 65536; row++) {
+        // collect the non-empty fields, i.e. slide everything to the left.
+        int line[4];
+        int n = 0;
+        for (int i = 0; i < 4; i++) {
+            int expo = (row >> (4 * i)) & 0xF;
+            if (expo != 0) line[n++] = expo;
+        }
+        // merge equal neighbours from left to right, each tile only once.
+        // Two 32768 tiles are not merged since 65536 does not fit a nibble.
+        int result[4] = { 0, 0, 0, 0 };
+        int r = 0;
+        uint32_t score = 0;
+        for (int i = 0; i < n; i++) {
+            if (i + 1 < n && line[i] == line[i + 1] && line[i] < 15) {
+                result[r++] = line[i] + 1;
+                score += 1u << (line[i] + 1);
+                i++;
+            } else {
+                result[r++] = line[i];
+            }
+        }
+        uint16_t moved = static_cast<uint16_t>(
+                result[0] | result[1] << 4 | result[2] << 8 | result[3] << 12);
+
+        rowLeft[row] = moved;
+        scoreLeft[row] = score;
+        // moving right is moving the mirrored row left.
+        uint16_t mirrored = reverseRow(static_cast<uint16_t>(row));
+        rowRight[mirrored] = reverseRow(moved);
+        scoreRight[mirrored] = score;
+    }
+    return true;
+}
+
+// ___________________________________________________________________________
+Bitboard MoveTables::move(const Bitboard &board, Direction dir, int* score) {
+    const bool vertical = dir == UP || dir == DOWN;
+    const bool toLow = dir == LEFT || dir == UP;
+    const uint16_t* rows = toLow ? rowLeft : rowRight;
+    const uint32_t* scores = toLow ? scoreLeft : scoreRight;
+
+    // columns become rows in the transposed board.
+    uint64_t bits = vertical ? transpose(board.bits) : board.bits;
+    uint64_t result = 0;
+    uint32_t gained = 0;
+    for (int r = 0; r < 4; r++) {
+        uint16_t row = static_cast<uint16_t>(bits >> (16 * r));
+        result |= uint64_t(rows[row]) << (16 * r);
+        gained += scores[row];
+    }
+    if (score != NULL) *score += static_cast<int>(gained);
+    return Bitboard(vertical ? transpose(result) : result);
+}
@@ -0,0 +1,127 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef MOVETABLES_H_
+#define MOVETABLES_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "./Bitboard.h"
+
+// The four possible moves.
+enum Direction { LEFT = 0, RIGHT = 1, UP = 2, DOWN = 3 };
+
+// Human readable name of a direction.
+inline const char* directionName(int dir) {
+    static const char* const names[4] = { "left", "right", "up", "down" };
+    return dir >= 0 && dir < 4 ? names[dir] : "none";
+}
+
+// What a board allows next, see MoveTables::summarize.
+struct BoardSummary {
+    // bit d is set iff moving in Direction d changes the board.
+    int legalMoves;
+    int maxExponent;
+    int empty;
+};
+
+// Precomputed results of moving a single row. A row is a 16 bit word of
+// four exponent nibbles, so every possible row is an index into a table
+// with 65536 entries. Left and right moves are looked up directly on the
+// rows of a board, up and down on the rows of the transposed board. A whole
+// move therefore costs four table lookups (plus two transpositions).
+class MoveTables {
+ public:
+    // Move the board in the given direction. Adds the points scored by all
+    // merges of this move to *score (if score is not NULL).
+    static Bitboard move(const Bitboard &board, Direction dir, int* score);
+
+    // Legal moves, largest tile and number of empty fields of a board in
+    // one pass of bit tricks over all 16 nibbles at once, without moving.
+    static BoardSummary summarize(const Bitboard &board) {
+        const uint64_t lowBits = 0x1111111111111111ULL;
+        // fields with a right neighbour, and with one below.
+        const uint64_t notLastColumn = 0x0111011101110111ULL;
+        const uint64_t notLastRow = 0x0000111111111111ULL;
+        uint64_t bits = board.bits;
+        // bit 4i is set iff field i is occupied (resp. empty).
+        uint64_t occupied = (bits | bits >> 1 | bits >> 2 | bits >> 3) &
+                            lowBits;
+        uint64_t empty = occupied ^ lowBits;
+        // bit 4i is set iff field i can merge with its right (lower)
+        // neighbour: equal, but neither empty nor 32768 (see build()).
+        uint64_t mergeable = occupied &
+                             ~(bits & bits >> 1 & bits >> 2 & bits >> 3);
+        uint64_t h = bits ^ (bits >> 4);
+        uint64_t v = bits ^ (bits >> 16);
+        uint64_t sameRight = ~(h | h >> 1 | h >> 2 | h >> 3) & mergeable &
+                             notLastColumn;
+        uint64_t sameBelow = ~(v | v >> 1 | v >> 2 | v >> 3) & mergeable &
+                             notLastRow;
+        // a move is legal if two tiles merge or a tile slides into a gap.
+        // (without branches, which would be hard to predict.)
+        int legal =
+            ((sameRight | ((occupied >> 4) & empty & notLastColumn)) != 0)
+                << LEFT |
+            ((sameRight | (occupied & (empty >> 4) & notLastColumn)) != 0)
+                << RIGHT |
+            ((sameBelow | ((occupied >> 16) & empty & notLastRow)) != 0)
+                << UP |
+            ((sameBelow | (occupied & (empty >> 16) & notLastRow)) != 0)
+                << DOWN;
+
+        // maximum of the nibbles: compare even against odd nibbles in
+        // byte lanes (the high bit of a lane survives the subtraction iff
+        // the first is not smaller), then halve the lanes three times.
+        uint64_t m = bits & 0x0F0F0F0F0F0F0F0FULL;
+        uint64_t n = (bits >> 4) & 0x0F0F0F0F0F0F0F0FULL;
+        m = byteMax(m, n);
+        m = byteMax(m, m >> 32);
+        m = byteMax(m, m >> 16);
+        m = byteMax(m, m >> 8);
+
+        BoardSummary summary;
+        summary.legalMoves = legal;
+        summary.maxExponent = static_cast<int>(m & 0xF);
+        // count the empty bits byte wise, then sum the bytes (a popcount
+        // would be a library call without -mpopcnt).
+        uint64_t pairs = (empty + (empty >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        summary.empty = static_cast<int>((pairs * 0x0101010101010101ULL) >> 56);
+        return summary;
+    }
+
+    // Swap rows and columns of a packed board (field 4r+c <-> field 4c+r).
+    static uint64_t transpose(uint64_t bits) {
+        uint64_t a1 = bits & 0xF0F00F0FF0F00F0FULL;
+        uint64_t a2 = bits & 0x0000F0F00000F0F0ULL;
+        uint64_t a3 = bits & 0x0F0F00000F0F0000ULL;
+        uint64_t a = a1 | (a2 << 12) | (a3 >> 12);
+        uint64_t b1 = a & 0xFF00FF0000FF00FFULL;
+        uint64_t b2 = a & 0x00FF00FF00000000ULL;
+        uint64_t b3 = a & 0x00000000FF00FF00ULL;
+        return b1 | (b2 >> 24) | (b3 << 24);
+    }
+
+    // The row after moving it left (towards its lowest nibble) or right,
+    // and the points scored by the merges of that move.
+    static uint16_t rowLeft[65536];
+    static uint16_t rowRight[65536];
+    static uint32_t scoreLeft[65536];
+    static uint32_t scoreRight[65536];
+
+ private:
+    // Lane wise maximum of bytes holding values below 16.
+    static uint64_t byteMax(uint64_t a, uint64_t b) {
+        const uint64_t highBits = 0x8080808080808080ULL;
+        uint64_t notSmaller = ((a | highBits) - b) & highBits;
+        uint64_t select = notSmaller - (notSmaller >> 7);
+        select |= notSmaller;
+        return (a & select) | (b & ~select);
+    }
+
+    // Fill the tables. Called once before main.
+    static bool build();
+    static const bool built;
+};
+
+#endif  // MOVETABLES_H_
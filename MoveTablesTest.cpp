@@ -0,0 +1,110 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "./MoveTables.h"
+#include "./Random.h"
+
+// ____________________________________________________________________________
+TEST(MoveTablesTest, rows) {
+    // 2 2 4 4 -> 4 8 0 0, scoring 4 + 8.
+    ASSERT_EQ(0x0032, MoveTables::rowLeft[0x2211]);
+    ASSERT_EQ(12u, MoveTables::scoreLeft[0x2211]);
+    // 2 2 4 4 -> 0 0 4 8 when moving right.
+    ASSERT_EQ(0x3200, MoveTables::rowRight[0x2211]);
+    ASSERT_EQ(12u, MoveTables::scoreRight[0x2211]);
+    // 2 2 2 0 -> 4 2 0 0, only the first pair merges.
+    ASSERT_EQ(0x0012, MoveTables::rowLeft[0x0111]);
+    // 2 0 2 0 -> 0 0 0 4 when moving right.
+    ASSERT_EQ(0x2000, MoveTables::rowRight[0x0101]);
+    // 2 4 8 16 is stuck.
+    ASSERT_EQ(0x4321, MoveTables::rowLeft[0x4321]);
+    ASSERT_EQ(0u, MoveTables::scoreLeft[0x4321]);
+}
+
+// ____________________________________________________________________________
+TEST(MoveTablesTest, transpose) {
+    Bitboard board;
+    for (int i = 0; i < 16; i++) board.setExponent(i, i);
+    Bitboard transposed(MoveTables::transpose(board.bits));
+    for (int r = 0; r < 4; r++) {
+        for (int c = 0; c < 4; c++) {
+            ASSERT_EQ(board.exponent(4 * r + c),
+                      transposed.exponent(4 * c + r));
+        }
+    }
+    ASSERT_EQ(board.bits, MoveTables::transpose(transposed.bits));
+}
+
+// ____________________________________________________________________________
+TEST(MoveTablesTest, move) {
+    Bitboard board;
+    board[0] = 2;
+    board[4] = 2;
+    board[8] = 4;
+    board[3] = 8;
+    int score = 0;
+
+    Bitboard up = MoveTables::move(board, UP, &score);
+    ASSERT_EQ(4, up[0]);
+    ASSERT_EQ(4, up[4]);
+    ASSERT_EQ(8, up[3]);
+    ASSERT_EQ(4, score);
+
+    Bitboard down = MoveTables::move(board, DOWN, &score);
+    ASSERT_EQ(4, down[8]);
+    ASSERT_EQ(4, down[12]);
+    ASSERT_EQ(8, down[15]);
+    ASSERT_EQ(8, score);
+
+    Bitboard right = MoveTables::move(board, RIGHT, NULL);
+    ASSERT_EQ(8, right[3]);
+    ASSERT_EQ(2, right[7]);
+    ASSERT_EQ(4, right[11]);
+
+    Bitboard left = MoveTables::move(board, LEFT, NULL);
+    ASSERT_EQ(2, left[0]);
+    ASSERT_EQ(8, left[1]);
+}
+
+// ____________________________________________________________________________
+TEST(MoveTablesTest, summarize) {
+    BoardSummary empty = MoveTables::summarize(Bitboard());
+    ASSERT_EQ(0, empty.legalMoves);
+    ASSERT_EQ(0, empty.maxExponent);
+    ASSERT_EQ(16, empty.empty);
+
+    // two 32768 tiles side by side do not merge.
+    Bitboard stuck(0xFF00FF00FF00FF00ULL);
+    ASSERT_EQ(1 << LEFT, MoveTables::summarize(stuck).legalMoves);
+    ASSERT_EQ(15, MoveTables::summarize(stuck).maxExponent);
+
+    // compare with moving the board on sparse, dense and random boards.
+    Xoshiro256 rng(16);
+    for (int i = 0; i < 100000; i++) {
+        Bitboard board;
+        if (i % 3 == 0) {
+            board.bits = rng();
+        } else {
+            for (int f = 0; f < 16; f++) {
+                if (rng.below(4) != 0) {
+                    board.setExponent(f, 1 + rng.below(i % 3 == 1 ? 3 : 15));
+                }
+            }
+        }
+        int legal = 0;
+        for (int d = 0; d < 4; d++) {
+            Direction dir = static_cast<Direction>(d);
+            if (MoveTables::move(board, dir, NULL) != board) legal |= 1 << d;
+        }
+        int maxExponent = 0;
+        for (int f = 0; f < 16; f++) {
+            maxExponent = std::max(maxExponent, board.exponent(f));
+        }
+        BoardSummary summary = MoveTables::summarize(board);
+        ASSERT_EQ(legal, summary.legalMoves) << std::hex << board.bits;
+        ASSERT_EQ(maxExponent, summary.maxExponent) << std::hex << board.bits;
+        ASSERT_EQ(board.countEmpty(), summary.empty);
+    }
+}
@@ -0,0 +1,341 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include "./NTuple.h"
+#include "./Spawn.h"
+#include "./Symmetry.h"
+
+namespace {
+// layout of a weights file: this header, then the tables of all tuples.
+const char kMagic[4] = { 'N', 'T', 'W', '1' };
+const size_t kHeaderSize = 16;
+const size_t kWeightsSize =
+        sizeof(float) * NTupleNetwork::kTuples * NTupleNetwork::kEntries;
+
+// weights per board (tuples times symmetries).
+const float kWeightsPerBoard = NTupleNetwork::kTuples * Symmetry::kCount;
+
+// number of scores the rolling average is taken over.
+const size_t kRollingGames = 1000;
+}  // namespace
+
+// ___________________________________________________________________________
+NTupleNetwork::NTupleNetwork() : fileBacked(false) {
+    mappingSize = kHeaderSize + kWeightsSize;
+    mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = NULL;
+        weights = NULL;
+        return;
+    }
+    weights = reinterpret_cast<float*>(
+            static_cast<char*>(mapping) + kHeaderSize);
+}
+
+// ___________________________________________________________________________
+NTupleNetwork::~NTupleNetwork() {
+    close();
+}
+
+// ___________________________________________________________________________
+void NTupleNetwork::close() {
+    if (mapping != NULL) {
+        if (fileBacked) msync(mapping, mappingSize, MS_SYNC);
+        munmap(mapping, mappingSize);
+    }
+    mapping = NULL;
+    weights = NULL;
+    fileBacked = false;
+}
+
+// ___________________________________________________________________________
+bool NTupleNetwork::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = kHeaderSize + kWeightsSize;
+    bool created = info.st_size == 0;
+    if (created && ftruncate(fd, size) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (!created && static_cast<size_t>(info.st_size) != size) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    char* header = static_cast<char*>(mapped);
+    if (created) {
+        std::memcpy(header, kMagic, 4);
+    } else if (std::memcmp(header, kMagic, 4) != 0) {
+        munmap(mapped, size);
+        return false;
+    }
+    close();
+    mapping = mapped;
+    mappingSize = size;
+    weights = reinterpret_cast<float*>(header + kHeaderSize);
+    fileBacked = true;
+    return true;
+}
+
+// ___________________________________________________________________________
+void NTupleNetwork::sync(bool wait) {
+    if (!fileBacked) return;
+    msync(mapping, mappingSize, wait ? MS_SYNC : MS_ASYNC);
+}
+
+// ___________________________________________________________________________
+void NTupleNetwork::indices(uint64_t bits, int* index) {
+    // rows 0 and 1.
+    index[0] = bits & 0xFFFF;
+    index[1] = (bits >> 16) & 0xFFFF;
+    // the squares of fields {0, 1, 4, 5}, {1, 2, 5, 6} and {5, 6, 9, 10}.
+    index[2] = (bits & 0xFF) | ((bits >> 16) & 0xFF) << 8;
+    index[3] = ((bits >> 4) & 0xFF) | ((bits >> 20) & 0xFF) << 8;
+    index[4] = ((bits >> 20) & 0xFF) | ((bits >> 36) & 0xFF) << 8;
+}
+
+// ___________________________________________________________________________
+float NTupleNetwork::value(const Bitboard &board) const {
+    float sum = 0;
+    int index[kTuples];
+    for (int s = 0; s < Symmetry::kCount; s++) {
+        indices(Symmetry::apply(board, s).bits, index);
+        for (int t = 0; t < kTuples; t++) {
+            sum += load(weights + t * kEntries + index[t]);
+        }
+    }
+    return sum;
+}
+
+// ___________________________________________________________________________
+void NTupleNetwork::update(const Bitboard &board, float delta) {
+    float step = delta / kWeightsPerBoard;
+    int index[kTuples];
+    for (int s = 0; s < Symmetry::kCount; s++) {
+        indices(Symmetry::apply(board, s).bits, index);
+        for (int t = 0; t < kTuples; t++) {
+            float* w = weights + t * kEntries + index[t];
+            store(w, load(w) + step);
+        }
+    }
+}
+
+// ___________________________________________________________________________
+NTuplePolicy::NTuplePolicy(const NTupleNetwork* network, int depth)
+    : network(network), depth(depth), evaluated(0) {
+}
+
+// ___________________________________________________________________________
+float NTuplePolicy::bestAfterstate(const NTupleNetwork &network,
+        const Bitboard &board, int* move) {
+    *move = -1;
+    float best = 0;
+    int legal = MoveTables::summarize(board).legalMoves;
+    for (int d = 0; d < 4; d++) {
+        if (!(legal & (1 << d))) continue;
+        int score = 0;
+        Bitboard after = MoveTables::move(board, static_cast<Direction>(d),
+                                          &score);
+        float value = score + network.value(after);
+        if (*move < 0 || value > best) {
+            best = value;
+            *move = d;
+        }
+    }
+    return best;
+}
+
+// ___________________________________________________________________________
+Direction NTuplePolicy::choose(const Bitboard &board,
+        SimulationRng & /*rng*/) {
+    int move;
+    if (depth <= 0) {
+        evaluated += 4;
+        bestAfterstate(*network, board, &move);
+        return move < 0 ? UP : static_cast<Direction>(move);
+    }
+    // the expected best value after each spawn, 2 with 90% and 4 with 10%.
+    move = -1;
+    float best = 0;
+    int legal = MoveTables::summarize(board).legalMoves;
+    for (int d = 0; d < 4; d++) {
+        if (!(legal & (1 << d))) continue;
+        int score = 0;
+        Bitboard after = MoveTables::move(board, static_cast<Direction>(d),
+                                          &score);
+        uint16_t empty = after.emptyMask();
+        float expected = 0;
+        for (int f = 0; f < 16; f++) {
+            if (!(empty & (1 << f))) continue;
+            for (int expo = 1; expo <= 2; expo++) {
+                Bitboard next = after;
+                next.setExponent(f, expo);
+                int reply;
+                expected += (expo == 1 ? 0.9f : 0.1f) *
+                            bestAfterstate(*network, next, &reply);
+                evaluated += 4;
+            }
+        }
+        float value = score + expected / __builtin_popcount(empty);
+        if (move < 0 || value > best) {
+            best = value;
+            move = d;
+        }
+    }
+    return move < 0 ? UP : static_cast<Direction>(move);
+}
+
+// ___________________________________________________________________________
+TdTrainer::TdTrainer(NTupleNetwork* network, float alpha, uint64_t seed)
+    : network(network), alpha(alpha), seed(seed), nextScore(0),
+      gamesDone(0) {
+}
+
+// ___________________________________________________________________________
+GameResult TdTrainer::playGame(uint64_t gameIndex, bool learn,
+        SimulationRng &rng) {
+    rng.seed(Simulation::gameSeed(seed, gameIndex));
+    GameResult result = { 0, 0, 0, -1 };
+
+    Bitboard board;
+    spawnTile(board, rng);
+    spawnTile(board, rng);
+    // the afterstate of the previous move, whose value is learned next.
+    Bitboard previous;
+    bool hasPrevious = false;
+    while (true) {
+        BoardSummary summary = MoveTables::summarize(board);
+        result.maxExponent = summary.maxExponent;
+        if (result.stepsTo2048 < 0 && summary.maxExponent >= 11) {
+            result.stepsTo2048 = result.steps;
+        }
+        if (summary.legalMoves == 0) break;
+
+        int move;
+        float target = NTuplePolicy::bestAfterstate(*network, board, &move);
+        if (learn && hasPrevious) {
+            network->update(previous,
+                            alpha * (target - network->value(previous)));
+        }
+        int score = 0;
+        Bitboard after = MoveTables::move(board, static_cast<Direction>(move),
+                                          &score);
+        result.score += score;
+        result.steps++;
+        previous = after;
+        hasPrevious = true;
+        board = after;
+        spawnTile(board, rng);
+    }
+    // nothing follows the last afterstate.
+    if (learn && hasPrevious) {
+        network->update(previous, -alpha * network->value(previous));
+    }
+    return result;
+}
+
+// ___________________________________________________________________________
+void TdTrainer::worker(int64_t first, int64_t last, SimulationStats* stats) {
+    SimulationRng rng;
+    for (int64_t g = first; g < last; g++) {
+        GameResult result = playGame(g, true, rng);
+        stats->add(result);
+        std::lock_guard<std::mutex> lock(scoresMutex);
+        if (lastScores.size() < kRollingGames) {
+            lastScores.push_back(result.score);
+        } else {
+            lastScores[nextScore] = result.score;
+        }
+        nextScore = (nextScore + 1) % kRollingGames;
+        gamesDone++;
+    }
+}
+
+// ___________________________________________________________________________
+double TdTrainer::rollingScore() {
+    std::lock_guard<std::mutex> lock(scoresMutex);
+    if (lastScores.empty()) return 0;
+    int64_t sum = 0;
+    for (const auto& score : lastScores) sum += score;
+    return static_cast<double>(sum) / lastScores.size();
+}
+
+// ___________________________________________________________________________
+SimulationStats TdTrainer::train(int64_t numGames, int numThreads,
+        double reportSeconds, std::ostream &out) {
+    if (numThreads <= 0) numThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0) numThreads = 1;
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(scoresMutex);
+        lastScores.clear();
+        nextScore = 0;
+        gamesDone = 0;
+    }
+
+    // like Simulation::run: contiguous ranges of games per thread.
+    std::vector<SimulationStats> shards(numThreads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        int64_t first = numGames * t / numThreads;
+        int64_t last = numGames * (t + 1) / numThreads;
+        workers.push_back(std::thread(&TdTrainer::worker, this, first, last,
+                                      &shards[t]));
+    }
+
+    // report (and checkpoint) until all games are played.
+    out << std::fixed;
+    auto lastReport = start;
+    while (true) {
+        int64_t done;
+        {
+            std::lock_guard<std::mutex> lock(scoresMutex);
+            done = gamesDone;
+        }
+        if (done >= numGames) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> sinceReport = now - lastReport;
+        if (reportSeconds <= 0 || sinceReport.count() < reportSeconds) {
+            continue;
+        }
+        std::chrono::duration<double> elapsed = now - start;
+        out << "games: " << std::setw(9) << done << "  games/s: "
+            << std::setprecision(1) << std::setw(8) << done / elapsed.count()
+            << "  avg score (last " << kRollingGames << "): "
+            << std::setprecision(0) << rollingScore() << std::endl;
+        network->sync(false);
+        lastReport = now;
+    }
+
+    SimulationStats total;
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].join();
+        total.merge(shards[t]);
+    }
+    network->sync(true);
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    total.seconds = elapsed.count();
+    return total;
+}
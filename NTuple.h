@@ -0,0 +1,138 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef NTUPLE_H_
+#define NTUPLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "./Bitboard.h"
+#include "./MoveTables.h"
+#include "./Simulation.h"
+
+// An n-tuple network: a learned value of a board (after a move, before the
+// spawn) as the sum of one weight per tuple and symmetry. A tuple is a
+// fixed set of 4 fields and the exponents on them index its table of
+// 16^4 weights. The tuples are the two straight ones of rows 0 and 1 and
+// the 2x2 squares in the corner, on the edge and in the center, each
+// looked at in all 8 symmetries (see Symmetry), which gives 40 weights
+// per board.
+//
+// The weights live in a memory mapping, of a file if the network is
+// opened with a path (so every update is written back by the kernel and
+// sync() is a checkpoint) or anonymous otherwise. Threads read and update
+// the weights without locks, Hogwild style: concurrent updates of the same
+// weight may get lost, which costs TD learning next to nothing.
+class NTupleNetwork {
+ public:
+    static const int kTuples = 5;
+    static const int kEntries = 1 << 16;
+
+    // A network with all weights 0, not backed by a file.
+    NTupleNetwork();
+    ~NTupleNetwork();
+
+    // Map the weights file at path, creating it (with all weights 0) if it
+    // does not exist. Returns false if the file cannot be created or
+    // mapped or is no weights file of this layout.
+    bool open(const std::string &path);
+
+    // Write the weights back to the file; wait for the disk if wait.
+    void sync(bool wait);
+
+    // Value of an afterstate.
+    float value(const Bitboard &board) const;
+
+    // Add delta / 40 to the 40 weights of the board.
+    void update(const Bitboard &board, float delta);
+
+    // Weight i of tuple t (for tests).
+    float weight(int t, int i) const {
+        return load(weights + t * kEntries + i);
+    }
+
+ private:
+    static float load(const float* w) {
+        float v;
+        __atomic_load(w, &v, __ATOMIC_RELAXED);
+        return v;
+    }
+    static void store(float* w, float v) {
+        __atomic_store(w, &v, __ATOMIC_RELAXED);
+    }
+
+    // Unmap the current weights.
+    void close();
+
+    // The 5 table indices of a board in its canonical orientation.
+    static void indices(uint64_t bits, int* index);
+
+    // the mapping (header and weights) and the weights in it.
+    void* mapping;
+    size_t mappingSize;
+    float* weights;
+    bool fileBacked;
+};
+
+// Picks moves by the values of a network: greedily by points plus value
+// of the afterstate (depth 0), or by the expectation of that over all
+// spawned tiles and the best reply (depth 1).
+class NTuplePolicy : public Policy {
+ public:
+    NTuplePolicy(const NTupleNetwork* network, int depth);
+
+    Direction choose(const Bitboard &board, SimulationRng &rng);
+    int64_t nodes() const { return evaluated; }
+
+    // Points plus value of the best move from board and that move (-1 if
+    // there is none, with value 0).
+    static float bestAfterstate(const NTupleNetwork &network,
+            const Bitboard &board, int* move);
+
+ private:
+    const NTupleNetwork* network;
+    int depth;
+    int64_t evaluated;
+};
+
+// Trains a network by TD(0) on afterstates in self-play games. Every
+// worker thread plays its own games (seeded from seed and the game index)
+// with greedy moves and after each move pulls the value of the previous
+// afterstate towards the points of this move plus the value of its
+// afterstate.
+class TdTrainer {
+ public:
+    TdTrainer(NTupleNetwork* network, float alpha, uint64_t seed);
+
+    // Play one game, learning from it if learn is set.
+    GameResult playGame(uint64_t gameIndex, bool learn, SimulationRng &rng);
+
+    // Train on numGames games with numThreads threads (0 = one per core).
+    // Every reportSeconds, prints games/s and the average score of the
+    // last 1000 games to out and checkpoints the weights. Returns the
+    // stats of all games.
+    SimulationStats train(int64_t numGames, int numThreads,
+            double reportSeconds, std::ostream &out);
+
+    // Average score of the last (up to) 1000 games.
+    double rollingScore();
+
+ private:
+    void worker(int64_t first, int64_t last, SimulationStats* stats);
+
+    NTupleNetwork* network;
+    float alpha;
+    uint64_t seed;
+
+    // scores of the last games, shared by the workers.
+    std::mutex scoresMutex;
+    std::vector<int> lastScores;
+    size_t nextScore;
+    int64_t gamesDone;
+};
+
+#endif  // NTUPLE_H_
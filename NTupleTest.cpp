@@ -0,0 +1,86 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "./NTuple.h"
+#include "./Symmetry.h"
+
+// ____________________________________________________________________________
+TEST(NTupleTest, valueAndUpdate) {
+    NTupleNetwork network;
+    Bitboard board(0xFEDCBA9876543210ULL);
+    ASSERT_FLOAT_EQ(0, network.value(board));
+    network.update(board, 40);
+    ASSERT_FLOAT_EQ(40, network.value(board));
+    // all symmetric boards share the weights.
+    for (int t = 0; t < Symmetry::kCount; t++) {
+        ASSERT_FLOAT_EQ(40, network.value(Symmetry::apply(board, t)));
+    }
+    // distinct tiles, so all 40 weights of the board are different.
+    ASSERT_FLOAT_EQ(1, network.weight(0, 0x3210));
+    ASSERT_FLOAT_EQ(0, network.weight(0, 0));
+}
+
+// ____________________________________________________________________________
+TEST(NTupleTest, file) {
+    char path[] = "/tmp/NTupleTest.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    Bitboard board(0xFEDCBA9876543210ULL);
+    {
+        NTupleNetwork network;
+        ASSERT_TRUE(network.open(path));
+        network.update(board, 80);
+        network.sync(true);
+    }
+    {
+        NTupleNetwork network;
+        ASSERT_TRUE(network.open(path));
+        ASSERT_FLOAT_EQ(80, network.value(board));
+    }
+    // a file of a different size is no weights file.
+    FILE* file = fopen(path, "w");
+    fputs("not a network", file);
+    fclose(file);
+    NTupleNetwork network;
+    network.update(board, 40);
+    ASSERT_FALSE(network.open(path));
+    // a failed open keeps the old weights.
+    ASSERT_FLOAT_EQ(40, network.value(board));
+    unlink(path);
+}
+
+// ____________________________________________________________________________
+TEST(NTupleTest, training) {
+    // a few hundred games of training beat the untrained (all 0) network.
+    NTupleNetwork network;
+    TdTrainer trainer(&network, 0.1, 7);
+    SimulationRng rng;
+    int64_t before = 0;
+    for (int g = 0; g < 50; g++) {
+        before += trainer.playGame(100000 + g, false, rng).score;
+    }
+    std::ostringstream out;
+    SimulationStats stats = trainer.train(500, 2, 0, out);
+    ASSERT_EQ(500, stats.games);
+    ASSERT_GT(trainer.rollingScore(), 0);
+    int64_t after = 0;
+    for (int g = 0; g < 50; g++) {
+        after += trainer.playGame(100000 + g, false, rng).score;
+    }
+    ASSERT_GT(after, before * 3 / 2);
+
+    // the trained network as a policy, with and without lookahead.
+    for (int depth = 0; depth <= 1; depth++) {
+        NTuplePolicy policy(&network, depth);
+        Simulation simulation("greedy", 3);
+        GameResult result = simulation.playGame(0, &policy, rng);
+        ASSERT_GT(result.score, 0);
+        ASSERT_GT(policy.nodes(), 0);
+    }
+}
@@ -0,0 +1,356 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include "./OutcomeTable.h"
+#include "./Symmetry.h"
+
+namespace {
+// layout of a table file: this header (magic, board size, target, kind, 0
+// and the number of keys), the keys and then the values.
+const char kMagic[4] = { 'O', 'T', 'B', '1' };
+const size_t kHeaderSize = 16;
+
+// The field that field i of a size x size board goes to under symmetry t
+// (see Symmetry), for 3x3 boards; 4x4 boards use Symmetry itself.
+struct Permutations {
+    int fields[8][9];
+    Permutations() {
+        for (int t = 0; t < 8; t++) {
+            for (int r = 0; r < 3; r++) {
+                for (int c = 0; c < 3; c++) {
+                    int row = t & 4 ? c : r;
+                    int column = t & 4 ? r : c;
+                    if (t & 1) column = 2 - column;
+                    if (t & 2) row = 2 - row;
+                    fields[t][r * 3 + c] = row * 3 + column;
+                }
+            }
+        }
+    }
+};
+
+// The largest exponent on a board with the given number of fields.
+int maxExponent(uint64_t key, int fields) {
+    int max = 0;
+    for (int i = 0; i < fields; i++) {
+        max = std::max(max, static_cast<int>((key >> (4 * i)) & 0xF));
+    }
+    return max;
+}
+
+template <int N>
+Grid<N> gridOf(uint64_t key) {
+    Grid<N> grid;
+    for (int i = 0; i < N * N; i++) grid.setExponent(i, (key >> (4 * i)) & 0xF);
+    return grid;
+}
+
+// True if some move changes the board.
+bool canMove(uint64_t key, int size) {
+    if (size == 4) return MoveTables::summarize(Bitboard(key)).legalMoves;
+    Grid<3> grid = gridOf<3>(key);
+    for (int dir = 0; dir < 4; dir++) {
+        if (Grid<3>::move(grid, static_cast<Direction>(dir), NULL) != grid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Solves the positions of NxN boards by a depth first search over moves
+// and spawns. Every spawn adds to the sum of the tiles, so no position
+// can come back and each one is solved once. The solved positions are
+// kept in an open addressing hash of canonical keys (0 marks a free
+// slot: every position has a tile).
+template <int N>
+class Solver {
+ public:
+    Solver(int target, OutcomeTable::Kind kind)
+        : target(target), kind(kind), used(0) {
+        keys.assign(1 << 16, 0);
+        values.resize(keys.size());
+    }
+
+    // Value of a position with the player to move.
+    float value(const Grid<N> &grid) {
+        uint64_t key = OutcomeTable::key(grid);
+        if (maxExponent(key, N * N) >= target) {
+            return kind == OutcomeTable::WIN ? 1 : 0;
+        }
+        uint64_t canonical = OutcomeTable::canonical(key, N);
+        size_t slot = find(canonical);
+        if (keys[slot] == canonical) return values[slot];
+
+        // the best move by the mean value over all tiles that can spawn.
+        double best = 0;
+        bool lost = true;
+        for (int dir = 0; dir < 4; dir++) {
+            int score = 0;
+            Grid<N> moved = Grid<N>::move(grid, static_cast<Direction>(dir),
+                                          &score);
+            if (moved == grid) continue;
+            lost = false;
+            double sum = 0;
+            int empty = 0;
+            for (int i = 0; i < N * N; i++) {
+                if (moved.exponent(i) != 0) continue;
+                Grid<N> spawned = moved;
+                spawned.setExponent(i, 1);
+                sum += 0.9 * value(spawned);
+                spawned.setExponent(i, 2);
+                sum += 0.1 * value(spawned);
+                empty++;
+            }
+            double expected = sum / empty;
+            if (kind == OutcomeTable::SCORE) expected += score;
+            best = std::max(best, expected);
+        }
+        // positions without a move are worth 0 and need no entry.
+        if (lost) return 0;
+        insert(canonical, best);
+        return best;
+    }
+
+    // The solved positions sorted by key.
+    void entries(std::vector<std::pair<uint64_t, float>>* sorted) const {
+        sorted->clear();
+        sorted->reserve(used);
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] != 0) sorted->push_back(std::make_pair(keys[i],
+                                                               values[i]));
+        }
+        std::sort(sorted->begin(), sorted->end());
+    }
+
+ private:
+    // The slot of key, or the free slot where it belongs.
+    size_t find(uint64_t key) const {
+        size_t mask = keys.size() - 1;
+        size_t slot = (key * 0x9E3779B97F4A7C15ULL) >> 20 & mask;
+        while (keys[slot] != 0 && keys[slot] != key) slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    void insert(uint64_t key, float value) {
+        // grow at half load, so the probe sequences stay short.
+        if (2 * (used + 1) > keys.size()) {
+            std::vector<uint64_t> oldKeys(keys.size() * 2, 0);
+            std::vector<float> oldValues(oldKeys.size());
+            oldKeys.swap(keys);
+            oldValues.swap(values);
+            for (size_t i = 0; i < oldKeys.size(); i++) {
+                if (oldKeys[i] == 0) continue;
+                size_t slot = find(oldKeys[i]);
+                keys[slot] = oldKeys[i];
+                values[slot] = oldValues[i];
+            }
+        }
+        size_t slot = find(key);
+        keys[slot] = key;
+        values[slot] = value;
+        used++;
+    }
+
+    int target;
+    OutcomeTable::Kind kind;
+    std::vector<uint64_t> keys;
+    std::vector<float> values;
+    size_t used;
+};
+
+// Solve the positions reachable from roots (all new games if empty, which
+// generate() only allows for 3x3) and return them sorted by key.
+template <int N>
+void solve(int target, OutcomeTable::Kind kind,
+           const std::vector<uint64_t> &roots,
+           std::vector<std::pair<uint64_t, float>>* sorted) {
+    Solver<N> solver(target, kind);
+    if (roots.empty()) {
+        // two tiles, each a 2 or a 4.
+        for (int a = 0; a < N * N; a++) {
+            for (int b = a + 1; b < N * N; b++) {
+                for (int values = 0; values < 4; values++) {
+                    Grid<N> grid;
+                    grid.setExponent(a, 1 + (values & 1));
+                    grid.setExponent(b, 1 + (values >> 1));
+                    solver.value(grid);
+                }
+            }
+        }
+    }
+    for (uint64_t root : roots) solver.value(gridOf<N>(root));
+    solver.entries(sorted);
+}
+}  // namespace
+
+// ___________________________________________________________________________
+OutcomeTable::OutcomeTable()
+    : mapping(NULL), mappingSize(0), keys(NULL), values(NULL), numKeys(0),
+      boardSize(0), targetExponent(0), tableKind(WIN) {
+}
+
+// ___________________________________________________________________________
+OutcomeTable::~OutcomeTable() {
+    close();
+}
+
+// ___________________________________________________________________________
+void OutcomeTable::close() {
+    if (mapping != NULL) munmap(mapping, mappingSize);
+    mapping = NULL;
+    mappingSize = 0;
+    keys = NULL;
+    values = NULL;
+    numKeys = 0;
+    boardSize = 0;
+}
+
+// ___________________________________________________________________________
+bool OutcomeTable::open(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        static_cast<size_t>(info.st_size) < kHeaderSize) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void* mapped = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return false;
+
+    const char* header = static_cast<const char*>(mapped);
+    int64_t count;
+    std::memcpy(&count, header + 8, sizeof(count));
+    bool valid = std::memcmp(header, kMagic, 4) == 0 &&
+                 (header[4] == 3 || header[4] == 4) &&
+                 header[5] > 0 && header[5] < 16 &&
+                 (header[6] == WIN || header[6] == SCORE) && count >= 0 &&
+                 size == kHeaderSize + count * (sizeof(uint64_t) +
+                                                sizeof(float));
+    if (!valid) {
+        munmap(mapped, size);
+        return false;
+    }
+    // a lookup touches a few scattered pages of the keys.
+    madvise(mapped, size, MADV_RANDOM);
+    close();
+    mapping = mapped;
+    mappingSize = size;
+    numKeys = count;
+    keys = reinterpret_cast<const uint64_t*>(header + kHeaderSize);
+    values = reinterpret_cast<const float*>(keys + count);
+    boardSize = header[4];
+    targetExponent = header[5];
+    tableKind = static_cast<Kind>(header[6]);
+    return true;
+}
+
+// ___________________________________________________________________________
+int64_t OutcomeTable::generate(const std::string &path, int size,
+        int target, Kind kind, const std::vector<uint64_t> &roots) {
+    if (size < 3 || size > 4 || target < 1 || target > 15) return -1;
+    if (size == 4 && roots.empty()) return -1;
+    std::vector<std::pair<uint64_t, float>> entries;
+    if (size == 3) {
+        solve<3>(target, kind, roots, &entries);
+    } else {
+        solve<4>(target, kind, roots, &entries);
+    }
+
+    // write a new file and rename it, so readers never map half a table.
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary.c_str(), std::ios::binary);
+        if (!file) return -1;
+        char header[kHeaderSize] = { 0 };
+        std::memcpy(header, kMagic, 4);
+        header[4] = size;
+        header[5] = target;
+        header[6] = kind;
+        int64_t count = entries.size();
+        std::memcpy(header + 8, &count, sizeof(count));
+        file.write(header, kHeaderSize);
+        std::vector<uint64_t> column(entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            column[i] = entries[i].first;
+        }
+        file.write(reinterpret_cast<const char*>(column.data()),
+                   column.size() * sizeof(uint64_t));
+        std::vector<float> solved(entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            solved[i] = entries[i].second;
+        }
+        file.write(reinterpret_cast<const char*>(solved.data()),
+                   solved.size() * sizeof(float));
+        if (!file.flush()) return -1;
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) return -1;
+    return entries.size();
+}
+
+// ___________________________________________________________________________
+uint64_t OutcomeTable::canonical(uint64_t key, int size) {
+    if (size == 4) return Symmetry::canonical(Bitboard(key), NULL).bits;
+    static const Permutations permutations;
+    uint64_t best = key;
+    for (int t = 1; t < 8; t++) {
+        uint64_t mapped = 0;
+        for (int i = 0; i < 9; i++) {
+            mapped |= ((key >> (4 * i)) & 0xF) <<
+                      (4 * permutations.fields[t][i]);
+        }
+        best = std::min(best, mapped);
+    }
+    return best;
+}
+
+// ___________________________________________________________________________
+bool OutcomeTable::lookup(uint64_t key, float* value) const {
+    if (mapping == NULL) return false;
+    if (maxExponent(key, boardSize * boardSize) >= targetExponent) {
+        *value = tableKind == WIN ? 1 : 0;
+        return true;
+    }
+    uint64_t wanted = canonical(key, boardSize);
+    const uint64_t* found = std::lower_bound(keys, keys + numKeys, wanted);
+    if (found != keys + numKeys && *found == wanted) {
+        *value = values[found - keys];
+        return true;
+    }
+    // lost positions are not stored.
+    if (!canMove(key, boardSize)) {
+        *value = 0;
+        return true;
+    }
+    return false;
+}
+
+// ___________________________________________________________________________
+bool OutcomeTable::spawnValue(uint64_t moved, float* value) const {
+    double sum = 0;
+    int empty = 0;
+    for (int i = 0; i < boardSize * boardSize; i++) {
+        if ((moved >> (4 * i)) & 0xF) continue;
+        float two;
+        float four;
+        if (!lookup(moved | uint64_t(1) << (4 * i), &two) ||
+            !lookup(moved | uint64_t(2) << (4 * i), &four)) {
+            return false;
+        }
+        sum += 0.9 * two + 0.1 * four;
+        empty++;
+    }
+    *value = empty > 0 ? sum / empty : 0;
+    return true;
+}
@@ -0,0 +1,113 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef OUTCOMETABLE_H_
+#define OUTCOMETABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "./Bitboard.h"
+#include "./Grid.h"
+
+// Exact outcomes of small games, solved offline and looked up in a memory
+// mapped file. A table covers the positions (with the player to move) of
+// 3x3 or 4x4 boards that can be reached from a set of roots (all new 3x3
+// games by default; 4x4 tables need roots, crowded endgames), until a tile
+// of 2^target shows up or no move is left. For every position it holds its
+// value under optimal play: the probability to reach the target (WIN) or
+// the expected points until then (SCORE).
+//
+// The file is the header, the sorted position keys and then their values.
+// A key is the board with 4 bits per field (row by row, as in Bitboard)
+// in its canonical orientation, the smallest of the 8 symmetric ones. A
+// lookup is a binary search in the mapping, so opening a table costs a
+// few system calls and all processes using it share its pages in the
+// page cache.
+class OutcomeTable {
+ public:
+    enum Kind { WIN = 0, SCORE = 1 };
+
+    OutcomeTable();
+    ~OutcomeTable();
+
+    // Map the table file at path (read only). Returns false if it cannot
+    // be mapped or is no outcome table.
+    bool open(const std::string &path);
+
+    // Solve all positions reachable from roots (keys of boards of the
+    // given size; all new games if empty, on 3x3 only) and write their
+    // table to path. Returns the number of positions in the table, -1 if
+    // it cannot be written or the arguments are out of range (size 3 or
+    // 4, target up to 15, roots for 4x4: its new games are far too many).
+    static int64_t generate(const std::string &path, int size, int target,
+                            Kind kind, const std::vector<uint64_t> &roots);
+
+    // Value of a position (a key of a board of size()) with the player to
+    // move. Positions with the target tile or without a move have their
+    // values without a lookup. Returns false if the table does not have
+    // the position.
+    bool lookup(uint64_t key, float* value) const;
+
+    // The move with the best expected value of the positions after it and
+    // the spawned tile, and that value in *value. Returns -1 if there is
+    // no move, the board has another size than the table or a position is
+    // not in the table.
+    template <int N>
+    int bestMove(const Grid<N> &grid, float* value) const {
+        if (N > 4 || N != boardSize) return -1;
+        int best = -1;
+        for (int dir = 0; dir < 4; dir++) {
+            int score = 0;
+            Grid<N> moved = Grid<N>::move(grid, static_cast<Direction>(dir),
+                                          &score);
+            if (moved == grid) continue;
+            float expected;
+            if (!spawnValue(key(moved), &expected)) return -1;
+            expected += tableKind == SCORE ? score : 0;
+            if (best < 0 || expected > *value) {
+                best = dir;
+                *value = expected;
+            }
+        }
+        return best;
+    }
+
+    // The key of a board (not canonical).
+    template <int N>
+    static uint64_t key(const Grid<N> &grid) {
+        uint64_t bits = 0;
+        for (int i = 0; i < N * N; i++) {
+            bits |= uint64_t(grid.exponent(i)) << (4 * i);
+        }
+        return bits;
+    }
+    static uint64_t key(const Grid<4> &grid) { return grid.board.bits; }
+
+    // The smallest key among the 8 symmetric boards of the given size.
+    static uint64_t canonical(uint64_t key, int size);
+
+    int size() const { return boardSize; }
+    int target() const { return targetExponent; }
+    Kind kind() const { return tableKind; }
+    int64_t count() const { return numKeys; }
+
+ private:
+    // Expected value of a moved board over the tiles that can spawn on it.
+    bool spawnValue(uint64_t moved, float* value) const;
+
+    // Unmap the current table.
+    void close();
+
+    void* mapping;
+    size_t mappingSize;
+    const uint64_t* keys;
+    const float* values;
+    int64_t numKeys;
+    int boardSize;
+    int targetExponent;
+    Kind tableKind;
+};
+
+#endif  // OUTCOMETABLE_H_
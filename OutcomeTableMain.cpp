@@ -0,0 +1,161 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <getopt.h>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "./OutcomeTable.h"
+
+// Solves 3x3 games or 4x4 endgames exactly and writes their outcome table
+// (see OutcomeTable), or (with --table) looks positions up in one.
+
+namespace {
+void printUsageAndExit() {
+    std::cout << "Usage: OutcomeTableMain --out FILE [--size 3|4]"
+              << " [--target TILE] [--score] [--root HEX]...\n"
+              << "       OutcomeTableMain --table FILE [--lookup HEX]...\n"
+              << "Boards are 4 bits per field in hex, field 0 last. "
+              << "Size 4 needs --root.\n";
+    exit(1);
+}
+
+// Print the value and the best move of a position.
+template <int N>
+void printPosition(const OutcomeTable &table, uint64_t key) {
+    Grid<N> grid;
+    for (int i = 0; i < N * N; i++) grid.setExponent(i, (key >> (4 * i)) & 15);
+    float value;
+    if (!table.lookup(key, &value)) {
+        std::cout << std::hex << key << std::dec << ": not in the table\n";
+        return;
+    }
+    float expected = 0;
+    int move = table.bestMove(grid, &expected);
+    std::cout << std::hex << key << std::dec << ": " << value;
+    if (move >= 0) std::cout << ", best move " << directionName(move);
+    std::cout << std::endl;
+}
+
+// Mean value of a new game (two tiles, each a 2 or, one in ten, a 4).
+double newGameValue(const OutcomeTable &table) {
+    int fields = table.size() * table.size();
+    double sum = 0;
+    int pairs = 0;
+    for (int a = 0; a < fields; a++) {
+        for (int b = a + 1; b < fields; b++) {
+            for (int values = 0; values < 4; values++) {
+                uint64_t key = uint64_t(1 + (values & 1)) << (4 * a) |
+                               uint64_t(1 + (values >> 1)) << (4 * b);
+                float value;
+                if (!table.lookup(key, &value)) return -1;
+                sum += (values & 1 ? 0.1 : 0.9) * (values >> 1 ? 0.1 : 0.9) *
+                       value;
+            }
+            pairs++;
+        }
+    }
+    return sum / pairs;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string out;
+    std::string tablePath;
+    int size = 3;
+    int target = 256;
+    OutcomeTable::Kind kind = OutcomeTable::WIN;
+    std::vector<uint64_t> roots;
+    std::vector<uint64_t> lookups;
+    struct option options[] = {
+            { "out", 1, NULL, 'o'},
+            { "size", 1, NULL, 'x'},
+            { "target", 1, NULL, 'T'},
+            { "score", 0, NULL, 's'},
+            { "root", 1, NULL, 'r'},
+            { "table", 1, NULL, 't'},
+            { "lookup", 1, NULL, 'l'},
+            { "help", 0, NULL, 'h'},
+            { NULL, 0, NULL, 0 }
+    };
+    while (true) {
+        int c = getopt_long(argc, argv, "o:x:T:sr:t:l:h", options, NULL);
+        if (c == -1) break;
+        switch (c) {
+            case 'o': out = optarg; break;
+            case 'x': size = atoi(optarg); break;
+            case 'T': target = atoi(optarg); break;
+            case 's': kind = OutcomeTable::SCORE; break;
+            case 'r': roots.push_back(strtoull(optarg, NULL, 16)); break;
+            case 't': tablePath = optarg; break;
+            case 'l': lookups.push_back(strtoull(optarg, NULL, 16)); break;
+            default: printUsageAndExit();
+        }
+    }
+    if (out.empty() == tablePath.empty()) printUsageAndExit();
+    if (!out.empty() && size == 4 && roots.empty()) {
+        std::cerr << "All new 4x4 games are far too many to solve, give "
+                  << "the roots with --root" << std::endl;
+        printUsageAndExit();
+    }
+    std::cout << std::fixed;
+
+    if (!out.empty()) {
+        // the target tile as an exponent.
+        int exponent = 0;
+        while ((2 << exponent) <= target) exponent++;
+        if (target < 2 || (1 << exponent) != target) {
+            std::cerr << "The target must be a power of 2" << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        int64_t count = OutcomeTable::generate(out, size, exponent, kind,
+                                               roots);
+        std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - start;
+        if (count < 0) {
+            std::cerr << "Cannot write a table of size " << size
+                      << " and target " << target << " to " << out
+                      << std::endl;
+            return 1;
+        }
+        std::cout << "positions:    " << count << std::endl
+                  << "bytes:        " << 16 + count * 12 << std::endl
+                  << "seconds:      " << std::setprecision(1)
+                  << elapsed.count() << std::endl;
+        tablePath = out;
+        lookups = roots;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    OutcomeTable table;
+    if (!table.open(tablePath)) {
+        std::cerr << "Cannot open table " << tablePath << std::endl;
+        return 1;
+    }
+    std::chrono::duration<double, std::micro> opened =
+            std::chrono::steady_clock::now() - start;
+    std::cout << "table:        " << table.size() << "x" << table.size()
+              << ", target " << (1 << table.target()) << ", "
+              << (table.kind() == OutcomeTable::WIN ? "win probability"
+                                                    : "expected points")
+              << ", " << table.count() << " positions" << std::endl
+              << "open:         " << std::setprecision(1) << opened.count()
+              << " us" << std::endl;
+    std::cout << std::setprecision(4);
+    if (lookups.empty()) {
+        double value = newGameValue(table);
+        if (value >= 0) std::cout << "new game:     " << value << std::endl;
+    }
+    for (uint64_t key : lookups) {
+        if (table.size() == 3) {
+            printPosition<3>(table, key);
+        } else {
+            printPosition<4>(table, key);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "./OutcomeTable.h"
+#include "./Symmetry.h"
+
+namespace {
+// A fresh path for a table file.
+std::string tablePath() {
+    char path[] = "/tmp/OutcomeTableTest.XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    return path;
+}
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(OutcomeTableTest, canonical) {
+    // 2 4 . / . . . / . . 8 and its mirror image . 4 2 / . . . / 8 . .
+    Grid<3> grid;
+    grid.setExponent(0, 1);
+    grid.setExponent(1, 2);
+    grid.setExponent(8, 3);
+    Grid<3> mirrored;
+    mirrored.setExponent(2, 1);
+    mirrored.setExponent(1, 2);
+    mirrored.setExponent(6, 3);
+    uint64_t key = OutcomeTable::key(grid);
+    ASSERT_EQ(0x300000021ULL, key);
+    ASSERT_EQ(OutcomeTable::canonical(key, 3),
+              OutcomeTable::canonical(OutcomeTable::key(mirrored), 3));
+    ASSERT_LE(OutcomeTable::canonical(key, 3), key);
+
+    Bitboard board(0x0000123400005678ULL);
+    ASSERT_EQ(Symmetry::canonical(board, NULL).bits,
+              OutcomeTable::canonical(board.bits, 4));
+    ASSERT_EQ(board.bits, OutcomeTable::key(Grid<4>(board)));
+}
+
+// ____________________________________________________________________________
+TEST(OutcomeTableTest, win) {
+    std::string path = tablePath();
+    std::vector<uint64_t> newGames;
+    int64_t count = OutcomeTable::generate(path, 3, 4, OutcomeTable::WIN,
+                                           newGames);
+    ASSERT_GT(count, 0);
+    OutcomeTable table;
+    ASSERT_TRUE(table.open(path));
+    ASSERT_EQ(3, table.size());
+    ASSERT_EQ(4, table.target());
+    ASSERT_EQ(OutcomeTable::WIN, table.kind());
+    ASSERT_EQ(count, table.count());
+
+    // the target is on the board, or no move is left.
+    float value;
+    ASSERT_TRUE(table.lookup(0x4, &value));
+    ASSERT_FLOAT_EQ(1, value);
+    ASSERT_TRUE(table.lookup(0x121212121ULL, &value));
+    ASSERT_FLOAT_EQ(0, value);
+    // more tiles than any game below 16 can have.
+    ASSERT_FALSE(table.lookup(0x333333330ULL, &value));
+
+    // playing the best moves: the value of every position is the value of
+    // its best move, and 16 is always reached on 3x3.
+    Xoshiro256 rng(5);
+    Grid<3> grid;
+    grid.spawn(rng);
+    grid.spawn(rng);
+    while (true) {
+        ASSERT_TRUE(table.lookup(OutcomeTable::key(grid), &value));
+        float expected;
+        int move = table.bestMove(grid, &expected);
+        if (move < 0) break;
+        ASSERT_NEAR(value, expected, 1e-5);
+        grid = Grid<3>::move(grid, static_cast<Direction>(move), NULL);
+        grid.spawn(rng);
+    }
+    ASSERT_FLOAT_EQ(1, value);
+    // the table has no 4x4 positions.
+    float unused;
+    ASSERT_EQ(-1, table.bestMove(Grid<4>(Bitboard(0x11)), &unused));
+    unlink(path.c_str());
+}
+
+// ____________________________________________________________________________
+TEST(OutcomeTableTest, endgame) {
+    // a 4x4 board of 16s and 32s with three free fields, the first column
+    // 16 32 32 32.
+    std::string path = tablePath();
+    std::vector<uint64_t> roots(1, 0x0005454545455454ULL);
+    ASSERT_GT(OutcomeTable::generate(path, 4, 6, OutcomeTable::SCORE, roots),
+              0);
+    OutcomeTable table;
+    ASSERT_TRUE(table.open(path));
+    ASSERT_EQ(OutcomeTable::SCORE, table.kind());
+    float value;
+    ASSERT_TRUE(table.lookup(roots[0], &value));
+    // at least the 64 of merging two 32s in the first column.
+    ASSERT_GE(value, 64);
+    float expected;
+    int move = table.bestMove(Grid<4>(Bitboard(roots[0])), &expected);
+    ASSERT_GE(move, 0);
+    ASSERT_NEAR(value, expected, 1e-3);
+    unlink(path.c_str());
+}
+
+// ____________________________________________________________________________
+TEST(OutcomeTableTest, invalid) {
+    std::string path = tablePath();
+    std::vector<uint64_t> roots;
+    ASSERT_EQ(-1, OutcomeTable::generate(path, 5, 4, OutcomeTable::WIN,
+                                         roots));
+    ASSERT_EQ(-1, OutcomeTable::generate(path, 3, 16, OutcomeTable::WIN,
+                                         roots));
+    // all new 4x4 games are far too many.
+    ASSERT_EQ(-1, OutcomeTable::generate(path, 4, 4, OutcomeTable::WIN,
+                                         roots));
+    OutcomeTable table;
+    // empty, not a table and a table cut short.
+    ASSERT_FALSE(table.open(path));
+    FILE* file = std::fopen(path.c_str(), "wb");
+    std::fputs("not an outcome table", file);
+    std::fclose(file);
+    ASSERT_FALSE(table.open(path));
+    ASSERT_GT(OutcomeTable::generate(path, 3, 2, OutcomeTable::WIN, roots),
+              0);
+    ASSERT_TRUE(table.open(path));
+    ASSERT_EQ(0, truncate(path.c_str(), 20));
+    OutcomeTable cut;
+    ASSERT_FALSE(cut.open(path));
+    float value;
+    ASSERT_FALSE(cut.lookup(0x11, &value));
+    unlink(path.c_str());
+    ASSERT_FALSE(table.open("/nonexistent/table"));
+}
@@ -0,0 +1,381 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "./MoveTables.h"
+#include "./ParallelSearch.h"
+#include "./Symmetry.h"
+
+namespace {
+// pool and worker index of the current thread.
+thread_local const WorkStealingPool* currentPool = NULL;
+thread_local int currentIndex = 0;
+}  // namespace
+
+// ___________________________________________________________________________
+WorkStealingPool::WorkStealingPool(int numThreads) : stop(false), queued(0) {
+    if (numThreads <= 0) numThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0) numThreads = 1;
+    for (int i = 0; i < numThreads; i++) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (int i = 1; i < numThreads; i++) {
+        threads.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+    }
+}
+
+// ___________________________________________________________________________
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+// ___________________________________________________________________________
+int WorkStealingPool::currentWorker() const {
+    return currentPool == this ? currentIndex : 0;
+}
+
+// ___________________________________________________________________________
+void WorkStealingPool::Group::spawn(std::function<void()> task) {
+    pending++;
+    Queue &queue = *pool->queues[pool->currentWorker()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(Task { task, this });
+    }
+    if (pool->threads.empty()) {
+        pool->queued++;
+        return;
+    }
+    {
+        // counted under the lock the sleepers check it with, so a worker
+        // about to sleep either sees the task or gets the notification.
+        std::lock_guard<std::mutex> lock(pool->sleepMutex);
+        pool->queued++;
+    }
+    pool->wake.notify_one();
+}
+
+// ___________________________________________________________________________
+void WorkStealingPool::Group::wait() {
+    int self = pool->currentWorker();
+    // help out instead of blocking, our own tasks are found first.
+    while (pending > 0) {
+        if (!pool->runOne(self)) std::this_thread::yield();
+    }
+}
+
+// ___________________________________________________________________________
+bool WorkStealingPool::runOne(int self) {
+    Task task;
+    bool found = false;
+    // newest own task first (depth first, good locality).
+    {
+        Queue &own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+    // otherwise steal the oldest task of another worker.
+    for (size_t i = 1; !found && i < queues.size(); i++) {
+        Queue &victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (!found) return false;
+    queued--;
+    task.run();
+    task.group->pending--;
+    return true;
+}
+
+// ___________________________________________________________________________
+void WorkStealingPool::workerLoop(int index) {
+    currentPool = this;
+    currentIndex = index;
+    while (!stop) {
+        if (runOne(index)) continue;
+        // sleep until there is work again, without waking up in between.
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return queued > 0 || stop; });
+    }
+}
+
+// ___________________________________________________________________________
+SharedTable::SharedTable(int bits)
+    : bits(bits), slots(new Slot[size_t(1) << bits]) {
+    clear();
+}
+
+// ___________________________________________________________________________
+void SharedTable::clear() {
+    for (size_t i = 0; i < (size_t(1) << bits); i++) {
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+// ___________________________________________________________________________
+bool SharedTable::lookup(uint64_t board, int remaining, uint16_t generation,
+        float* value) const {
+    const Slot &slot = slots[(board * 0x9E3779B97F4A7C15ULL) >> (64 - bits)];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if ((check ^ data) != board) return false;
+    if ((data >> 48) != generation) return false;
+    if (static_cast<int>((data >> 32) & 0xFFFF) < remaining) return false;
+    uint32_t valueBits = static_cast<uint32_t>(data);
+    std::memcpy(value, &valueBits, sizeof(float));
+    return true;
+}
+
+// ___________________________________________________________________________
+void SharedTable::store(uint64_t board, int remaining, uint16_t generation,
+        float value) {
+    Slot &slot = slots[(board * 0x9E3779B97F4A7C15ULL) >> (64 - bits)];
+    uint32_t valueBits;
+    std::memcpy(&valueBits, &value, sizeof(float));
+    uint64_t data = uint64_t(generation) << 48 | uint64_t(remaining) << 32
+            | valueBits;
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(board ^ data, std::memory_order_relaxed);
+}
+
+// ___________________________________________________________________________
+ParallelExpectimax::ParallelExpectimax(int depth, int numThreads,
+        bool canonicalKeys)
+    : fixedDepth(depth), canonicalKeys(canonicalKeys), depthLimit(0),
+      generation(0), pool(numThreads), table(20),
+      counters(new Counter[pool.size()]), seconds(0), timed(false),
+      aborted(false), reachedDepth(0) {
+    for (int i = 0; i < pool.size(); i++) counters[i].nodes = 0;
+}
+
+// ___________________________________________________________________________
+uint64_t ParallelExpectimax::tableKey(const Bitboard &board) const {
+    return canonicalKeys ? Symmetry::canonical(board, NULL).bits : board.bits;
+}
+
+// ___________________________________________________________________________
+SearchStats ParallelExpectimax::stats() const {
+    SearchStats result;
+    for (int i = 0; i < pool.size(); i++) result.nodes += counters[i].nodes;
+    result.seconds = seconds;
+    return result;
+}
+
+// ___________________________________________________________________________
+void ParallelExpectimax::countNodes(int64_t nodes) {
+    counters[pool.currentWorker()].nodes.fetch_add(nodes,
+                                                   std::memory_order_relaxed);
+}
+
+// ___________________________________________________________________________
+void ParallelExpectimax::scoreMoves(const Bitboard &board, float values[4]) {
+    searchDepth(board, fixedDepth > 0 ? fixedDepth : adaptiveDepth(board),
+                false, values);
+}
+
+// ___________________________________________________________________________
+bool ParallelExpectimax::searchDepth(const Bitboard &board, int depth,
+        bool timed, float values[4]) {
+    auto start = std::chrono::steady_clock::now();
+    // generation 0 marks empty slots. When the generations start over,
+    // the slots of the searches 65535 back must not pass for this one's.
+    if (++generation == 0) {
+        table.clear();
+        generation = 1;
+    }
+    depthLimit = depth;
+    this->timed = timed;
+    aborted = false;
+
+    WorkStealingPool::Group group(&pool);
+    for (int d = 0; d < 4; d++) {
+        values[d] = 0;
+        Bitboard moved = MoveTables::move(board, static_cast<Direction>(d),
+                                          NULL);
+        if (moved == board) continue;
+        float* value = &values[d];
+        group.spawn([this, moved, value]() {
+            *value = chanceNode(moved, 1.0f, 0) + 1e-6f;
+        });
+    }
+    group.wait();
+
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    seconds += elapsed.count();
+    return !aborted;
+}
+
+// ___________________________________________________________________________
+bool ParallelExpectimax::timeIsUp() {
+    if (!timed) return false;
+    if (!aborted && std::chrono::steady_clock::now() >= deadline) {
+        aborted = true;
+    }
+    return aborted;
+}
+
+// ___________________________________________________________________________
+int ParallelExpectimax::bestMove(const Bitboard &board) {
+    float values[4];
+    scoreMoves(board, values);
+    int best = -1;
+    float bestValue = 0;
+    for (int d = 0; d < 4; d++) {
+        if (values[d] > bestValue) {
+            best = d;
+            bestValue = values[d];
+        }
+    }
+    return best;
+}
+
+// ___________________________________________________________________________
+int ParallelExpectimax::bestMove(const Bitboard &board, double budgetMs) {
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::microseconds(static_cast<int64_t>(budgetMs * 1000));
+    int best = -1;
+    int legal = 0;
+    reachedDepth = 0;
+    for (int depth = 1; depth <= kMaxDepth; depth++) {
+        float values[4];
+        // the first depth is not timed, so there always is a move.
+        if (!searchDepth(board, depth, depth > 1, values)) break;
+        reachedDepth = depth;
+        float bestValue = 0;
+        legal = 0;
+        for (int d = 0; d < 4; d++) {
+            if (values[d] > 0) legal++;
+            if (values[d] > bestValue) {
+                best = d;
+                bestValue = values[d];
+            }
+        }
+        // nothing to choose, or no time for a deeper search.
+        if (legal <= 1 || std::chrono::steady_clock::now() >= deadline) break;
+    }
+    return best;
+}
+
+// ___________________________________________________________________________
+float ParallelExpectimax::chanceNode(const Bitboard &board,
+        float probability, int depth) {
+    if (depth >= kSplitDepth || probability < Expectimax::kMinProbability ||
+        depth >= depthLimit) {
+        int64_t nodes = 0;
+        float value = chanceNodeLocal(board, probability, depth, &nodes);
+        countNodes(nodes);
+        return value;
+    }
+    countNodes(1);
+    if (timeIsUp()) return 0;
+    float value;
+    int remaining = depthLimit - depth;
+    uint64_t key = tableKey(board);
+    if (table.lookup(key, remaining, generation, &value)) return value;
+
+    // one task per empty field, each trying a 2 and a 4.
+    uint16_t empty = board.emptyMask();
+    int numEmpty = __builtin_popcount(empty);
+    probability /= numEmpty;
+    float results[16];
+    WorkStealingPool::Group group(&pool);
+    for (int field = 0; field < 16; field++) {
+        results[field] = 0;
+        if (!(empty & (1 << field))) continue;
+        float* result = &results[field];
+        group.spawn([this, board, field, probability, depth, result]() {
+            uint64_t two = board.bits | uint64_t(1) << (4 * field);
+            uint64_t four = board.bits | uint64_t(2) << (4 * field);
+            *result = maxNode(Bitboard(two), probability * 0.9f, depth) * 0.9f
+                    + maxNode(Bitboard(four), probability * 0.1f, depth)
+                      * 0.1f;
+        });
+    }
+    group.wait();
+
+    value = 0;
+    for (int field = 0; field < 16; field++) value += results[field];
+    value /= numEmpty;
+    table.store(key, remaining, generation, value);
+    return value;
+}
+
+// ___________________________________________________________________________
+float ParallelExpectimax::maxNode(const Bitboard &board, float probability,
+        int depth) {
+    countNodes(1);
+    float best = 0;
+    for (int d = 0; d < 4; d++) {
+        Bitboard moved = MoveTables::move(board, static_cast<Direction>(d),
+                                          NULL);
+        if (moved == board) continue;
+        best = std::max(best, chanceNode(moved, probability, depth + 1));
+    }
+    return best;
+}
+
+// ___________________________________________________________________________
+float ParallelExpectimax::chanceNodeLocal(const Bitboard &board,
+        float probability, int depth, int64_t* nodes) {
+    (*nodes)++;
+    if (probability < Expectimax::kMinProbability || depth >= depthLimit) {
+        return heuristicValue(board);
+    }
+    // the clock is read every 1024 nodes of a task. An aborted search
+    // only unwinds: its values are not used, and what it stored belongs
+    // to a generation no later search looks up.
+    if ((*nodes & 1023) == 0 ? timeIsUp() : aborted.load()) return 0;
+    float value;
+    int remaining = depthLimit - depth;
+    uint64_t key = tableKey(board);
+    if (table.lookup(key, remaining, generation, &value)) return value;
+
+    uint16_t empty = board.emptyMask();
+    int numEmpty = __builtin_popcount(empty);
+    probability /= numEmpty;
+    value = 0;
+    for (int field = 0; field < 16; field++) {
+        if (!(empty & (1 << field))) continue;
+        uint64_t two = board.bits | uint64_t(1) << (4 * field);
+        uint64_t four = board.bits | uint64_t(2) << (4 * field);
+        value += maxNodeLocal(Bitboard(two), probability * 0.9f, depth,
+                              nodes) * 0.9f;
+        value += maxNodeLocal(Bitboard(four), probability * 0.1f, depth,
+                              nodes) * 0.1f;
+    }
+    value /= numEmpty;
+    table.store(key, remaining, generation, value);
+    return value;
+}
+
+// ___________________________________________________________________________
+float ParallelExpectimax::maxNodeLocal(const Bitboard &board,
+        float probability, int depth, int64_t* nodes) {
+    (*nodes)++;
+    float best = 0;
+    for (int d = 0; d < 4; d++) {
+        Bitboard moved = MoveTables::move(board, static_cast<Direction>(d),
+                                          NULL);
+        if (moved == board) continue;
+        best = std::max(best, chanceNodeLocal(moved, probability, depth + 1,
+                                              nodes));
+    }
+    return best;
+}
@@ -0,0 +1,188 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef PARALLELSEARCH_H_
+#define PARALLELSEARCH_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "./Bitboard.h"
+#include "./Expectimax.h"
+
+// Fork-join thread pool. Every worker owns a task queue: it pushes and pops
+// its own tasks at the back and, when its queue runs dry, steals the oldest
+// (and usually biggest) task from the front of another worker's queue. The
+// thread calling search functions acts as worker 0, so only one thread at
+// a time may use a pool from outside.
+class WorkStealingPool {
+ public:
+    // numThreads counts the calling thread, so numThreads - 1 threads are
+    // started (0 = one per core).
+    explicit WorkStealingPool(int numThreads);
+    ~WorkStealingPool();
+
+    // A set of tasks forked together and joined by wait().
+    class Group {
+     public:
+        explicit Group(WorkStealingPool* pool) : pool(pool), pending(0) {}
+
+        // Queue a task on the current worker.
+        void spawn(std::function<void()> task);
+
+        // Run own or stolen tasks until all tasks of the group are done.
+        void wait();
+
+     private:
+        friend class WorkStealingPool;
+        WorkStealingPool* pool;
+        std::atomic<int> pending;
+    };
+
+    int size() const { return static_cast<int>(queues.size()); }
+
+    // Index of the worker running the caller (0 outside of pool threads).
+    int currentWorker() const;
+
+ private:
+    struct Task {
+        std::function<void()> run;
+        Group* group;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Run one task, own ones first. Returns false if all queues are empty.
+    bool runOne(int self);
+
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stop;
+    // number of queued tasks, idle workers sleep while it is 0.
+    std::atomic<int> queued;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+};
+
+// Transposition table shared by all search threads without locks. A slot
+// is two atomic words, the packed entry and the board xor'ed with it, so a
+// torn write (one word from each of two writers) fails the check on read
+// instead of returning a wrong value.
+class SharedTable {
+ public:
+    explicit SharedTable(int bits);
+
+    // Look up the value of a chance node searched at least remaining deep
+    // in the given generation.
+    bool lookup(uint64_t board, int remaining, uint16_t generation,
+            float* value) const;
+
+    void store(uint64_t board, int remaining, uint16_t generation,
+            float value);
+
+    // Empty all slots (while no search uses the table), e.g. before the
+    // generations start over.
+    void clear();
+
+ private:
+    struct Slot {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    int bits;
+    std::unique_ptr<Slot[]> slots;
+};
+
+// Expectimax search (same evaluation as Expectimax) whose root moves and
+// upper chance nodes are split into tasks on a WorkStealingPool. Everything
+// below the split depth is searched sequentially by the thread that took
+// the task, using the shared table.
+class ParallelExpectimax {
+ public:
+    // depth 0 picks the depth like Expectimax, numThreads 0 uses all cores.
+    // canonicalKeys works like for Expectimax.
+    ParallelExpectimax(int depth, int numThreads, bool canonicalKeys = false);
+
+    // The best move for the board, or -1 if no move is possible.
+    int bestMove(const Bitboard &board);
+
+    // The best move found within budgetMs ms by iterative deepening: the
+    // search goes one move deeper at a time (up to kMaxDepth) and the
+    // deepest search that finished in time decides. One move deep always
+    // finishes.
+    int bestMove(const Bitboard &board, double budgetMs);
+
+    // Depth reached by the last bestMove() with a budget.
+    int lastDepth() const { return reachedDepth; }
+
+    // Expected heuristic value of all four moves (0 for illegal ones).
+    void scoreMoves(const Bitboard &board, float values[4]);
+
+    // Nodes and time of all searches so far.
+    SearchStats stats() const;
+
+    int threads() const { return pool.size(); }
+
+    // Chance nodes less than this many moves deep are split into tasks.
+    static const int kSplitDepth = 2;
+
+    // Deepest search of iterative deepening.
+    static const int kMaxDepth = 12;
+
+ private:
+    // Search all moves depth moves deep. Returns false if the deadline
+    // passed before the search finished (values are then incomplete).
+    bool searchDepth(const Bitboard &board, int depth, bool timed,
+            float values[4]);
+
+    // Has the deadline passed? Sets aborted if so.
+    bool timeIsUp();
+
+    float chanceNode(const Bitboard &board, float probability, int depth);
+    float maxNode(const Bitboard &board, float probability, int depth);
+
+    // Sequential search below the split depth; counts nodes into *nodes.
+    float chanceNodeLocal(const Bitboard &board, float probability,
+            int depth, int64_t* nodes);
+    float maxNodeLocal(const Bitboard &board, float probability,
+            int depth, int64_t* nodes);
+
+    void countNodes(int64_t nodes);
+
+    // the key of a board in the table.
+    uint64_t tableKey(const Bitboard &board) const;
+
+    int fixedDepth;
+    bool canonicalKeys;
+    int depthLimit;
+    uint16_t generation;
+    WorkStealingPool pool;
+    SharedTable table;
+
+    // one node counter per worker, padded to its own cache line.
+    struct Counter {
+        std::atomic<int64_t> nodes;
+        char padding[64 - sizeof(std::atomic<int64_t>)];
+    };
+    std::unique_ptr<Counter[]> counters;
+    double seconds;
+
+    // the deadline of a search with a budget, and whether it has passed.
+    bool timed;
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<bool> aborted;
+    int reachedDepth;
+};
+
+#endif  // PARALLELSEARCH_H_
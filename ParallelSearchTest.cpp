@@ -0,0 +1,102 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include "./BenchmarkPositions.h"
+#include "./ParallelSearch.h"
+
+namespace {
+// sum 1..n by recursively forking the two halves.
+int64_t forkSum(WorkStealingPool* pool, int64_t first, int64_t last) {
+    if (last - first < 8) {
+        int64_t sum = 0;
+        for (int64_t i = first; i < last; i++) sum += i;
+        return sum;
+    }
+    int64_t middle = (first + last) / 2;
+    int64_t left = 0;
+    int64_t right = 0;
+    WorkStealingPool::Group group(pool);
+    group.spawn([&]() { left = forkSum(pool, first, middle); });
+    group.spawn([&]() { right = forkSum(pool, middle, last); });
+    group.wait();
+    return left + right;
+}
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(ParallelSearchTest, pool) {
+    for (int threads = 1; threads <= 4; threads++) {
+        WorkStealingPool pool(threads);
+        ASSERT_EQ(threads, pool.size());
+        ASSERT_EQ(0, pool.currentWorker());
+        ASSERT_EQ(10000 * 9999 / 2, forkSum(&pool, 0, 10000));
+    }
+}
+
+// ____________________________________________________________________________
+TEST(ParallelSearchTest, sharedTable) {
+    SharedTable table(4);
+    float value = 0;
+    ASSERT_FALSE(table.lookup(0x1234, 1, 1, &value));
+    table.store(0x1234, 3, 1, 42.5f);
+    ASSERT_TRUE(table.lookup(0x1234, 3, 1, &value));
+    ASSERT_FLOAT_EQ(42.5f, value);
+    ASSERT_TRUE(table.lookup(0x1234, 2, 1, &value));
+    // not deep enough, other generation, other board.
+    ASSERT_FALSE(table.lookup(0x1234, 4, 1, &value));
+    ASSERT_FALSE(table.lookup(0x1234, 3, 2, &value));
+    ASSERT_FALSE(table.lookup(0x1235, 3, 1, &value));
+    // emptied, as when the generations start over.
+    table.clear();
+    ASSERT_FALSE(table.lookup(0x1234, 3, 1, &value));
+}
+
+// ____________________________________________________________________________
+TEST(ParallelSearchTest, agreesWithExpectimax) {
+    Expectimax sequential(2);
+    ParallelExpectimax one(2, 1);
+    ParallelExpectimax four(2, 4);
+    for (const auto& bits : kBenchmarkPositions) {
+        Bitboard board(bits);
+        float a[4];
+        float b[4];
+        one.scoreMoves(board, a);
+        four.scoreMoves(board, b);
+        for (int d = 0; d < 4; d++) {
+            float expected = sequential.scoreMove(board,
+                                                  static_cast<Direction>(d));
+            ASSERT_NEAR(expected, a[d], 1e-3 * expected);
+            ASSERT_NEAR(expected, b[d], 1e-3 * expected);
+        }
+    }
+    ASSERT_GT(four.stats().nodes, 0);
+    ASSERT_EQ(-1, four.bestMove(Bitboard(0x1212212112122121ULL)));
+}
+
+// ____________________________________________________________________________
+TEST(ParallelSearchTest, budget) {
+    ParallelExpectimax search(0, 4);
+    Bitboard board(kBenchmarkPositions[2]);
+    // a small budget stops deepening in time, a bigger one goes deeper.
+    auto start = std::chrono::steady_clock::now();
+    int move = search.bestMove(board, 10);
+    std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+    ASSERT_GE(move, 0);
+    ASSERT_NE(board, MoveTables::move(board, static_cast<Direction>(move),
+                                      NULL));
+    ASSERT_LT(elapsed.count(), 200);
+    int shallow = search.lastDepth();
+    ASSERT_GE(shallow, 1);
+    search.bestMove(board, 300);
+    ASSERT_GT(search.lastDepth(), shallow);
+
+    // the first depth always finishes, whatever the budget.
+    ASSERT_GE(search.bestMove(board, 0), 0);
+    ASSERT_EQ(1, search.lastDepth());
+    ASSERT_EQ(-1, search.bestMove(Bitboard(0x1212212112122121ULL), 5));
+}
@@ -0,0 +1,75 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <cstdint>
+
+// One step of the splitmix64 generator. Used to expand a single 64 bit seed
+// into well distributed state words.
+inline uint64_t splitmix64(uint64_t &state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// The xoshiro256** generator by Blackman and Vigna: 32 bytes of state and a
+// handful of shifts and multiplications per number. Meets the requirements
+// of a UniformRandomBitGenerator, but below() should be preferred, since it
+// gives the same numbers with every standard library.
+class Xoshiro256 {
+ public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256(uint64_t seed = 0) { this->seed(seed); }
+
+    void seed(uint64_t seed) {
+        for (int i = 0; i < 4; i++) s[i] = splitmix64(seed);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    result_type operator()() {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // Uniform number in [0, n) for n > 0, without modulo bias (Lemire's
+    // multiply and shift method, which almost never needs a division).
+    uint32_t below(uint32_t n) {
+        uint64_t m = uint64_t(static_cast<uint32_t>((*this)() >> 32)) * n;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < n) {
+            uint32_t threshold = -n % n;
+            while (low < threshold) {
+                m = uint64_t(static_cast<uint32_t>((*this)() >> 32)) * n;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    bool operator==(const Xoshiro256 &other) const {
+        return s[0] == other.s[0] && s[1] == other.s[1] &&
+               s[2] == other.s[2] && s[3] == other.s[3];
+    }
+
+    uint64_t s[4];
+
+ private:
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+#endif  // RANDOM_H_
@@ -0,0 +1,38 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include "./Random.h"
+
+// ____________________________________________________________________________
+TEST(RandomTest, seed) {
+    Xoshiro256 a(7);
+    Xoshiro256 b(7);
+    Xoshiro256 c(8);
+    for (int i = 0; i < 100; i++) ASSERT_EQ(a(), b());
+    ASSERT_NE(a(), c());
+
+    // reseeding restarts the sequence.
+    Xoshiro256 d(7);
+    uint64_t first = d();
+    d();
+    d.seed(7);
+    ASSERT_EQ(first, d());
+}
+
+// ____________________________________________________________________________
+TEST(RandomTest, below) {
+    Xoshiro256 rng(1);
+    int counts[10] = { 0 };
+    for (int i = 0; i < 100000; i++) {
+        uint32_t x = rng.below(10);
+        ASSERT_LT(x, 10u);
+        counts[x]++;
+    }
+    // every value shows up about 10000 times.
+    for (int i = 0; i < 10; i++) {
+        ASSERT_GT(counts[i], 9500);
+        ASSERT_LT(counts[i], 10500);
+    }
+    ASSERT_EQ(0u, rng.below(1));
+}
@@ -0,0 +1,63 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "./GameRecord.h"
+
+// Scans a record file written with Game2048Main --record, replays every
+// game in it and reports the games, their scores and the replay speed.
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cout << "Usage: RecordReplayMain FILE\n";
+        exit(1);
+    }
+    GameRecordReader reader;
+    if (!reader.open(argv[1])) {
+        std::cerr << "Cannot open " << argv[1] << "\n";
+        exit(1);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    GameRecordView view;
+    ReplayResult result;
+    int64_t games = 0;
+    int64_t events = 0;
+    int64_t invalid = 0;
+    int64_t incomplete = 0;
+    int64_t totalScore = 0;
+    int bestScore = 0;
+    int maxExponent = 0;
+    while (reader.next(&view)) {
+        games++;
+        events += view.numEvents;
+        if (!view.complete) incomplete++;
+        if (!reader.replay(view, &result)) {
+            invalid++;
+            continue;
+        }
+        totalScore += result.score;
+        if (result.score > bestScore) bestScore = result.score;
+        if (result.maxExponent > maxExponent) maxExponent = result.maxExponent;
+    }
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count();
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "games:        " << games << " (" << incomplete
+              << " incomplete, " << invalid << " invalid)\n"
+              << "events:       " << events << "\n"
+              << "bytes/event:  "
+              << (events > 0 ? double(reader.fileSize()) / events : 0) << "\n"
+              << "mean score:   "
+              << (games > invalid ? double(totalScore) / (games - invalid) : 0)
+              << "\nbest score:   " << bestScore << "\n"
+              << "max tile:     " << (maxExponent > 0 ? 1 << maxExponent : 0)
+              << "\n" << std::setprecision(0)
+              << "events/s:     " << (seconds > 0 ? events / seconds : 0)
+              << "\n";
+}
@@ -0,0 +1,139 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <errno.h>
+#include <ncurses.h>
+#include <unistd.h>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include "./ScriptPlayer.h"
+
+namespace {
+// bytes read per read(), and results collected before they are written.
+const size_t kReadSize = 1 << 18;
+const size_t kWriteSize = 1 << 16;
+
+// What a byte of the input does: a Direction, a new game, nothing, or it
+// is no key at all.
+const int8_t kNewGame = 4;
+const int8_t kSkip = 5;
+const int8_t kBad = 6;
+
+struct KeyTable {
+    int8_t action[256];
+    KeyTable() {
+        for (int i = 0; i < 256; i++) action[i] = kBad;
+        for (int i = LEFT; i <= DOWN; i++) action[i] = i;
+        action[4] = kNewGame;
+        action['l'] = action['L'] = LEFT;
+        action['r'] = action['R'] = RIGHT;
+        action['u'] = action['U'] = UP;
+        action['d'] = action['D'] = DOWN;
+        action['n'] = kNewGame;
+        action[' '] = action['\t'] = action['\r'] = action['\n'] = kSkip;
+    }
+};
+const KeyTable kKeys;
+
+// The keys Game::play takes for the Directions.
+const int kMoveKeys[4] = { KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN };
+
+// Write all of bytes to fd. Returns false if that fails.
+bool writeAll(int fd, const std::string &bytes) {
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = write(fd, bytes.data() + written, bytes.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+}  // namespace
+
+// ___________________________________________________________________________
+ScriptPlayer::ScriptPlayer(Game* game)
+    : game(game), firstSeed(game->seed), keyCount(0), gameCount(0),
+      offset(0), badOffset(-1), played(false) {}
+
+// ___________________________________________________________________________
+bool ScriptPlayer::feed(const char* data, size_t length,
+        std::string* results) {
+    for (size_t i = 0; i < length; i++) {
+        int8_t action = kKeys.action[static_cast<uint8_t>(data[i])];
+        if (action == kSkip) continue;
+        if (action == kBad) {
+            badOffset = offset + i;
+            offset += length;
+            return false;
+        }
+        keyCount++;
+        if (action == kNewGame) {
+            appendResult(results);
+            gameCount++;
+            game->restart(firstSeed + gameCount);
+            played = false;
+            continue;
+        }
+        game->play(kMoveKeys[action]);
+        played = true;
+    }
+    offset += length;
+    return true;
+}
+
+// ___________________________________________________________________________
+void ScriptPlayer::finish(std::string* results) {
+    if (!played && gameCount > 0) return;
+    appendResult(results);
+    gameCount++;
+    played = false;
+}
+
+// ___________________________________________________________________________
+void ScriptPlayer::appendResult(std::string* results) const {
+    Bitboard board = game->states.back();
+    char buffer[128];
+    int length = snprintf(buffer, sizeof(buffer),
+                          "%" PRId64 " %" PRIu64 " %016" PRIx64
+                          " %d %d %d %d\n", gameCount, game->seed,
+                          board.bits, game->points, game->steps,
+                          1 << MoveTables::summarize(board).maxExponent,
+                          game->gameOver ? 1 : 0);
+    results->append(buffer, length);
+}
+
+// ___________________________________________________________________________
+bool ScriptPlayer::run(int inFd, int outFd, Board* board, int frameMs) {
+    typedef std::chrono::steady_clock Clock;
+    std::string results(header());
+    std::string buffer(kReadSize, '\0');
+    Clock::time_point lastFrame = Clock::now();
+    if (board) board->initialize();
+    bool ok = true;
+    while (ok) {
+        ssize_t n = read(inFd, &buffer[0], buffer.size());
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) ok = false;
+        if (n <= 0) break;
+        ok = feed(buffer.data(), n, &results);
+        // drawn once per chunk at most: the clock is not read per key.
+        if (board && Clock::now() - lastFrame >=
+                     std::chrono::milliseconds(frameMs)) {
+            lastFrame = Clock::now();
+            board->drawBoard(game->states.back());
+            board->drawStats(game->steps, game->points, game->gameOver,
+                             game->gameWon);
+            board->finishFrame();
+        }
+        if (!board && results.size() >= kWriteSize) {
+            ok = writeAll(outFd, results) && ok;
+            results.clear();
+        }
+    }
+    if (board) board->finish();
+    finish(&results);
+    return writeAll(outFd, results) && ok;
+}
@@ -0,0 +1,75 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef SCRIPTPLAYER_H_
+#define SCRIPTPLAYER_H_
+
+#include <cstdint>
+#include <string>
+#include "./Game2048.h"
+
+// Plays a stream of keys (e.g. from a bot on a pipe) on a game as fast as
+// the game can move: the input is read in big chunks, every byte is one
+// key, and the results are written in batches. Text and binary keys mix
+// freely, one byte each:
+//
+//   l r u d (or L R U D)   move left, right, up or down
+//   bytes 0 1 2 3          the same moves in Direction order
+//   n or byte 4            end the game and start the next one
+//   blanks and newlines    ignored
+//
+// Moves after the game is over are ignored until the next 'n'. Game i
+// (counting from 0) is played with the seed of the game plus i, so any
+// game can be replayed alone with --seed.
+//
+// Each game that ends (by 'n' or the end of the input) gives one result
+// line "GAME SEED BOARD POINTS STEPS MAX_TILE OVER", with the final
+// Bitboard as 16 hex digits and OVER 1 if no move was left.
+class ScriptPlayer {
+ public:
+    // Play on game, starting with its current state and seed.
+    explicit ScriptPlayer(Game* game);
+
+    // Play the keys of data and append the results of the games that end
+    // to results. Returns false at the first byte that is no key, with
+    // errorOffset() its position in the whole input.
+    bool feed(const char* data, size_t length, std::string* results);
+
+    // The input is over: append the result of the current game, unless it
+    // has just been started by an 'n'.
+    void finish(std::string* results);
+
+    // Play all keys of inFd and write the results to outFd. With a board,
+    // the game is drawn on it at most every frameMs ms (initialized and
+    // finished here), and the results are only written after it is gone.
+    // Returns false at a byte that is no key or if reading or writing
+    // fails.
+    bool run(int inFd, int outFd, Board* board, int frameMs);
+
+    // Keys played (moves and 'n'), games finished so far and the position
+    // of the byte that was no key (-1 if none).
+    int64_t keys() const { return keyCount; }
+    int64_t games() const { return gameCount; }
+    int64_t errorOffset() const { return badOffset; }
+
+    // The line naming the columns of the results.
+    static const char* header() {
+        return "# game seed board points steps max-tile over\n";
+    }
+
+ private:
+    // Append the result line of the current game.
+    void appendResult(std::string* results) const;
+
+    Game* game;
+    uint64_t firstSeed;
+    int64_t keyCount;
+    int64_t gameCount;
+    // bytes fed so far, and where the bad byte was.
+    int64_t offset;
+    int64_t badOffset;
+    // keys since the current game started.
+    bool played;
+};
+
+#endif  // SCRIPTPLAYER_H_
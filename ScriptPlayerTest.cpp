@@ -0,0 +1,110 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <ncurses.h>
+#include <unistd.h>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include "./ScriptPlayer.h"
+
+// ____________________________________________________________________________
+TEST(ScriptPlayerTest, feed) {
+    // text and binary keys play the same game as the keyboard.
+    Game text;
+    text.restart(7);
+    Game binary;
+    binary.restart(7);
+    Game keyboard;
+    keyboard.restart(7);
+    const char keys[] = "lurd dd\nLURR";
+    const char bytes[] = { 0, 2, 1, 3, 3, 3, 0, 2, 1, 1 };
+    const int moves[] = { KEY_LEFT, KEY_UP, KEY_RIGHT, KEY_DOWN, KEY_DOWN,
+                          KEY_DOWN, KEY_LEFT, KEY_UP, KEY_RIGHT, KEY_RIGHT };
+    std::string results;
+    ScriptPlayer textPlayer(&text);
+    ASSERT_TRUE(textPlayer.feed(keys, sizeof(keys) - 1, &results));
+    ScriptPlayer binaryPlayer(&binary);
+    ASSERT_TRUE(binaryPlayer.feed(bytes, sizeof(bytes), &results));
+    for (int key : moves) keyboard.play(key);
+    ASSERT_EQ("", results);
+    ASSERT_EQ(10, textPlayer.keys());
+    ASSERT_EQ(keyboard.current(), text.current());
+    ASSERT_EQ(keyboard.current(), binary.current());
+
+    // the game ends with the input, and a byte that is no key stops it.
+    textPlayer.finish(&results);
+    ASSERT_EQ(1, textPlayer.games());
+    ASSERT_EQ(0u, results.find("0 7 "));
+    ASSERT_FALSE(binaryPlayer.feed("lx", 2, &results));
+    ASSERT_EQ(11, binaryPlayer.errorOffset());
+    ASSERT_EQ(11, binaryPlayer.keys());
+}
+
+// ____________________________________________________________________________
+TEST(ScriptPlayerTest, games) {
+    // 'n' and byte 4 start the next game with the next seed.
+    Game game;
+    game.restart(100);
+    ScriptPlayer player(&game);
+    std::string results;
+    const char keys[] = "lr\x04ud\x04n";
+    ASSERT_TRUE(player.feed(keys, sizeof(keys) - 1, &results));
+    ASSERT_EQ(3, player.games());
+    ASSERT_EQ(103u, game.seed);
+    player.finish(&results);
+    // the game started by the last 'n' has no keys: no result.
+    ASSERT_EQ(3, player.games());
+    uint64_t seed;
+    uint64_t board;
+    int points, steps, maxTile, over;
+    ASSERT_EQ(6, sscanf(results.c_str(),
+                        "0 %" SCNu64 " %" SCNx64 " %d %d %d %d", &seed,
+                        &board, &points, &steps, &maxTile, &over));
+    ASSERT_EQ(100u, seed);
+    ASSERT_GT(steps, 0);
+    ASSERT_GE(maxTile, 2);
+    ASSERT_EQ(0, over);
+    ASSERT_NE(std::string::npos, results.find("\n1 101 "));
+    ASSERT_NE(std::string::npos, results.find("\n2 102 "));
+
+    // moves of a lost game change nothing.
+    game.restart(1);
+    ScriptPlayer lost(&game);
+    std::string many;
+    for (int i = 0; i < 5000; i++) many += "lurd";
+    ASSERT_TRUE(lost.feed(many.data(), many.size(), &results));
+    ASSERT_TRUE(game.gameOver);
+    GameState end = game.current();
+    ASSERT_TRUE(lost.feed("lurd", 4, &results));
+    ASSERT_EQ(end, game.current());
+}
+
+// ____________________________________________________________________________
+TEST(ScriptPlayerTest, run) {
+    int keys[2];
+    ASSERT_EQ(0, pipe(keys));
+    std::string script;
+    for (int i = 0; i < 5; i++) script += "lurdlurdlurd\nn";
+    ASSERT_EQ(static_cast<ssize_t>(script.size()),
+              write(keys[1], script.data(), script.size()));
+    close(keys[1]);
+    FILE* out = tmpfile();
+    Game game;
+    game.restart(3);
+    ScriptPlayer player(&game);
+    ASSERT_TRUE(player.run(keys[0], fileno(out), NULL, -1));
+    close(keys[0]);
+    ASSERT_EQ(5, player.games());
+    ASSERT_EQ(65, player.keys());
+
+    rewind(out);
+    char line[256];
+    ASSERT_TRUE(fgets(line, sizeof(line), out));
+    ASSERT_EQ(std::string(ScriptPlayer::header()), line);
+    int lines = 0;
+    while (fgets(line, sizeof(line), out)) lines++;
+    ASSERT_EQ(5, lines);
+    fclose(out);
+}
@@ -0,0 +1,76 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <getopt.h>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "./BenchmarkPositions.h"
+#include "./ParallelSearch.h"
+
+// Time-to-depth benchmark of ParallelExpectimax: searches a fixed set of
+// recorded positions to a fixed depth with 1, 2, 4, ... threads and reports
+// the time, the speedup over one thread and the node rate.
+
+namespace {
+void printUsageAndExit() {
+    std::cout << "Usage: SearchBenchmarkMain [--min-depth D] [--max-depth D]"
+              << " [--max-threads T]\n";
+    exit(1);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    int minDepth = 2;
+    int maxDepth = 4;
+    int maxThreads = std::thread::hardware_concurrency();
+    struct option options[] = {
+            { "min-depth", 1, NULL, 'd'},
+            { "max-depth", 1, NULL, 'D'},
+            { "max-threads", 1, NULL, 't'},
+            { "help", 0, NULL, 'h'},
+            { NULL, 0, NULL, 0 }
+    };
+    while (true) {
+        int c = getopt_long(argc, argv, "d:D:t:h", options, NULL);
+        if (c == -1) break;
+        switch (c) {
+            case 'd': minDepth = atoi(optarg); break;
+            case 'D': maxDepth = atoi(optarg); break;
+            case 't': maxThreads = atoi(optarg); break;
+            default: printUsageAndExit();
+        }
+    }
+    if (maxThreads < 1) maxThreads = 1;
+
+    std::vector<int> threadCounts;
+    for (int t = 1; t < maxThreads; t *= 2) threadCounts.push_back(t);
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "depth  threads   time [ms]  speedup    nodes/s\n";
+    std::cout << std::fixed;
+    for (int depth = minDepth; depth <= maxDepth; depth++) {
+        double single = 0;
+        for (const auto& threads : threadCounts) {
+            ParallelExpectimax search(depth, threads);
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& bits : kBenchmarkPositions) {
+                search.bestMove(Bitboard(bits));
+            }
+            std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - start;
+            double seconds = elapsed.count();
+            if (threads == 1) single = seconds;
+
+            std::cout << std::setw(5) << depth << std::setw(9) << threads
+                      << std::setprecision(1) << std::setw(12)
+                      << seconds * 1000 << std::setprecision(2)
+                      << std::setw(9) << single / seconds
+                      << std::setprecision(0) << std::setw(11)
+                      << search.stats().nodes / seconds << "\n";
+        }
+    }
+}
@@ -0,0 +1,294 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "./Random.h"
+#include "./Simulation.h"
+
+// Load generator for Game2048Main --serve: plays random moves in many
+// sessions over a few connections and reports the latency of the requests,
+// the throughput and the CPU time the server needed for them.
+
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+struct Client {
+    int fd;
+    // received bytes not yet parsed and requests not yet sent.
+    std::string in;
+    std::string out;
+    // sessions of the requests in flight and when they were sent, in order.
+    std::deque<std::pair<int, Clock::time_point>> pending;
+};
+
+struct Session {
+    uint64_t id;
+    int client;
+    bool waiting;
+    bool over;
+    Clock::time_point due;
+};
+
+void printUsageAndExit() {
+    std::cout << "Usage: ServerLoadMain --socket PATH [--connections C]"
+              << " [--sessions S] [--seconds T] [--rate R] [--seed S]\n"
+              << "--rate R: moves per second and session (default 0 = next"
+              << " move as soon as the reply is there)\n";
+    exit(1);
+}
+
+int connectTo(const std::string &path) {
+    struct sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+                sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Send all of data, blocking. Returns false on errors.
+bool sendAll(int fd, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent,
+                         MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+// Read the next line (blocking) into line. Returns false on errors.
+bool readLine(Client* client, std::string* line) {
+    char buffer[65536];
+    while (true) {
+        size_t newline = client->in.find('\n');
+        if (newline != std::string::npos) {
+            line->assign(client->in, 0, newline);
+            client->in.erase(0, newline + 1);
+            return true;
+        }
+        ssize_t n = read(client->fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        client->in.append(buffer, n);
+    }
+}
+
+// CPU ms of the server, from its reply to "stats" (-1 on errors).
+int64_t serverCpuMillis(Client* client) {
+    std::string line;
+    if (!sendAll(client->fd, "stats\n") || !readLine(client, &line)) return -1;
+    size_t blank = line.rfind(' ');
+    if (line.compare(0, 3, "ok ") != 0 || blank == std::string::npos) {
+        return -1;
+    }
+    return strtoll(line.c_str() + blank + 1, NULL, 10);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string path;
+    int numClients = 4;
+    int numSessions = 1000;
+    double seconds = 5;
+    double rate = 0;
+    uint64_t seed = 1;
+    struct option options[] = {
+            { "socket", 1, NULL, 'S'},
+            { "connections", 1, NULL, 'c'},
+            { "sessions", 1, NULL, 'n'},
+            { "seconds", 1, NULL, 't'},
+            { "rate", 1, NULL, 'r'},
+            { "seed", 1, NULL, 's'},
+            { "help", 0, NULL, 'h'},
+            { NULL, 0, NULL, 0 }
+    };
+    while (true) {
+        int c = getopt_long(argc, argv, "S:c:n:t:r:s:h", options, NULL);
+        if (c == -1) break;
+        switch (c) {
+            case 'S': path = optarg; break;
+            case 'c': numClients = atoi(optarg); break;
+            case 'n': numSessions = atoi(optarg); break;
+            case 't': seconds = atof(optarg); break;
+            case 'r': rate = atof(optarg); break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            default: printUsageAndExit();
+        }
+    }
+    if (path.empty() || numClients < 1 || numSessions < 1) {
+        printUsageAndExit();
+    }
+    if (numClients > numSessions) numClients = numSessions;
+
+    // connect and start all sessions, one request after the other.
+    std::vector<Client> clients(numClients);
+    for (auto& client : clients) {
+        client.fd = connectTo(path);
+        if (client.fd < 0) {
+            std::cerr << "Cannot connect to " << path << std::endl;
+            return 1;
+        }
+    }
+    std::vector<Session> sessions(numSessions);
+    for (int s = 0; s < numSessions; s++) {
+        Session& session = sessions[s];
+        session.client = s % numClients;
+        session.waiting = false;
+        session.over = false;
+        Client& client = clients[session.client];
+        std::string line;
+        if (!sendAll(client.fd, "new " + std::to_string(seed + s) + "\n") ||
+            !readLine(&client, &line) || line.compare(0, 3, "ok ") != 0) {
+            std::cerr << "Cannot start session " << s << std::endl;
+            return 1;
+        }
+        session.id = strtoull(line.c_str() + 3, NULL, 10);
+    }
+    int64_t cpuBefore = serverCpuMillis(&clients[0]);
+
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    for (int c = 0; c < numClients; c++) {
+        fcntl(clients[c].fd, F_SETFL, O_NONBLOCK);
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = c;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, clients[c].fd, &event);
+    }
+
+    // latencies in microseconds, up to 1 s.
+    Histogram latency(1, 1000000);
+    int64_t errors = 0;
+    Xoshiro256 rng(seed);
+    auto start = Clock::now();
+    auto end = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(seconds));
+    auto interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(rate > 0 ? 1 / rate : 0));
+    // spread the first moves of the sessions over one interval.
+    for (int s = 0; s < numSessions; s++) {
+        sessions[s].due = start + interval * s / numSessions;
+    }
+    size_t inFlight = 0;
+    char buffer[65536];
+    struct epoll_event events[64];
+    while (true) {
+        auto now = Clock::now();
+        bool sending = now < end;
+        if (!sending && inFlight == 0) break;
+
+        // the next request of every session that is due: a move, or a new
+        // game once the last one is over.
+        if (sending) {
+            for (int s = 0; s < numSessions; s++) {
+                Session& session = sessions[s];
+                if (session.waiting || session.due > now) continue;
+                Client& client = clients[session.client];
+                client.out += session.over ? "reset " : "move ";
+                client.out += std::to_string(session.id);
+                if (!session.over) {
+                    client.out += ' ';
+                    client.out += "lrud"[rng.below(4)];
+                }
+                client.out += '\n';
+                client.pending.push_back(std::make_pair(s, now));
+                session.waiting = true;
+                session.due += interval;
+                if (session.due < now) session.due = now;
+                inFlight++;
+            }
+        }
+        for (auto& client : clients) {
+            while (!client.out.empty()) {
+                ssize_t n = send(client.fd, client.out.data(),
+                                 client.out.size(), MSG_NOSIGNAL);
+                if (n <= 0) break;
+                client.out.erase(0, n);
+            }
+        }
+
+        int timeout = rate > 0 ? 1 : 100;
+        int n = epoll_wait(epollFd, events, 64, timeout);
+        now = Clock::now();
+        for (int i = 0; i < n; i++) {
+            Client& client = clients[events[i].data.u32];
+            ssize_t got = read(client.fd, buffer, sizeof(buffer));
+            if (got == 0) {
+                std::cerr << "Server closed the connection" << std::endl;
+                return 1;
+            }
+            if (got < 0) continue;
+            client.in.append(buffer, got);
+            size_t begin = 0;
+            while (true) {
+                size_t newline = client.in.find('\n', begin);
+                if (newline == std::string::npos) break;
+                Session& session = sessions[client.pending.front().first];
+                latency.add(std::chrono::duration_cast<
+                        std::chrono::microseconds>(
+                                now - client.pending.front().second).count());
+                client.pending.pop_front();
+                inFlight--;
+                if (client.in.compare(begin, 3, "ok ") != 0) errors++;
+                session.over = client.in[newline - 1] == '1';
+                session.waiting = false;
+                begin = newline + 1;
+            }
+            client.in.erase(0, begin);
+        }
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+
+    for (auto& client : clients) fcntl(client.fd, F_SETFL, 0);
+    int64_t cpuAfter = serverCpuMillis(&clients[0]);
+    for (auto& client : clients) close(client.fd);
+    close(epollFd);
+
+    double wall = elapsed.count();
+    double cpu = (cpuAfter - cpuBefore) / 1000.0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "sessions:     " << numSessions << " on " << numClients
+              << " connections\n";
+    std::cout << "requests:     " << latency.count() << " in " << wall
+              << " s (" << latency.count() / wall << "/s), " << errors
+              << " errors\n";
+    std::cout << "latency:      p50 " << latency.percentile(0.5) << " us, p99 "
+              << latency.percentile(0.99) << " us, max " << latency.max()
+              << " us\n";
+    if (cpuBefore >= 0 && cpuAfter >= 0) {
+        double load = cpu / wall;
+        std::cout << "server CPU:   " << cpu << " s (" << 100 * load
+                  << " % of a core)\n";
+        if (cpu > 0) {
+            std::cout << std::setprecision(0) << "per core:     "
+                      << latency.count() / cpu << " requests/s";
+            // with a fixed rate, the sessions one core can keep up with.
+            if (rate > 0) std::cout << ", " << numSessions / load
+                                    << " sessions";
+            std::cout << "\n";
+        }
+    }
+}
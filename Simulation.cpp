@@ -0,0 +1,293 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./Expectimax.h"
+#include "./GameState.h"
+#include "./MonteCarlo.h"
+#include "./Simulation.h"
+#include "./Spawn.h"
+
+namespace {
+// pick uniformly among the legal moves.
+class RandomPolicy : public Policy {
+ public:
+    Direction choose(const Bitboard &board, SimulationRng &rng) {
+        int legal = MoveTables::summarize(board).legalMoves;
+        int n = __builtin_popcount(legal);
+        return static_cast<Direction>(nthSetBit(legal, rng.below(n)));
+    }
+};
+
+// pick the legal move scoring the most points, ties go to the move leaving
+// more empty fields.
+class GreedyPolicy : public Policy {
+ public:
+    Direction choose(const Bitboard &board, SimulationRng & /*rng*/) {
+        Direction best = LEFT;
+        int bestScore = -1;
+        int bestEmpty = -1;
+        for (int d = 0; d < 4; d++) {
+            Direction dir = static_cast<Direction>(d);
+            int score = 0;
+            Bitboard moved = MoveTables::move(board, dir, &score);
+            if (moved == board) continue;
+            int empty = moved.countEmpty();
+            if (score > bestScore ||
+                (score == bestScore && empty > bestEmpty)) {
+                best = dir;
+                bestScore = score;
+                bestEmpty = empty;
+            }
+        }
+        return best;
+    }
+};
+
+// keep the big tiles in the lower left corner: down, left, right, up.
+class CornerPolicy : public Policy {
+ public:
+    Direction choose(const Bitboard &board, SimulationRng & /*rng*/) {
+        const Direction order[4] = { DOWN, LEFT, RIGHT, UP };
+        int legal = MoveTables::summarize(board).legalMoves;
+        for (const auto& dir : order) {
+            if (legal & (1 << dir)) return dir;
+        }
+        return UP;
+    }
+};
+
+// play the move with the best expectimax value. Searches two moves deep,
+// the adaptive depth of the interactive AI is too slow for batch runs.
+class ExpectimaxPolicy : public Policy {
+ public:
+    ExpectimaxPolicy() : search(2) {}
+    Direction choose(const Bitboard &board, SimulationRng & /*rng*/) {
+        int move = search.bestMove(board);
+        return move < 0 ? UP : static_cast<Direction>(move);
+    }
+    int64_t nodes() const { return search.stats().nodes; }
+
+ private:
+    Expectimax search;
+};
+}  // namespace
+
+// ___________________________________________________________________________
+Histogram::Histogram(int64_t bucketWidth, int numBuckets)
+    : bucketWidth(bucketWidth), buckets(numBuckets, 0), total(0), sum(0),
+      maxValue(0) {
+}
+
+// ___________________________________________________________________________
+void Histogram::add(int64_t value) {
+    int64_t b = std::min<int64_t>(value / bucketWidth, buckets.size() - 1);
+    buckets[b]++;
+    total++;
+    sum += value;
+    if (total == 1 || value > maxValue) maxValue = value;
+}
+
+// ___________________________________________________________________________
+void Histogram::merge(const Histogram &other) {
+    for (size_t b = 0; b < buckets.size(); b++) buckets[b] += other.buckets[b];
+    if (other.total > 0 && (total == 0 || other.maxValue > maxValue)) {
+        maxValue = other.maxValue;
+    }
+    total += other.total;
+    sum += other.sum;
+}
+
+// ___________________________________________________________________________
+double Histogram::mean() const {
+    return total == 0 ? 0.0 : static_cast<double>(sum) / total;
+}
+
+// ___________________________________________________________________________
+int64_t Histogram::percentile(double p) const {
+    int64_t rank = static_cast<int64_t>(p * total);
+    int64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); b++) {
+        seen += buckets[b];
+        if (seen > rank) return b * bucketWidth;
+    }
+    return maxValue;
+}
+
+// ___________________________________________________________________________
+Policy* Policy::create(const std::string &name) {
+    if (name == "random") return new RandomPolicy();
+    if (name == "greedy") return new GreedyPolicy();
+    if (name == "corner") return new CornerPolicy();
+    if (name == "expectimax") return new ExpectimaxPolicy();
+    // one thread each, the simulation runs one policy per core already.
+    MonteCarlo::Rollout rollout;
+    if (MonteCarlo::parsePolicy(name, &rollout)) {
+        return new MonteCarloPolicy(kRolloutMs, 1, rollout);
+    }
+    return NULL;
+}
+
+// ___________________________________________________________________________
+const std::vector<std::string>& Policy::names() {
+    static const std::vector<std::string> names {
+        "random", "greedy", "corner", "expectimax", "montecarlo",
+        "montecarlo-greedy"
+    };
+    return names;
+}
+
+// ___________________________________________________________________________
+SimulationStats::SimulationStats()
+    : games(0), scores(64, 1 << 16), stepsTo2048(1, 1 << 14), nodes(0),
+      rollouts(0), seconds(0) {
+    for (int i = 0; i < 16; i++) maxTiles[i] = 0;
+}
+
+// ___________________________________________________________________________
+void SimulationStats::add(const GameResult &result) {
+    games++;
+    scores.add(result.score);
+    maxTiles[result.maxExponent]++;
+    if (result.stepsTo2048 >= 0) stepsTo2048.add(result.stepsTo2048);
+}
+
+// ___________________________________________________________________________
+void SimulationStats::merge(const SimulationStats &other) {
+    games += other.games;
+    scores.merge(other.scores);
+    stepsTo2048.merge(other.stepsTo2048);
+    for (int i = 0; i < 16; i++) maxTiles[i] += other.maxTiles[i];
+    nodes += other.nodes;
+    rollouts += other.rollouts;
+}
+
+// ___________________________________________________________________________
+Simulation::Simulation(const std::string &policy, uint64_t seed)
+    : makePolicy([policy] { return Policy::create(policy); }), seed(seed) {
+}
+
+// ___________________________________________________________________________
+Simulation::Simulation(std::function<Policy*()> makePolicy, uint64_t seed)
+    : makePolicy(makePolicy), seed(seed) {
+}
+
+// ___________________________________________________________________________
+uint64_t Simulation::gameSeed(uint64_t seed, uint64_t gameIndex) {
+    // mix seed and game index into a well distributed 64 bit seed.
+    uint64_t state = seed + gameIndex * 0x9E3779B97F4A7C15ULL;
+    return splitmix64(state);
+}
+
+// ___________________________________________________________________________
+GameResult Simulation::playGame(uint64_t gameIndex, Policy* policy,
+        SimulationRng &rng) const {
+    rng.seed(gameSeed(seed, gameIndex));
+    GameResult result = { 0, 0, 0, -1 };
+
+    GameState state = GameState::start(rng);
+    while (!state.gameOver) {
+        if (result.stepsTo2048 < 0 && state.gameWon) {
+            result.stepsTo2048 = state.steps;
+        }
+        GameState next = GameState::play(
+                state, policy->choose(state.board, rng), rng);
+        if (next.board == state.board) break;  // the policy has given up.
+        state = next;
+    }
+    if (result.stepsTo2048 < 0 && state.gameWon) {
+        result.stepsTo2048 = state.steps;
+    }
+    // tiles never shrink, so the last board has the largest one.
+    result.score = state.points;
+    result.steps = state.steps;
+    result.maxExponent = MoveTables::summarize(state.board).maxExponent;
+    return result;
+}
+
+// ___________________________________________________________________________
+void Simulation::runShard(int64_t first, int64_t last,
+        SimulationStats* stats) const {
+    std::unique_ptr<Policy> policy(makePolicy());
+    if (!policy) return;
+    SimulationRng rng;
+    for (int64_t g = first; g < last; g++) {
+        stats->add(playGame(g, policy.get(), rng));
+    }
+    stats->nodes = policy->nodes();
+    stats->rollouts = policy->rollouts();
+}
+
+// ___________________________________________________________________________
+SimulationStats Simulation::run(int64_t numGames, int numThreads) const {
+    if (numThreads <= 0) numThreads = std::thread::hardware_concurrency();
+    if (numThreads <= 0) numThreads = 1;
+    auto start = std::chrono::steady_clock::now();
+
+    // every thread plays a contiguous range of games into its own stats.
+    std::vector<SimulationStats> shards(numThreads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < numThreads; t++) {
+        int64_t first = numGames * t / numThreads;
+        int64_t last = numGames * (t + 1) / numThreads;
+        workers.push_back(std::thread(&Simulation::runShard, this, first,
+                                      last, &shards[t]));
+    }
+    SimulationStats total;
+    for (int t = 0; t < numThreads; t++) {
+        workers[t].join();
+        total.merge(shards[t]);
+    }
+
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    total.seconds = elapsed.count();
+    return total;
+}
+
+// ___________________________________________________________________________
+void Simulation::printReport(const SimulationStats &stats,
+        std::ostream &out) {
+    out << std::fixed << std::setprecision(1);
+    out << "games:        " << stats.games << "\n";
+    out << "time:         " << stats.seconds << " s ("
+        << (stats.seconds > 0 ? stats.games / stats.seconds : 0)
+        << " games/s)\n";
+    out << "score:        mean " << stats.scores.mean()
+        << ", p50 " << stats.scores.percentile(0.5)
+        << ", p90 " << stats.scores.percentile(0.9)
+        << ", p99 " << stats.scores.percentile(0.99)
+        << ", max " << stats.scores.max() << "\n";
+    if (stats.nodes > 0) {
+        out << "search:       " << stats.nodes << " nodes ("
+            << (stats.seconds > 0 ? stats.nodes / stats.seconds : 0)
+            << " nodes/s)\n";
+    }
+    if (stats.rollouts > 0) {
+        out << "rollouts:     " << stats.rollouts << " ("
+            << (stats.seconds > 0 ? stats.rollouts / stats.seconds : 0)
+            << " rollouts/s)\n";
+    }
+    out << "max tile:\n";
+    for (int i = 0; i < 16; i++) {
+        if (stats.maxTiles[i] == 0) continue;
+        out << "  " << std::setw(6) << (1 << i) << ": " << std::setw(5)
+            << 100.0 * stats.maxTiles[i] / stats.games << " %\n";
+    }
+    out << "reached 2048: "
+        << (stats.games > 0 ? 100.0 * stats.stepsTo2048.count() / stats.games
+                            : 0)
+        << " %";
+    if (stats.stepsTo2048.count() > 0) {
+        out << " (steps mean " << stats.stepsTo2048.mean()
+            << ", p50 " << stats.stepsTo2048.percentile(0.5)
+            << ", p90 " << stats.stepsTo2048.percentile(0.9) << ")";
+    }
+    out << "\n";
+}
@@ -0,0 +1,134 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef SIMULATION_H_
+#define SIMULATION_H_
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "./Bitboard.h"
+#include "./MoveTables.h"
+#include "./Random.h"
+
+// Random number generator used by the headless engine. Every worker thread
+// owns one and reseeds it for each game, so there is no shared state.
+typedef Xoshiro256 SimulationRng;
+
+// Histogram with fixed-width buckets. Values beyond the last bucket are
+// counted in the last bucket, but sum and max stay exact.
+class Histogram {
+ public:
+    Histogram(int64_t bucketWidth, int numBuckets);
+
+    void add(int64_t value);
+
+    // Add all counts of another histogram with the same layout.
+    void merge(const Histogram &other);
+
+    int64_t count() const { return total; }
+    int64_t max() const { return maxValue; }
+    double mean() const;
+
+    // Lower bound of the bucket containing the p-th percentile (0 <= p <= 1).
+    int64_t percentile(double p) const;
+
+ private:
+    int64_t bucketWidth;
+    std::vector<int64_t> buckets;
+    int64_t total;
+    int64_t sum;
+    int64_t maxValue;
+};
+
+// Strategy choosing the next move of a headless game.
+class Policy {
+ public:
+    virtual ~Policy() {}
+
+    // Pick a move for the board. Only called if at least one move is legal,
+    // and should return a legal one.
+    virtual Direction choose(const Bitboard &board, SimulationRng &rng) = 0;
+
+    // Number of search nodes visited so far (0 for policies not searching).
+    virtual int64_t nodes() const { return 0; }
+
+    // Number of rollouts played so far (0 for policies not rolling out).
+    virtual int64_t rollouts() const { return 0; }
+
+    // Create a new policy by name ("random", "greedy", "corner",
+    // "expectimax", "montecarlo" or "montecarlo-greedy", the last two with
+    // kRolloutMs per move). Returns
+    // NULL for unknown names. The caller owns the returned object.
+    static Policy* create(const std::string &name);
+
+    // Names accepted by create().
+    static const std::vector<std::string>& names();
+
+    // Default time per move of the Monte Carlo policies.
+    static constexpr double kRolloutMs = 5;
+};
+
+// Outcome of a single headless game.
+struct GameResult {
+    int score;
+    int steps;
+    int maxExponent;
+    // step at which 2048 was reached first, -1 if it never was.
+    int stepsTo2048;
+};
+
+// Aggregated outcome of many games.
+struct SimulationStats {
+    SimulationStats();
+    void add(const GameResult &result);
+    void merge(const SimulationStats &other);
+
+    int64_t games;
+    Histogram scores;
+    Histogram stepsTo2048;
+    // number of games that ended with 2^i as their largest tile.
+    int64_t maxTiles[16];
+    // search nodes visited and rollouts played by the policies.
+    int64_t nodes;
+    int64_t rollouts;
+    // wall clock time of the run.
+    double seconds;
+};
+
+// Headless batch simulation: plays games without any Board or ncurses and
+// shards them across worker threads.
+class Simulation {
+ public:
+    // Games are seeded from (seed, game index), so the results only depend
+    // on the seed and not on the number of threads.
+    Simulation(const std::string &policy, uint64_t seed);
+
+    // The same with policies made by a factory (one per thread, owned by
+    // the simulation), e.g. for policies that need more than a name.
+    Simulation(std::function<Policy*()> makePolicy, uint64_t seed);
+
+    // Seed of game gameIndex of a run with the given seed.
+    static uint64_t gameSeed(uint64_t seed, uint64_t gameIndex);
+
+    // Play a single game with the given policy and generator.
+    GameResult playGame(uint64_t gameIndex, Policy* policy,
+            SimulationRng &rng) const;
+
+    // Play numGames games on numThreads threads (0 = one per core).
+    SimulationStats run(int64_t numGames, int numThreads) const;
+
+    // Print a human readable summary of stats.
+    static void printReport(const SimulationStats &stats, std::ostream &out);
+
+ private:
+    std::function<Policy*()> makePolicy;
+    uint64_t seed;
+
+    // Play games [first, last) into stats.
+    void runShard(int64_t first, int64_t last, SimulationStats* stats) const;
+};
+
+#endif  // SIMULATION_H_
@@ -0,0 +1,61 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include "./Simulation.h"
+
+// ____________________________________________________________________________
+TEST(SimulationTest, histogram) {
+    Histogram histogram(10, 5);
+    for (int i = 0; i < 100; i++) histogram.add(i);
+    ASSERT_EQ(100, histogram.count());
+    ASSERT_EQ(99, histogram.max());
+    ASSERT_DOUBLE_EQ(49.5, histogram.mean());
+    ASSERT_EQ(0, histogram.percentile(0.05));
+    ASSERT_EQ(20, histogram.percentile(0.25));
+    // everything >= 40 lands in the last bucket.
+    ASSERT_EQ(40, histogram.percentile(0.9));
+
+    Histogram other(10, 5);
+    other.add(1000);
+    histogram.merge(other);
+    ASSERT_EQ(101, histogram.count());
+    ASSERT_EQ(1000, histogram.max());
+}
+
+// ____________________________________________________________________________
+TEST(SimulationTest, policies) {
+    for (const auto& name : Policy::names()) {
+        std::unique_ptr<Policy> policy(Policy::create(name));
+        ASSERT_TRUE(policy != NULL);
+        // searching policies are tested on their own, a whole game is slow.
+        if (name == "expectimax" || name.compare(0, 10, "montecarlo") == 0) {
+            continue;
+        }
+        Simulation simulation(name, 1);
+        SimulationRng rng;
+        GameResult result = simulation.playGame(0, policy.get(), rng);
+        ASSERT_GT(result.steps, 0);
+        ASSERT_GT(result.score, 0);
+        ASSERT_GE(result.maxExponent, 3);
+    }
+    ASSERT_TRUE(Policy::create("nonsense") == NULL);
+}
+
+// ____________________________________________________________________________
+TEST(SimulationTest, deterministic) {
+    // the same seed gives the same games, no matter how many threads.
+    Simulation simulation("greedy", 42);
+    SimulationStats one = simulation.run(40, 1);
+    SimulationStats four = simulation.run(40, 4);
+    ASSERT_EQ(40, one.games);
+    ASSERT_EQ(40, four.games);
+    ASSERT_DOUBLE_EQ(one.scores.mean(), four.scores.mean());
+    ASSERT_EQ(one.scores.max(), four.scores.max());
+    for (int i = 0; i < 16; i++) ASSERT_EQ(one.maxTiles[i], four.maxTiles[i]);
+
+    Simulation other("greedy", 43);
+    ASSERT_NE(one.scores.mean(), other.run(40, 1).scores.mean());
+}
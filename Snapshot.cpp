@@ -0,0 +1,241 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "./Snapshot.h"
+
+namespace {
+const char kMagic[4] = { 'G', '4', '8', 'S' };
+
+// Offsets of the header fields.
+const size_t kVersionAt = 4;
+const size_t kSizeAt = 8;
+const size_t kChecksumAt = 12;
+const size_t kSeedAt = 16;
+const size_t kRngAt = 24;
+const size_t kPointsAt = 56;
+const size_t kStepsAt = 60;
+const size_t kUndoCountAt = 64;
+const size_t kLastMoveAt = 68;
+const size_t kCountAt = 72;
+const size_t kGameOverAt = 76;
+const size_t kGameWonAt = 77;
+
+template <typename T>
+void put(char* bytes, size_t at, T value) {
+    std::memcpy(bytes + at, &value, sizeof(value));
+}
+
+template <typename T>
+T get(const char* bytes, size_t at) {
+    T value;
+    std::memcpy(&value, bytes + at, sizeof(value));
+    return value;
+}
+
+// FNV-1a of the bytes, with the checksum field counted as 0.
+uint32_t checksum(const char* bytes, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        bool field = i >= kChecksumAt && i < kChecksumAt + 4;
+        hash ^= field ? 0 : static_cast<uint8_t>(bytes[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+}  // namespace
+
+const uint32_t Snapshot::kVersion;
+const size_t Snapshot::kHeaderSize;
+const size_t Snapshot::kStateSize;
+
+// ___________________________________________________________________________
+void Snapshot::encode(const Game &game, std::string* bytes) {
+    uint32_t count = game.states.size();
+    size_t size = kHeaderSize + count * kStateSize;
+    // keeps the memory of the last snapshot.
+    bytes->assign(size, '\0');
+    char* out = &(*bytes)[0];
+    std::memcpy(out, kMagic, 4);
+    put<uint32_t>(out, kVersionAt, kVersion);
+    put<uint32_t>(out, kSizeAt, size);
+    put<uint64_t>(out, kSeedAt, game.seed);
+    for (int i = 0; i < 4; i++) {
+        put<uint64_t>(out, kRngAt + 8 * i, game.rng.s[i]);
+    }
+    put<int32_t>(out, kPointsAt, game.points);
+    put<int32_t>(out, kStepsAt, game.steps);
+    put<int32_t>(out, kUndoCountAt, game.undoCount);
+    put<int32_t>(out, kLastMoveAt, game.lastMove);
+    put<uint32_t>(out, kCountAt, count);
+    out[kGameOverAt] = game.gameOver;
+    out[kGameWonAt] = game.gameWon;
+    for (uint32_t i = 0; i < count; i++) {
+        char* state = out + kHeaderSize + i * kStateSize;
+        put<uint64_t>(state, 0, game.states[i].bits);
+        put<int32_t>(state, 8, game.states.scoreDelta(i));
+    }
+    put<uint32_t>(out, kChecksumAt, checksum(out, size));
+}
+
+// ___________________________________________________________________________
+bool Snapshot::decode(const char* bytes, size_t size, Game* game) {
+    if (size < kHeaderSize || std::memcmp(bytes, kMagic, 4) != 0 ||
+        get<uint32_t>(bytes, kVersionAt) != kVersion ||
+        get<uint32_t>(bytes, kSizeAt) != size ||
+        get<uint32_t>(bytes, kChecksumAt) != checksum(bytes, size)) {
+        return false;
+    }
+    uint32_t count = get<uint32_t>(bytes, kCountAt);
+    int32_t points = get<int32_t>(bytes, kPointsAt);
+    int32_t steps = get<int32_t>(bytes, kStepsAt);
+    int32_t undoCount = get<int32_t>(bytes, kUndoCountAt);
+    int32_t lastMove = get<int32_t>(bytes, kLastMoveAt);
+    if (count < 1 || size != kHeaderSize + count * kStateSize ||
+        points < 0 || steps < 0 || undoCount < 0 || lastMove < -1 ||
+        lastMove > DOWN) {
+        return false;
+    }
+
+    game->seed = get<uint64_t>(bytes, kSeedAt);
+    for (int i = 0; i < 4; i++) {
+        game->rng.s[i] = get<uint64_t>(bytes, kRngAt + 8 * i);
+    }
+    game->points = points;
+    game->steps = steps;
+    game->undoCount = undoCount;
+    game->lastMove = lastMove;
+    game->gameOver = bytes[kGameOverAt] != 0;
+    game->gameWon = bytes[kGameWonAt] != 0;
+    game->hint = -1;
+    game->run = true;
+    // with a smaller undo limit, the oldest states are dropped.
+    game->states.setCapacity(game->maxUndo + 1);
+    for (uint32_t i = 0; i < count; i++) {
+        const char* state = bytes + kHeaderSize + i * kStateSize;
+        Bitboard board(get<uint64_t>(state, 0));
+        if (i == 0) {
+            game->states.clear(board);
+        } else {
+            game->states.push(board, get<int32_t>(state, 8));
+        }
+    }
+    return true;
+}
+
+// ___________________________________________________________________________
+int Snapshot::load(const std::string &path, Game* game) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        static_cast<size_t>(info.st_size) < kHeaderSize) {
+        close(fd);
+        return -1;
+    }
+    size_t size = info.st_size;
+    void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return -1;
+    bool valid = decode(static_cast<const char*>(mapped), size, game);
+    munmap(mapped, size);
+    return valid ? 1 : -1;
+}
+
+// ___________________________________________________________________________
+bool Snapshot::write(const std::string &path, const std::string &bytes) {
+    std::string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = ::write(fd, bytes.data() + written,
+                            bytes.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += n;
+    }
+    // on disk before the name points to it.
+    bool ok = written == bytes.size() && fdatasync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ___________________________________________________________________________
+SnapshotWriter::SnapshotWriter(const std::string &path)
+    : path(path), hasPending(false), busy(false), failed(false),
+      stopping(false), writtenCount(0) {
+    thread = std::thread(&SnapshotWriter::loop, this);
+}
+
+// ___________________________________________________________________________
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+// ___________________________________________________________________________
+void SnapshotWriter::save(const Game &game) {
+    Snapshot::encode(game, &encoded);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // an older snapshot not yet written is replaced, and its memory
+        // is used for the next one.
+        pending.swap(encoded);
+        hasPending = true;
+    }
+    wake.notify_one();
+}
+
+// ___________________________________________________________________________
+bool SnapshotWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return !hasPending && !busy; });
+    bool ok = !failed;
+    failed = false;
+    return ok;
+}
+
+// ___________________________________________________________________________
+int64_t SnapshotWriter::written() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return writtenCount;
+}
+
+// ___________________________________________________________________________
+void SnapshotWriter::loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return hasPending || stopping; });
+        // the last snapshot is written before stopping.
+        if (!hasPending) break;
+        writing.swap(pending);
+        hasPending = false;
+        busy = true;
+        lock.unlock();
+        bool ok = Snapshot::write(path, writing);
+        lock.lock();
+        busy = false;
+        if (ok) {
+            writtenCount++;
+        } else {
+            failed = true;
+        }
+        done.notify_all();
+    }
+}
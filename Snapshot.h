@@ -0,0 +1,92 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "./Game2048.h"
+
+// A game in progress as a file of fixed layout, so a restarted process
+// continues exactly where the last one stopped (--snapshot): the undo
+// window with the points of every move, score, steps, undos used, the
+// state of the random number generator, seed and flags. Resuming maps the
+// file and copies it into the game; no move is replayed.
+//
+// Layout (little endian, as the host writes it): a 96 byte header
+//
+//   0  "G48S"  4  version  8  file size  12  checksum (FNV-1a of the file
+//   with these 4 bytes 0)  16  seed  24  generator state (4 x 8 bytes)
+//   56  points  60  steps  64  undos used  68  last move  72  states in
+//   the undo window  76  game over  77  game won  78  (0)
+//
+// followed by the states of the undo window, oldest first, 16 bytes each:
+// the Bitboard and the points its move scored (and 4 bytes 0).
+class Snapshot {
+ public:
+    static const uint32_t kVersion = 1;
+    static const size_t kHeaderSize = 96;
+    static const size_t kStateSize = 16;
+
+    // Replace bytes with the snapshot of game.
+    static void encode(const Game &game, std::string* bytes);
+
+    // Restore game from a snapshot (keeping its options, e.g. the undo
+    // limit). Returns false, leaving game as it was, if the bytes are no
+    // snapshot of this version or are damaged.
+    static bool decode(const char* bytes, size_t size, Game* game);
+
+    // Restore game from the snapshot file at path. Returns 1 if it was
+    // resumed, 0 if there is no such file and -1 if it is no valid
+    // snapshot.
+    static int load(const std::string &path, Game* game);
+
+    // Write bytes to path atomically: to a new file that is synced and
+    // then renamed, so a crash leaves either the old or the new snapshot.
+    // Returns false if that fails.
+    static bool write(const std::string &path, const std::string &bytes);
+};
+
+// Writes the snapshots of a game to a file from a thread of its own, so
+// a move only pays for encoding (no allocation once warm) and a handover.
+// If moves come faster than the disk, only the newest snapshot is
+// written. The last one is written before the writer is destroyed.
+class SnapshotWriter {
+ public:
+    explicit SnapshotWriter(const std::string &path);
+    ~SnapshotWriter();
+
+    // Take a snapshot of game to be written soon. Returns at once.
+    void save(const Game &game);
+
+    // Wait until all snapshots taken so far are written. Returns false if
+    // a write failed since the last call.
+    bool flush();
+
+    // Snapshots written so far.
+    int64_t written();
+
+ private:
+    void loop();
+
+    std::string path;
+    // encoded by save(), waiting to be written, being written.
+    std::string encoded;
+    std::string pending;
+    std::string writing;
+    bool hasPending;
+    bool busy;
+    bool failed;
+    bool stopping;
+    int64_t writtenCount;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::thread thread;
+};
+
+#endif  // SNAPSHOT_H_
@@ -0,0 +1,147 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <ncurses.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+#include "./Snapshot.h"
+
+namespace {
+// A fresh path for a snapshot file (that does not exist yet).
+std::string snapshotPath() {
+    char path[] = "/tmp/SnapshotTest.XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    unlink(path);
+    return path;
+}
+
+// A game with some moves and an undo behind it.
+void playSome(Game* game) {
+    game->maxUndo = 3;
+    game->restart(11);
+    const int keys[] = { KEY_LEFT, KEY_UP, KEY_RIGHT, KEY_DOWN, KEY_LEFT,
+                         KEY_UP, 'u' };
+    for (int key : keys) game->play(key);
+}
+
+// The states of the undo window and the points of their moves.
+std::string window(const Game &game) {
+    std::string text;
+    for (size_t i = 0; i < game.states.size(); i++) {
+        text += std::to_string(game.states[i].bits) + "/" +
+                std::to_string(game.states.scoreDelta(i)) + " ";
+    }
+    return text;
+}
+}  // namespace
+
+// ____________________________________________________________________________
+TEST(SnapshotTest, encode) {
+    Game game;
+    playSome(&game);
+    std::string bytes;
+    Snapshot::encode(game, &bytes);
+    ASSERT_EQ(Snapshot::kHeaderSize +
+              game.states.size() * Snapshot::kStateSize, bytes.size());
+    ASSERT_EQ("G48S", bytes.substr(0, 4));
+
+    Game resumed;
+    resumed.maxUndo = 3;
+    ASSERT_TRUE(Snapshot::decode(bytes.data(), bytes.size(), &resumed));
+    ASSERT_EQ(game.current(), resumed.current());
+    ASSERT_EQ(game.seed, resumed.seed);
+    ASSERT_EQ(game.lastMove, resumed.lastMove);
+    ASSERT_EQ(window(game), window(resumed));
+
+    // the game goes on as if it had never stopped: the same tiles spawn,
+    // and two of the three undos are left.
+    const int keys[] = { KEY_DOWN, KEY_RIGHT, 'u', 'u', 'u', KEY_UP };
+    for (int key : keys) {
+        game.play(key);
+        resumed.play(key);
+        ASSERT_EQ(game.current(), resumed.current());
+    }
+    ASSERT_EQ(window(game), window(resumed));
+}
+
+// ____________________________________________________________________________
+TEST(SnapshotTest, invalid) {
+    Game game;
+    playSome(&game);
+    std::string bytes;
+    Snapshot::encode(game, &bytes);
+    Game other;
+    other.restart(5);
+    GameState before = other.current();
+
+    // a damaged byte anywhere, a cut, another version.
+    for (size_t i = 0; i < bytes.size(); i++) {
+        std::string damaged = bytes;
+        damaged[i] ^= 0x10;
+        ASSERT_FALSE(Snapshot::decode(damaged.data(), damaged.size(),
+                                      &other));
+    }
+    ASSERT_FALSE(Snapshot::decode(bytes.data(), bytes.size() - 16, &other));
+    ASSERT_FALSE(Snapshot::decode(bytes.data(), 10, &other));
+    std::string newer = bytes;
+    newer[4] = 2;
+    ASSERT_FALSE(Snapshot::decode(newer.data(), newer.size(), &other));
+    ASSERT_EQ(before, other.current());
+
+    // a smaller undo limit keeps the newest states.
+    other.maxUndo = 0;
+    ASSERT_TRUE(Snapshot::decode(bytes.data(), bytes.size(), &other));
+    ASSERT_EQ(1u, other.states.size());
+    ASSERT_EQ(game.current(), other.current());
+}
+
+// ____________________________________________________________________________
+TEST(SnapshotTest, file) {
+    std::string path = snapshotPath();
+    Game game;
+    ASSERT_EQ(0, Snapshot::load(path, &game));
+    playSome(&game);
+    std::string bytes;
+    Snapshot::encode(game, &bytes);
+    ASSERT_TRUE(Snapshot::write(path, bytes));
+    ASSERT_NE(0, access((path + ".tmp").c_str(), F_OK));
+
+    Game resumed;
+    resumed.maxUndo = 3;
+    ASSERT_EQ(1, Snapshot::load(path, &resumed));
+    ASSERT_EQ(game.current(), resumed.current());
+
+    ASSERT_TRUE(Snapshot::write(path, "not a snapshot"));
+    ASSERT_EQ(-1, Snapshot::load(path, &resumed));
+    ASSERT_FALSE(Snapshot::write("/nonexistent/snapshot", bytes));
+    unlink(path.c_str());
+}
+
+// ____________________________________________________________________________
+TEST(SnapshotTest, writer) {
+    std::string path = snapshotPath();
+    Game game;
+    game.restart(2);
+    {
+        SnapshotWriter writer(path);
+        for (int i = 0; i < 200 && !game.gameOver; i++) {
+            game.play(i % 2 ? KEY_LEFT : KEY_DOWN);
+            writer.save(game);
+        }
+        ASSERT_TRUE(writer.flush());
+        ASSERT_GE(writer.written(), 1);
+        Game resumed;
+        ASSERT_EQ(1, Snapshot::load(path, &resumed));
+        ASSERT_EQ(game.current(), resumed.current());
+        // the last snapshot is written when the writer goes.
+        game.play('n');
+        writer.save(game);
+    }
+    Game resumed;
+    ASSERT_EQ(1, Snapshot::load(path, &resumed));
+    ASSERT_EQ(game.current(), resumed.current());
+    unlink(path.c_str());
+}
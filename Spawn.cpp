@@ -0,0 +1,38 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include "./Spawn.h"
+
+namespace {
+// selectInByte[b][n] is the position of the n-th set bit of byte b.
+struct SelectTable {
+    SelectTable() {
+        for (int b = 0; b < 256; b++) {
+            int n = 0;
+            for (int i = 0; i < 8; i++) {
+                if (b & (1 << i)) selectInByte[b][n++] = i;
+            }
+        }
+    }
+    uint8_t selectInByte[256][8];
+};
+const SelectTable table;
+}  // namespace
+
+// ___________________________________________________________________________
+int nthSetBit(uint16_t mask, int n) {
+    int low = mask & 0xFF;
+    int lowCount = __builtin_popcount(low);
+    if (n < lowCount) return table.selectInByte[low][n];
+    return 8 + table.selectInByte[mask >> 8][n - lowCount];
+}
+
+// ___________________________________________________________________________
+int spawnTile(Bitboard &board, Xoshiro256 &rng) {
+    uint16_t empty = board.emptyMask();
+    if (empty == 0) return -1;
+    int field = nthSetBit(empty, rng.below(__builtin_popcount(empty)));
+    // 4 has 10% prob, 2 has 90% prob.
+    board.setExponent(field, rng.below(10) == 0 ? 2 : 1);
+    return field;
+}
@@ -0,0 +1,22 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef SPAWN_H_
+#define SPAWN_H_
+
+#include <cstdint>
+#include "./Bitboard.h"
+#include "./Random.h"
+
+// Index of the n-th (counting from 0) set bit of a 16 bit mask. n must be
+// smaller than the number of set bits. Constant time: one popcount and a
+// lookup in a 256 x 8 table of byte positions.
+int nthSetBit(uint16_t mask, int n);
+
+// Put a new tile on the board: the field is chosen uniformly among the
+// empty fields, the tile is a 2 with probability 90% and a 4 with 10%.
+// Draws exactly two random numbers (field, then value) and returns the
+// field, or -1 (drawing nothing) if the board is full.
+int spawnTile(Bitboard &board, Xoshiro256 &rng);
+
+#endif  // SPAWN_H_
@@ -0,0 +1,74 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include "./Spawn.h"
+
+// ____________________________________________________________________________
+TEST(SpawnTest, emptyMask) {
+    Xoshiro256 rng(3);
+    for (int t = 0; t < 10000; t++) {
+        Bitboard board(rng());
+        uint16_t expected = 0;
+        for (int i = 0; i < 16; i++) {
+            if (board.exponent(i) == 0) expected |= 1 << i;
+        }
+        ASSERT_EQ(expected, board.emptyMask());
+    }
+    ASSERT_EQ(0xFFFF, Bitboard().emptyMask());
+    ASSERT_EQ(16, Bitboard().countEmpty());
+}
+
+// ____________________________________________________________________________
+TEST(SpawnTest, nthSetBit) {
+    for (int mask = 1; mask < 65536; mask++) {
+        int n = 0;
+        for (int i = 0; i < 16; i++) {
+            if (mask & (1 << i)) {
+                ASSERT_EQ(i, nthSetBit(mask, n++));
+            }
+        }
+    }
+}
+
+// ____________________________________________________________________________
+TEST(SpawnTest, distribution) {
+    // five empty fields: 0, 3, 6, 9, 15.
+    Bitboard full;
+    for (int i = 0; i < 16; i++) full.setExponent(i, 1 + i % 3);
+    const int empty[5] = { 0, 3, 6, 9, 15 };
+    for (const auto& f : empty) full.setExponent(f, 0);
+
+    Xoshiro256 rng(2048);
+    const int n = 200000;
+    int fields[16] = { 0 };
+    int fours = 0;
+    for (int t = 0; t < n; t++) {
+        Bitboard board = full;
+        int field = spawnTile(board, rng);
+        ASSERT_EQ(0, full.exponent(field));
+        ASSERT_EQ(board.bits, full.bits | uint64_t(board.exponent(field))
+                                          << (4 * field));
+        fields[field]++;
+        if (board[field] == 4) fours++;
+    }
+
+    // Chi-square test against the uniform distribution on the empty fields.
+    // With 4 degrees of freedom, 18.47 is exceeded with probability 0.001.
+    double chi2 = 0;
+    for (const auto& f : empty) {
+        double expected = n / 5.0;
+        chi2 += (fields[f] - expected) * (fields[f] - expected) / expected;
+    }
+    ASSERT_LT(chi2, 18.47);
+
+    // 10% fours, within 4 standard deviations of the binomial distribution.
+    double sd = std::sqrt(n * 0.1 * 0.9);
+    ASSERT_LT(std::fabs(fours - n * 0.1), 4 * sd);
+
+    // nothing happens on a full board.
+    Bitboard board(0x1234123412341234ULL);
+    ASSERT_EQ(-1, spawnTile(board, rng));
+    ASSERT_EQ(0x1234123412341234ULL, board.bits);
+}
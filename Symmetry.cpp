@@ -0,0 +1,64 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include "./Symmetry.h"
+
+namespace {
+// the direction after mirroring columns, mirroring rows or transposing.
+const Direction kFlipColumns[4] = { RIGHT, LEFT, UP, DOWN };
+const Direction kFlipRows[4] = { LEFT, RIGHT, DOWN, UP };
+const Direction kTranspose[4] = { UP, DOWN, LEFT, RIGHT };
+}  // namespace
+
+// ___________________________________________________________________________
+Bitboard Symmetry::apply(const Bitboard &board, int t) {
+    uint64_t bits = board.bits;
+    if (t & 4) bits = MoveTables::transpose(bits);
+    if (t & 1) bits = flipColumns(bits);
+    if (t & 2) bits = flipRows(bits);
+    return Bitboard(bits);
+}
+
+// ___________________________________________________________________________
+Bitboard Symmetry::invert(const Bitboard &board, int t) {
+    uint64_t bits = board.bits;
+    if (t & 2) bits = flipRows(bits);
+    if (t & 1) bits = flipColumns(bits);
+    if (t & 4) bits = MoveTables::transpose(bits);
+    return Bitboard(bits);
+}
+
+// ___________________________________________________________________________
+Bitboard Symmetry::canonical(const Bitboard &board, int* transform) {
+    // the 8 candidates, computed with as few flips as possible.
+    uint64_t candidates[kCount];
+    candidates[0] = board.bits;
+    candidates[4] = MoveTables::transpose(board.bits);
+    for (int base = 0; base < kCount; base += 4) {
+        candidates[base + 1] = flipColumns(candidates[base]);
+        candidates[base + 2] = flipRows(candidates[base]);
+        candidates[base + 3] = flipRows(candidates[base + 1]);
+    }
+    int best = 0;
+    for (int t = 1; t < kCount; t++) {
+        if (candidates[t] < candidates[best]) best = t;
+    }
+    if (transform != NULL) *transform = best;
+    return Bitboard(candidates[best]);
+}
+
+// ___________________________________________________________________________
+Direction Symmetry::moveBack(Direction dir, int t) {
+    if (t & 2) dir = kFlipRows[dir];
+    if (t & 1) dir = kFlipColumns[dir];
+    if (t & 4) dir = kTranspose[dir];
+    return dir;
+}
+
+// ___________________________________________________________________________
+Direction Symmetry::moveForward(Direction dir, int t) {
+    if (t & 4) dir = kTranspose[dir];
+    if (t & 1) dir = kFlipColumns[dir];
+    if (t & 2) dir = kFlipRows[dir];
+    return dir;
+}
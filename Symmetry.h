@@ -0,0 +1,55 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#ifndef SYMMETRY_H_
+#define SYMMETRY_H_
+
+#include <cstdint>
+#include "./Bitboard.h"
+#include "./MoveTables.h"
+
+// The 8 symmetries of the board (rotations and reflections). A symmetry is
+// a number 0..7: first the board is transposed if bit 2 is set, then its
+// columns are mirrored if bit 0 is set and its rows if bit 1 is set. Moves
+// and merges commute with these, so boards in the same orbit have the same
+// value and a cache can store them under one canonical key.
+class Symmetry {
+ public:
+    static const int kCount = 8;
+
+    // Mirror the columns (field 4r+c <-> 4r+3-c).
+    static uint64_t flipColumns(uint64_t bits) {
+        bits = ((bits & 0x0F0F0F0F0F0F0F0FULL) << 4)
+             | ((bits >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+        return ((bits & 0x00FF00FF00FF00FFULL) << 8)
+             | ((bits >> 8) & 0x00FF00FF00FF00FFULL);
+    }
+
+    // Mirror the rows (field 4r+c <-> 4(3-r)+c).
+    static uint64_t flipRows(uint64_t bits) {
+        bits = ((bits & 0x0000FFFF0000FFFFULL) << 16)
+             | ((bits >> 16) & 0x0000FFFF0000FFFFULL);
+        return (bits << 32) | (bits >> 32);
+    }
+
+    // Apply symmetry t to the board.
+    static Bitboard apply(const Bitboard &board, int t);
+
+    // Undo symmetry t, i.e. invert(apply(board, t), t) == board.
+    static Bitboard invert(const Bitboard &board, int t);
+
+    // The smallest (as a number) board among the 8 symmetric ones. If
+    // transform is not NULL, it is set to the symmetry t with
+    // apply(board, t) == canonical(board).
+    static Bitboard canonical(const Bitboard &board, int* transform);
+
+    // The move on the original board that corresponds to making move dir
+    // on apply(board, t).
+    static Direction moveBack(Direction dir, int t);
+
+    // The move on apply(board, t) that corresponds to making move dir on
+    // the original board.
+    static Direction moveForward(Direction dir, int t);
+};
+
+#endif  // SYMMETRY_H_
@@ -0,0 +1,53 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "./BenchmarkPositions.h"
+#include "./Expectimax.h"
+#include "./Random.h"
+#include "./Symmetry.h"
+
+// Cost of canonicalizing a board, and its effect on an expectimax search
+// whose transposition table is keyed on canonical boards.
+
+namespace {
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+}  // namespace
+
+int main() {
+    const int n = 1 << 22;
+    std::vector<Bitboard> boards;
+    Xoshiro256 rng(1);
+    for (int i = 0; i < n; i++) boards.push_back(Bitboard(rng()));
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t checksum = 0;
+    for (const auto& board : boards) {
+        checksum ^= Symmetry::canonical(board, NULL).bits;
+    }
+    double seconds = secondsSince(start);
+    std::cout << std::fixed << std::setprecision(2)
+              << "canonical:  " << seconds * 1e9 / n << " ns/board"
+              << " (checksum " << std::hex << checksum << std::dec << ")\n";
+
+    std::cout << "search depth 3 on " << sizeof(kBenchmarkPositions) / 8
+              << " recorded positions:\n";
+    for (int canonical = 0; canonical < 2; canonical++) {
+        Expectimax search(3, canonical);
+        start = std::chrono::steady_clock::now();
+        for (const auto& bits : kBenchmarkPositions) {
+            search.bestMove(Bitboard(bits));
+        }
+        seconds = secondsSince(start);
+        std::cout << (canonical ? "  canonical keys: " : "  raw keys:       ")
+                  << std::setprecision(1) << seconds * 1000 << " ms, "
+                  << search.stats().nodes << " nodes\n";
+    }
+}
@@ -0,0 +1,86 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <gtest/gtest.h>
+#include <set>
+#include "./BenchmarkPositions.h"
+#include "./Expectimax.h"
+#include "./Random.h"
+#include "./Symmetry.h"
+
+// ____________________________________________________________________________
+TEST(SymmetryTest, apply) {
+    Bitboard board;
+    for (int i = 0; i < 16; i++) board.setExponent(i, i);
+    // all 8 symmetries are different and invert undoes them.
+    std::set<uint64_t> seen;
+    for (int t = 0; t < Symmetry::kCount; t++) {
+        Bitboard image = Symmetry::apply(board, t);
+        seen.insert(image.bits);
+        ASSERT_EQ(board, Symmetry::invert(image, t));
+    }
+    ASSERT_EQ(8u, seen.size());
+
+    // mirrored columns: field 4r+c <-> 4r+3-c.
+    Bitboard mirrored = Symmetry::apply(board, 1);
+    ASSERT_EQ(3, mirrored.exponent(0));
+    ASSERT_EQ(4, mirrored.exponent(7));
+    // mirrored rows: field 4r+c <-> 4(3-r)+c.
+    mirrored = Symmetry::apply(board, 2);
+    ASSERT_EQ(12, mirrored.exponent(0));
+    ASSERT_EQ(1, mirrored.exponent(13));
+}
+
+// ____________________________________________________________________________
+TEST(SymmetryTest, canonical) {
+    Xoshiro256 rng(8);
+    for (int i = 0; i < 1000; i++) {
+        Bitboard board(rng());
+        int t;
+        Bitboard canonical = Symmetry::canonical(board, &t);
+        ASSERT_EQ(canonical, Symmetry::apply(board, t));
+        // every symmetric board has the same canonical form.
+        for (int s = 0; s < Symmetry::kCount; s++) {
+            Bitboard image = Symmetry::apply(board, s);
+            ASSERT_EQ(canonical, Symmetry::canonical(image, NULL));
+            ASSERT_LE(canonical.bits, image.bits);
+        }
+    }
+}
+
+// ____________________________________________________________________________
+TEST(SymmetryTest, moves) {
+    Xoshiro256 rng(9);
+    for (int i = 0; i < 1000; i++) {
+        // random boards with some empty fields.
+        Bitboard board(rng() & rng());
+        for (int t = 0; t < Symmetry::kCount; t++) {
+            Bitboard image = Symmetry::apply(board, t);
+            for (int d = 0; d < 4; d++) {
+                Direction dir = static_cast<Direction>(d);
+                // moving the image and mapping back is moving the original.
+                Direction back = Symmetry::moveBack(dir, t);
+                ASSERT_EQ(MoveTables::move(board, back, NULL),
+                          Symmetry::invert(MoveTables::move(image, dir, NULL),
+                                           t));
+                ASSERT_EQ(dir, Symmetry::moveForward(back, t));
+            }
+        }
+    }
+}
+
+// ____________________________________________________________________________
+TEST(SymmetryTest, canonicalKeys) {
+    // the heuristic is symmetric, so canonical keys do not change values.
+    Bitboard board(kBenchmarkPositions[0]);
+    ASSERT_FLOAT_EQ(heuristicValue(board),
+                    heuristicValue(Symmetry::apply(board, 5)));
+    Expectimax plain(2);
+    Expectimax canonical(2, true);
+    for (int d = 0; d < 4; d++) {
+        Direction dir = static_cast<Direction>(d);
+        float expected = plain.scoreMove(board, dir);
+        ASSERT_NEAR(expected, canonical.scoreMove(board, dir),
+                    1e-3 * expected);
+    }
+}
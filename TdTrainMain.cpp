@@ -0,0 +1,82 @@
+// Copyright 2020, University of Freiburg,
+// Author: Leander Goldbach
+
+#include <getopt.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "./NTuple.h"
+#include "./Simulation.h"
+
+// Trains an n-tuple network by TD learning in self-play, or (with --play)
+// plays games headless with a trained network and prints the statistics.
+
+namespace {
+void printUsageAndExit() {
+    std::cout << "Usage: TdTrainMain [--games N] [--threads T] [--alpha A]"
+              << " [--weights FILE] [--seed S] [--report-every SEC]\n"
+              << "       TdTrainMain --play N --weights FILE [--depth D]"
+              << " [--threads T] [--seed S]\n";
+    exit(1);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+    int64_t games = 100000;
+    int threads = 0;
+    float alpha = 0.1;
+    std::string weightsPath;
+    uint64_t seed = 1;
+    double reportSeconds = 5;
+    int64_t playGames = 0;
+    int depth = 0;
+    struct option options[] = {
+            { "games", 1, NULL, 'g'},
+            { "threads", 1, NULL, 't'},
+            { "alpha", 1, NULL, 'a'},
+            { "weights", 1, NULL, 'w'},
+            { "seed", 1, NULL, 's'},
+            { "report-every", 1, NULL, 'r'},
+            { "play", 1, NULL, 'p'},
+            { "depth", 1, NULL, 'd'},
+            { "help", 0, NULL, 'h'},
+            { NULL, 0, NULL, 0 }
+    };
+    while (true) {
+        int c = getopt_long(argc, argv, "g:t:a:w:s:r:p:d:h", options, NULL);
+        if (c == -1) break;
+        switch (c) {
+            case 'g': games = atoll(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'a': alpha = atof(optarg); break;
+            case 'w': weightsPath = optarg; break;
+            case 's': seed = strtoull(optarg, NULL, 10); break;
+            case 'r': reportSeconds = atof(optarg); break;
+            case 'p': playGames = atoll(optarg); break;
+            case 'd': depth = atoi(optarg); break;
+            default: printUsageAndExit();
+        }
+    }
+    if (playGames > 0 && weightsPath.empty()) printUsageAndExit();
+
+    NTupleNetwork network;
+    if (!weightsPath.empty() && !network.open(weightsPath)) {
+        std::cerr << "Cannot open weights file " << weightsPath << "\n";
+        return 1;
+    }
+
+    if (playGames > 0) {
+        const NTupleNetwork* trained = &network;
+        Simulation simulation([trained, depth] {
+            return new NTuplePolicy(trained, depth);
+        }, seed);
+        Simulation::printReport(simulation.run(playGames, threads),
+                                std::cout);
+        return 0;
+    }
+
+    TdTrainer trainer(&network, alpha, seed);
+    SimulationStats stats = trainer.train(games, threads, reportSeconds,
+                                          std::cout);
+    Simulation::printReport(stats, std::cout);
+}